@@ -0,0 +1,272 @@
+/* ========================================================================== */
+/* === KLU batch check: LU_solve_batch vs one klu_solve per system ========== */
+/* ========================================================================== */
+
+/* Checks KLU_DLL's batched solver (KLU_DLL/KLU_Batch.cpp) against klu_factor
+ * and klu_solve run on each system by itself.  Random systems sharing one
+ * pattern, some with small diagonals so the pivot check sends them through
+ * the fallback, are solved in batches of several sizes.  Each batch is solved
+ * twice with new values and LU_destroy_batch in between, which must keep the
+ * pattern, and once more in reproducible mode.  Every other pattern starts
+ * with system 0 singular (in batches of more than one), which must only
+ * fail system 0 - the pivot order comes from the next system klu can
+ * factor.  Systems the batch factored itself may differ from klu's answer
+ * by rounding; fallback and reproducible ones must match it bit for bit.
+ *
+ * Usage:  klu_batch [ntrials]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "klu.h"
+#include "KLU_DLL.h"
+
+/* ========================================================================== */
+/* === random =============================================================== */
+/* ========================================================================== */
+
+/* fixed linear congruential generator, so every run checks the same systems */
+
+static unsigned long seed = 1 ;
+
+static double random_value (void)
+{
+    seed = seed * 1103515245 + 12345 ;
+    return ((double) ((seed >> 16) % 20001) / 10000.0 - 1.0) ;
+}
+
+static int random_index (int n)
+{
+    seed = seed * 1103515245 + 12345 ;
+    return ((int) ((seed >> 16) % (unsigned long) n)) ;
+}
+
+/* ========================================================================== */
+/* === fill ================================================================= */
+/* ========================================================================== */
+
+/* new values for every system on the pattern Ap/Ai, and new right-hand
+ * sides, stored system-fastest like LU_solve_batch wants them */
+
+static void fill (int n, int nsys, int *Ap, int *Ai, double *Ax, double *B)
+{
+    int j, p, s, i ;
+    double diag ;
+
+    for (j = 0 ; j < n ; j++)
+    {
+        for (p = Ap [j] ; p < Ap [j+1] ; p++)
+        {
+            for (s = 0 ; s < nsys ; s++)
+            {
+                if (Ai [p] == j)
+                {
+                    diag = random_value ( ) ;
+                    /* one diagonal in ten is small, and fails the pivot check */
+                    Ax [(size_t) p*nsys + s] = (random_index (10) == 0) ?
+                        diag * 1e-3 : diag + 4.0 * (diag < 0 ? -1 : 1) ;
+                }
+                else
+                {
+                    Ax [(size_t) p*nsys + s] = random_value ( ) ;
+                }
+            }
+        }
+    }
+    for (i = 0 ; i < n*nsys ; i++) B [i] = random_value ( ) ;
+}
+
+/* ========================================================================== */
+/* === single =============================================================== */
+/* ========================================================================== */
+
+/* solves system s of the batch on its own, with btf off like LU_init_batch.
+ * returns the solution in X, or 0 if klu could not factor the system. */
+
+static int single (int n, int nsys, int s, int *Ap, int *Ai, double *Ax,
+    double *B, double *X)
+{
+    klu_common Common ;
+    klu_symbolic *Symbolic ;
+    klu_numeric *Numeric ;
+    double *Axs ;
+    int p, i, ok ;
+
+    Axs = (double *) malloc ((Ap [n] + 1) * sizeof (double)) ;
+    for (p = 0 ; p < Ap [n] ; p++) Axs [p] = Ax [(size_t) p*nsys + s] ;
+    for (i = 0 ; i < n ; i++) X [i] = B [(size_t) i*nsys + s] ;
+
+    klu_defaults (&Common) ;
+    Common.btf = 0 ;
+    Symbolic = klu_analyze (n, Ap, Ai, &Common) ;
+    Numeric = klu_factor (Ap, Ai, Axs, Symbolic, &Common) ;
+    ok = (Numeric != NULL) && klu_solve (Symbolic, Numeric, n, 1, X, &Common) ;
+
+    klu_free_numeric (&Numeric, &Common) ;
+    klu_free_symbolic (&Symbolic, &Common) ;
+    free (Axs) ;
+    return (ok) ;
+}
+
+/* ========================================================================== */
+/* === check ================================================================ */
+/* ========================================================================== */
+
+/* one random pattern, nsys systems on it, system 0 singular in round 0 if
+ * singular0.  returns the number of failed comparisons; *nsolves and
+ * *nskipped count the systems compared and the ones klu itself could not
+ * factor. */
+
+static int check (int n, int nsys, bool singular0, int *nsolves,
+    int *nskipped)
+{
+    NR_SOLVER_VARS_BATCH vars ;
+    KLU_STRUCT_BATCH *KLUValues ;
+    klu_symbolic *Symbolic0 ;
+    void *ext ;
+    int *Ap, *Ai, *Lp0, nz, j, k, i, p, s, round, status, bad = 0, per = 3 ;
+    double *Ax, *B, *B0, *X, err, xnorm ;
+    bool exact ;
+    char *mark ;
+
+    Ap = (int *) malloc ((n+1) * sizeof (int)) ;
+    Ai = (int *) malloc ((size_t) n * (per+1) * sizeof (int)) ;
+    Ax = (double *) malloc ((size_t) n * (per+1) * nsys * sizeof (double)) ;
+    B = (double *) malloc ((size_t) n * nsys * sizeof (double)) ;
+    B0 = (double *) malloc ((size_t) n * nsys * sizeof (double)) ;
+    X = (double *) malloc (n * sizeof (double)) ;
+    mark = (char *) calloc (n, 1) ;
+
+    /* the diagonal and up to per other rows in each column */
+    nz = 0 ;
+    for (j = 0 ; j < n ; j++)
+    {
+        Ap [j] = nz ;
+        Ai [nz++] = j ;
+        mark [j] = 1 ;
+        for (k = 0 ; k < per ; k++)
+        {
+            i = random_index (n) ;
+            if (mark [i]) continue ;
+            mark [i] = 1 ;
+            Ai [nz++] = i ;
+        }
+        for (k = Ap [j] ; k < nz ; k++) mark [Ai [k]] = 0 ;
+    }
+    Ap [n] = nz ;
+
+    vars.a_LU = Ax ;
+    vars.rhs_LU = B ;
+    vars.cols_LU = Ap ;
+    vars.rows_LU = Ai ;
+
+    ext = LU_init_batch (NULL) ;
+    KLUValues = (KLU_STRUCT_BATCH *) ext ;
+    Lp0 = NULL ;
+    Symbolic0 = NULL ;
+
+    /* rounds 0 and 1 are batched, with the pattern kept across
+     * LU_destroy_batch for round 1; round 2 is reproducible */
+    for (round = 0 ; round < 3 ; round++)
+    {
+        fill (n, nsys, Ap, Ai, Ax, B) ;
+        if (round == 0 && singular0)
+        {
+            /* an empty column: klu_factor rejects it whatever the order */
+            for (p = Ap [0] ; p < Ap [1] ; p++) Ax [(size_t) p*nsys] = 0 ;
+        }
+        memcpy (B0, B, (size_t) n * nsys * sizeof (double)) ;
+        if (round == 2) LU_reproducible_batch (ext, true) ;
+        LU_alloc_batch (ext, n, nsys, round == 0) ;
+        status = LU_solve_batch (ext, &vars, n, nsys) ;
+
+        if (round == 0 && singular0 && (status != KLU_SINGULAR ||
+            KLUValues->Lp == NULL || !KLUValues->Failed [0]))
+        {
+            printf ("MISMATCH: n %d nsys %d: singular system 0 gave status"
+                " %d\n", n, nsys, status) ;
+            bad++ ;
+        }
+
+        if (round == 0)
+        {
+            Lp0 = KLUValues->Lp ;
+            Symbolic0 = KLUValues->SymbolicVal ;
+        }
+        else if (Lp0 != NULL && (KLUValues->Lp != Lp0 ||
+            KLUValues->SymbolicVal != Symbolic0))
+        {
+            printf ("MISMATCH: n %d nsys %d round %d: pattern rebuilt after"
+                " LU_destroy_batch\n", n, nsys, round) ;
+            bad++ ;
+        }
+
+        for (s = 0 ; s < nsys ; s++)
+        {
+            if (!single (n, nsys, s, Ap, Ai, Ax, B0, X))
+            {
+                (*nskipped)++ ;
+                continue ;
+            }
+            (*nsolves)++ ;
+
+            err = 0 ;
+            xnorm = 0 ;
+            for (i = 0 ; i < n ; i++)
+            {
+                err = fmax (err, fabs (B [(size_t) i*nsys + s] - X [i])) ;
+                xnorm = fmax (xnorm, fabs (X [i])) ;
+            }
+
+            /* systems solved through the fallback are klu's own answer */
+            exact = (round == 2) || KLUValues->Failed [s] ;
+            if (exact ? (err != 0) : (err > 1e-10 * fmax (xnorm, 1)))
+            {
+                printf ("MISMATCH: n %d nsys %d system %d round %d: "
+                    "error %g\n", n, nsys, s, round, err) ;
+                bad++ ;
+            }
+        }
+
+        /* frees the values only, like LU_destroy frees the numeric object */
+        LU_destroy_batch (ext, true) ;
+        if (KLUValues->Lx != NULL || KLUValues->Ux != NULL ||
+            KLUValues->Lp != Lp0)
+        {
+            printf ("MISMATCH: n %d nsys %d: LU_destroy_batch freed the"
+                " wrong arrays\n", n, nsys) ;
+            bad++ ;
+        }
+    }
+
+    LU_free_batch (ext) ;
+    free (Ap) ; free (Ai) ; free (Ax) ; free (B) ; free (B0) ; free (X) ;
+    free (mark) ;
+    return (bad) ;
+}
+
+/* ========================================================================== */
+/* === main ================================================================= */
+/* ========================================================================== */
+
+int main (int argc, char **argv)
+{
+    int ntrials = (argc > 1) ? atoi (argv [1]) : 50 ;
+    int nsys [ ] = { 1, 3, 8, 33 } ;
+    int t, k, bad = 0, nsolves = 0, nskipped = 0 ;
+
+    for (t = 0 ; t < ntrials ; t++)
+    {
+        for (k = 0 ; k < 4 ; k++)
+        {
+            bad += check (2 + random_index (60), nsys [k],
+                t % 2 == 1 && nsys [k] > 1, &nsolves, &nskipped) ;
+        }
+    }
+
+    printf ("klu_batch: %d systems, %d mismatches (%d singular systems"
+        " skipped)\n", nsolves, bad, nskipped) ;
+    return (bad == 0 ? 0 : 1) ;
+}
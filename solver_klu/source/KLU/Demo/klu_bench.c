@@ -0,0 +1,236 @@
+/* ========================================================================== */
+/* === KLU benchmark: int vs UF_long ======================================== */
+/* ========================================================================== */
+
+/* Compares the int (klu_*) and UF_long (klu_l_*) versions of KLU on the same
+ * matrix, to show the time and memory cost of the 64-bit index path used by
+ * LU_solve_l in KLU_DLL.  The matrix mimics a GridLAB-D Newton-Raphson
+ * Jacobian: a radial feeder with a dense 6-by-6 block per bus (3 phases,
+ * real and imaginary parts) and a 6-by-6 block in each direction per branch.
+ *
+ * Usage:  klu_bench [nbus [nreps]]
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "klu.h"
+
+#define BLOCK 6
+
+/* ========================================================================== */
+/* === make_feeder ========================================================== */
+/* ========================================================================== */
+
+/* Builds the feeder Jacobian in compressed-column form with UF_long indices.
+ * Bus k (k > 0) hangs off bus parent [k], picked by a fixed linear
+ * congruential generator so every run gets the same matrix. */
+
+static UF_long make_feeder (UF_long nbus, UF_long **Ap_out, UF_long **Ai_out,
+    double **Ax_out)
+{
+    UF_long n = nbus * BLOCK, nz, *parent, *Ap, *Ai, *cnt, *adjp, *adj, k, j, i,
+        bi, bj, p, q ;
+    unsigned long seed = 1 ;
+    double *Ax ;
+
+    parent = (UF_long *) malloc (nbus * sizeof (UF_long)) ;
+    cnt = (UF_long *) calloc (nbus, sizeof (UF_long)) ;
+    parent [0] = -1 ;
+    for (k = 1 ; k < nbus ; k++)
+    {
+        /* attach near the end of the feeder so it stays long and radial */
+        seed = seed * 1103515245 + 12345 ;
+        j = k - 1 - (UF_long) ((seed >> 16) % 4) ;
+        parent [k] = (j < 0) ? 0 : j ;
+        cnt [parent [k]]++ ;
+        cnt [k]++ ;
+    }
+
+    /* each bus block column holds its own block plus one per neighbor */
+    nz = 0 ;
+    for (k = 0 ; k < nbus ; k++)
+    {
+        nz += (1 + cnt [k]) * BLOCK * BLOCK ;
+    }
+    Ap = (UF_long *) malloc ((n+1) * sizeof (UF_long)) ;
+    Ai = (UF_long *) malloc (nz * sizeof (UF_long)) ;
+    Ax = (double *) malloc (nz * sizeof (double)) ;
+
+    /* neighbor lists: the bus itself, its parent, then its children */
+    adjp = (UF_long *) malloc ((nbus+1) * sizeof (UF_long)) ;
+    adj = (UF_long *) malloc ((nbus + 2*nbus) * sizeof (UF_long)) ;
+    adjp [0] = 0 ;
+    for (k = 0 ; k < nbus ; k++)
+    {
+        adjp [k+1] = adjp [k] + 1 + cnt [k] ;
+        adj [adjp [k]] = k ;
+        cnt [k] = adjp [k] + 1 ;
+    }
+    for (k = 1 ; k < nbus ; k++)
+    {
+        adj [cnt [k]++] = parent [k] ;
+        adj [cnt [parent [k]]++] = k ;
+    }
+
+    p = 0 ;
+    for (bj = 0 ; bj < nbus ; bj++)
+    {
+        for (j = 0 ; j < BLOCK ; j++)
+        {
+            Ap [bj*BLOCK + j] = p ;
+            for (q = adjp [bj] ; q < adjp [bj+1] ; q++)
+            {
+                bi = adj [q] ;
+                for (i = 0 ; i < BLOCK ; i++)
+                {
+                    Ai [p] = bi*BLOCK + i ;
+                    if (bi == bj)
+                    {
+                        Ax [p] = (i == j) ? (4.0 * (adjp [bj+1] - adjp [bj])) :
+                            (0.1 / (1 + i + j)) ;
+                    }
+                    else
+                    {
+                        Ax [p] = -1.0 / (1 + labs ((long) (i - j))) ;
+                    }
+                    p++ ;
+                }
+            }
+        }
+    }
+    Ap [n] = p ;
+
+    free (parent) ;
+    free (cnt) ;
+    free (adjp) ;
+    free (adj) ;
+    *Ap_out = Ap ;
+    *Ai_out = Ai ;
+    *Ax_out = Ax ;
+    return (n) ;
+}
+
+/* ========================================================================== */
+/* === main ================================================================= */
+/* ========================================================================== */
+
+int main (int argc, char **argv)
+{
+    UF_long nbus = 2000, nreps = 10, n, nz, k, *Ap, *Ai ;
+    int *Ap32, *Ai32 ;
+    double *Ax, *B, t, t_analyze [2], t_factor [2], t_solve [2], err ;
+    size_t peak [2] ;
+    klu_common Common ;
+    klu_symbolic *Symbolic ;
+    klu_numeric *Numeric ;
+    klu_l_common Common_l ;
+    klu_l_symbolic *Symbolic_l ;
+    klu_l_numeric *Numeric_l ;
+    double *X32 ;
+
+    if (argc > 1) nbus = atol (argv [1]) ;
+    if (argc > 2) nreps = atol (argv [2]) ;
+    if (nbus < 2 || nreps < 1)
+    {
+        printf ("usage: klu_bench [nbus [nreps]]\n") ;
+        return (1) ;
+    }
+
+    n = make_feeder (nbus, &Ap, &Ai, &Ax) ;
+    nz = Ap [n] ;
+    printf ("KLU: %s, version: %d.%d.%d\n", KLU_DATE, KLU_MAIN_VERSION,
+        KLU_SUB_VERSION, KLU_SUBSUB_VERSION) ;
+    printf ("feeder: %ld buses, n %ld nnz(A) %ld, %ld repetitions\n",
+        (long) nbus, (long) n, (long) nz, (long) nreps) ;
+
+    /* int copy of the pattern for the 32-bit path */
+    Ap32 = (int *) malloc ((n+1) * sizeof (int)) ;
+    Ai32 = (int *) malloc (nz * sizeof (int)) ;
+    for (k = 0 ; k <= n ; k++) Ap32 [k] = (int) Ap [k] ;
+    for (k = 0 ; k < nz ; k++) Ai32 [k] = (int) Ai [k] ;
+    B = (double *) malloc (n * sizeof (double)) ;
+    X32 = (double *) malloc (n * sizeof (double)) ;
+
+    /* ---------------------------------------------------------------------- */
+    /* int path */
+    /* ---------------------------------------------------------------------- */
+
+    klu_defaults (&Common) ;
+    t = clock () ;
+    Symbolic = klu_analyze ((int) n, Ap32, Ai32, &Common) ;
+    t_analyze [0] = (clock () - t) / (double) CLOCKS_PER_SEC ;
+    t_factor [0] = t_solve [0] = 0 ;
+    for (k = 0 ; Symbolic && k < nreps ; k++)
+    {
+        UF_long i ;
+        for (i = 0 ; i < n ; i++) X32 [i] = 1 + ((double) i) / n ;
+        t = clock () ;
+        Numeric = klu_factor (Ap32, Ai32, Ax, Symbolic, &Common) ;
+        t_factor [0] += (clock () - t) / (double) CLOCKS_PER_SEC ;
+        if (!Numeric) break ;
+        t = clock () ;
+        klu_solve (Symbolic, Numeric, (int) n, 1, X32, &Common) ;
+        t_solve [0] += (clock () - t) / (double) CLOCKS_PER_SEC ;
+        klu_free_numeric (&Numeric, &Common) ;
+    }
+    peak [0] = Common.mempeak ;
+    klu_free_symbolic (&Symbolic, &Common) ;
+    if (Common.status != KLU_OK)
+    {
+        printf ("int path failed, status %d\n", Common.status) ;
+    }
+
+    /* ---------------------------------------------------------------------- */
+    /* UF_long path */
+    /* ---------------------------------------------------------------------- */
+
+    klu_l_defaults (&Common_l) ;
+    t = clock () ;
+    Symbolic_l = klu_l_analyze (n, Ap, Ai, &Common_l) ;
+    t_analyze [1] = (clock () - t) / (double) CLOCKS_PER_SEC ;
+    t_factor [1] = t_solve [1] = 0 ;
+    for (k = 0 ; Symbolic_l && k < nreps ; k++)
+    {
+        UF_long i ;
+        for (i = 0 ; i < n ; i++) B [i] = 1 + ((double) i) / n ;
+        t = clock () ;
+        Numeric_l = klu_l_factor (Ap, Ai, Ax, Symbolic_l, &Common_l) ;
+        t_factor [1] += (clock () - t) / (double) CLOCKS_PER_SEC ;
+        if (!Numeric_l) break ;
+        t = clock () ;
+        klu_l_solve (Symbolic_l, Numeric_l, n, 1, B, &Common_l) ;
+        t_solve [1] += (clock () - t) / (double) CLOCKS_PER_SEC ;
+        klu_l_free_numeric (&Numeric_l, &Common_l) ;
+    }
+    peak [1] = Common_l.mempeak ;
+    klu_l_free_symbolic (&Symbolic_l, &Common_l) ;
+    if (Common_l.status != KLU_OK)
+    {
+        printf ("UF_long path failed, status %ld\n", (long) Common_l.status) ;
+    }
+
+    /* both paths must give the same answer */
+    err = 0 ;
+    for (k = 0 ; k < n ; k++)
+    {
+        err = fabs (B [k] - X32 [k]) > err ? fabs (B [k] - X32 [k]) : err ;
+    }
+
+    printf ("%-8s %12s %12s %12s %14s\n", "path", "analyze(s)", "factor(s)",
+        "solve(s)", "peak(bytes)") ;
+    printf ("%-8s %12.4f %12.4f %12.4f %14.0f\n", "int", t_analyze [0],
+        t_factor [0] / nreps, t_solve [0] / nreps, (double) peak [0]) ;
+    printf ("%-8s %12.4f %12.4f %12.4f %14.0f\n", "UF_long", t_analyze [1],
+        t_factor [1] / nreps, t_solve [1] / nreps, (double) peak [1]) ;
+    printf ("UF_long/int: factor %.2fx, solve %.2fx, peak memory %.2fx\n",
+        t_factor [0] > 0 ? t_factor [1] / t_factor [0] : 0,
+        t_solve [0] > 0 ? t_solve [1] / t_solve [0] : 0,
+        peak [0] > 0 ? (double) peak [1] / (double) peak [0] : 0) ;
+    printf ("max |x_long - x_int| %g\n", err) ;
+
+    free (Ap) ; free (Ai) ; free (Ax) ;
+    free (Ap32) ; free (Ai32) ; free (B) ; free (X32) ;
+    return (0) ;
+}
@@ -0,0 +1,281 @@
+/* ========================================================================== */
+/* === KLU template check: KLU_Template vs klu_solve/klu_tsolve ============= */
+/* ========================================================================== */
+
+/* Checks that the templated solve kernels KLU_DLL uses (KLU_DLL/KLU_Template.h)
+ * give bit-identical results to klu_solve and klu_tsolve.  Random unsymmetric
+ * matrices (so BTF finds several blocks with off-diagonal parts, and some
+ * small diagonals force pivoting) are factored once, then solved both ways for
+ * 1 to 6 right-hand sides, real and complex, int and UF_long, plain,
+ * transposed and conjugate transposed.  Any difference fails the check.
+ *
+ * Usage:  klu_template [ntrials]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <complex>
+#include "klu.h"
+#include "KLU_Template.h"
+
+/* ========================================================================== */
+/* === KLU_Int ============================================================== */
+/* ========================================================================== */
+
+/* The klu_* and klu_l_* entry points, picked by index type */
+
+template <class Int> struct KLU_Int ;
+
+template <> struct KLU_Int <int>
+{
+    typedef klu_common Common ;
+    typedef klu_symbolic Symbolic ;
+    typedef klu_numeric Numeric ;
+
+    static void defaults (Common *c) { klu_defaults (c) ; }
+    static Symbolic *analyze (int n, int *Ap, int *Ai, Common *c)
+    {
+        return (klu_analyze (n, Ap, Ai, c)) ;
+    }
+    static Numeric *factor (bool z, int *Ap, int *Ai, double *Ax, Symbolic *S,
+        Common *c)
+    {
+        return (z ? klu_z_factor (Ap, Ai, Ax, S, c) : klu_factor (Ap, Ai, Ax,
+            S, c)) ;
+    }
+    static void solve (bool z, Symbolic *S, Numeric *N, int d, int nrhs,
+        double *B, Common *c)
+    {
+        if (z) klu_z_solve (S, N, d, nrhs, B, c) ;
+        else klu_solve (S, N, d, nrhs, B, c) ;
+    }
+    static void tsolve (bool z, Symbolic *S, Numeric *N, int d, int nrhs,
+        double *B, int conj_solve, Common *c)
+    {
+        if (z) klu_z_tsolve (S, N, d, nrhs, B, conj_solve, c) ;
+        else klu_tsolve (S, N, d, nrhs, B, c) ;
+    }
+    static void free_numeric (bool z, Numeric **N, Common *c)
+    {
+        if (z) klu_z_free_numeric (N, c) ;
+        else klu_free_numeric (N, c) ;
+    }
+    static void free_symbolic (Symbolic **S, Common *c)
+    {
+        klu_free_symbolic (S, c) ;
+    }
+} ;
+
+template <> struct KLU_Int <UF_long>
+{
+    typedef klu_l_common Common ;
+    typedef klu_l_symbolic Symbolic ;
+    typedef klu_l_numeric Numeric ;
+
+    static void defaults (Common *c) { klu_l_defaults (c) ; }
+    static Symbolic *analyze (UF_long n, UF_long *Ap, UF_long *Ai, Common *c)
+    {
+        return (klu_l_analyze (n, Ap, Ai, c)) ;
+    }
+    static Numeric *factor (bool z, UF_long *Ap, UF_long *Ai, double *Ax,
+        Symbolic *S, Common *c)
+    {
+        return (z ? klu_zl_factor (Ap, Ai, Ax, S, c) : klu_l_factor (Ap, Ai,
+            Ax, S, c)) ;
+    }
+    static void solve (bool z, Symbolic *S, Numeric *N, UF_long d,
+        UF_long nrhs, double *B, Common *c)
+    {
+        if (z) klu_zl_solve (S, N, d, nrhs, B, c) ;
+        else klu_l_solve (S, N, d, nrhs, B, c) ;
+    }
+    static void tsolve (bool z, Symbolic *S, Numeric *N, UF_long d,
+        UF_long nrhs, double *B, int conj_solve, Common *c)
+    {
+        if (z) klu_zl_tsolve (S, N, d, nrhs, B, conj_solve, c) ;
+        else klu_l_tsolve (S, N, d, nrhs, B, c) ;
+    }
+    static void free_numeric (bool z, Numeric **N, Common *c)
+    {
+        if (z) klu_zl_free_numeric (N, c) ;
+        else klu_l_free_numeric (N, c) ;
+    }
+    static void free_symbolic (Symbolic **S, Common *c)
+    {
+        klu_l_free_symbolic (S, c) ;
+    }
+} ;
+
+/* ========================================================================== */
+/* === random =============================================================== */
+/* ========================================================================== */
+
+/* fixed linear congruential generator, so every run checks the same systems */
+
+static unsigned long seed = 1 ;
+
+static double random_value (void)
+{
+    seed = seed * 1103515245 + 12345 ;
+    return ((double) ((seed >> 16) % 20001) / 10000.0 - 1.0) ;
+}
+
+static long random_index (long n)
+{
+    seed = seed * 1103515245 + 12345 ;
+    return ((long) ((seed >> 16) % (unsigned long) n)) ;
+}
+
+/* ========================================================================== */
+/* === same ================================================================= */
+/* ========================================================================== */
+
+/* solves B both ways and compares them bit for bit.  how is 0 for A, 1 for
+ * A', and 2 for A^H.  returns 1 if they match. */
+
+template <class Int, class Entry> static int same (bool z, int how,
+    typename KLU_Int<Int>::Symbolic *S, typename KLU_Int<Int>::Numeric *N,
+    Int d, Int nrhs, double *B, typename KLU_Int<Int>::Common *c)
+{
+    size_t len = (size_t) d * nrhs * (z ? 2 : 1) ;
+    double *Bref = (double *) malloc (len * sizeof (double)) ;
+    double *Btpl = (double *) malloc (len * sizeof (double)) ;
+    int ok ;
+
+    memcpy (Bref, B, len * sizeof (double)) ;
+    memcpy (Btpl, B, len * sizeof (double)) ;
+    if (how == 0)
+    {
+        KLU_Int<Int>::solve (z, S, N, d, nrhs, Bref, c) ;
+        KLU_Template::Solve (S, N, d, nrhs, (Entry *) Btpl, c) ;
+    }
+    else
+    {
+        KLU_Int<Int>::tsolve (z, S, N, d, nrhs, Bref, how == 2, c) ;
+        KLU_Template::TSolve (S, N, d, nrhs, how == 2, (Entry *) Btpl, c) ;
+    }
+    ok = (memcmp (Bref, Btpl, len * sizeof (double)) == 0) ;
+    free (Bref) ;
+    free (Btpl) ;
+    return (ok) ;
+}
+
+/* ========================================================================== */
+/* === check ================================================================ */
+/* ========================================================================== */
+
+/* builds one random n-by-n system, factors it, and compares every solve.
+ * returns the number of mismatches, or -1 if the matrix was singular. */
+
+template <class Int> static int check (Int n, bool z, int *nsolves)
+{
+    typedef KLU_Int<Int> K ;
+    typename K::Common Common ;
+    typename K::Symbolic *Symbolic ;
+    typename K::Numeric *Numeric ;
+    Int *Ap, *Ai, nz, j, k, i, nrhs, d, how ;
+    char *mark ;
+    double *Ax, *B, diag ;
+    int bad = 0, nx = z ? 2 : 1, per = 4 ;
+
+    Ap = (Int *) malloc ((n+1) * sizeof (Int)) ;
+    Ai = (Int *) malloc ((size_t) n * (per+1) * sizeof (Int)) ;
+    Ax = (double *) malloc ((size_t) n * (per+1) * nx * sizeof (double)) ;
+    mark = (char *) calloc (n, 1) ;
+
+    /* each column gets its diagonal and up to per other rows, mostly below
+     * it, so the matrix is close to triangular and BTF splits it up */
+    nz = 0 ;
+    for (j = 0 ; j < n ; j++)
+    {
+        Ap [j] = nz ;
+        diag = random_value ( ) ;
+        if (random_index (5) == 0) diag *= 1e-3 ;   /* makes klu pivot */
+        Ai [nz] = j ;
+        mark [j] = 1 ;
+        for (k = 0 ; k < nx ; k++) Ax [nz*nx + k] = (k ? random_value ( ) :
+            diag + 2.0 * (diag < 0 ? -1 : 1) * (random_index (4) != 0)) ;
+        nz++ ;
+        for (k = 0 ; k < per ; k++)
+        {
+            i = (random_index (4) == 0) ? (Int) random_index (n) :
+                j + 1 + (Int) random_index (8) ;
+            if (i >= n || mark [i]) continue ;
+            mark [i] = 1 ;
+            Ai [nz] = i ;
+            Ax [nz*nx] = random_value ( ) ;
+            if (z) Ax [nz*nx+1] = random_value ( ) ;
+            nz++ ;
+        }
+        for (k = Ap [j] ; k < nz ; k++) mark [Ai [k]] = 0 ;
+    }
+    Ap [n] = nz ;
+
+    K::defaults (&Common) ;
+    Symbolic = K::analyze (n, Ap, Ai, &Common) ;
+    Numeric = (Symbolic == NULL) ? NULL :
+        K::factor (z, Ap, Ai, Ax, Symbolic, &Common) ;
+    if (Numeric == NULL)
+    {
+        K::free_symbolic (&Symbolic, &Common) ;
+        free (Ap) ; free (Ai) ; free (Ax) ; free (mark) ;
+        return (-1) ;
+    }
+
+    for (nrhs = 1 ; nrhs <= 6 ; nrhs++)
+    {
+        /* odd counts use a leading dimension past n */
+        d = n + (nrhs % 2) * 3 ;
+        B = (double *) malloc ((size_t) d * nrhs * nx * sizeof (double)) ;
+        for (k = 0 ; k < d * nrhs * nx ; k++) B [k] = random_value ( ) ;
+        for (how = 0 ; how <= (z ? 2 : 1) ; how++)
+        {
+            (*nsolves)++ ;
+            if (!(z ? same<Int, std::complex<double> > (z, how, Symbolic,
+                Numeric, d, nrhs, B, &Common) : same<Int, double> (z, how,
+                Symbolic, Numeric, d, nrhs, B, &Common)))
+            {
+                printf ("MISMATCH: %s %s n %ld nrhs %ld %s\n",
+                    sizeof (Int) == sizeof (int) ? "int" : "UF_long",
+                    z ? "complex" : "real", (long) n, (long) nrhs,
+                    how == 0 ? "solve" : (how == 1 ? "tsolve" : "conj tsolve")) ;
+                bad++ ;
+            }
+        }
+        free (B) ;
+    }
+
+    K::free_numeric (z, &Numeric, &Common) ;
+    K::free_symbolic (&Symbolic, &Common) ;
+    free (Ap) ; free (Ai) ; free (Ax) ; free (mark) ;
+    return (bad) ;
+}
+
+/* ========================================================================== */
+/* === main ================================================================= */
+/* ========================================================================== */
+
+int main (int argc, char **argv)
+{
+    int ntrials = (argc > 1) ? atoi (argv [1]) : 50 ;
+    int t, bad = 0, singular = 0, nsolves = 0, r ;
+    long n ;
+
+    for (t = 0 ; t < ntrials ; t++)
+    {
+        n = 1 + random_index (t < ntrials/2 ? 20 : 400) ;
+        r = check <int> ((int) n, false, &nsolves) ;
+        if (r < 0) singular++ ; else bad += r ;
+        r = check <int> ((int) n, true, &nsolves) ;
+        if (r < 0) singular++ ; else bad += r ;
+        r = check <UF_long> ((UF_long) n, false, &nsolves) ;
+        if (r < 0) singular++ ; else bad += r ;
+        r = check <UF_long> ((UF_long) n, true, &nsolves) ;
+        if (r < 0) singular++ ; else bad += r ;
+    }
+
+    printf ("klu_template: %d solves, %d mismatches (%d singular systems"
+        " skipped)\n", nsolves, bad, singular) ;
+    return (bad == 0 ? 0 : 1) ;
+}
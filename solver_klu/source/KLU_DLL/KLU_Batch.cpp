@@ -0,0 +1,672 @@
+// KLU_Batch.cpp
+//
+// Batched solver for many small systems that share one sparsity pattern, such as a
+// scenario study over thousands of copies of the IEEE 4, 13 or 37-node feeders.
+// Calling LU_init/LU_solve per feeder pays for the allocations, klu_defaults, BTF and
+// klu_analyze every time, which costs more than the arithmetic on systems this small.
+//
+// Here the pattern is analyzed once and system 0 is factored with klu_factor to pick
+// the pivot order (or the first system after it klu can factor, if it is singular -
+// the skipped ones go through the fallback and report klu's status).  The L and U patterns of that factorization are reused for every
+// system, with the values of all systems stored side by side (a_LU[p*nsys + s]), so
+// the innermost factor and solve loops run across systems and vectorize.  A system
+// whose pivot fails the same tolerance test klu_factor uses is redone on its own with
+// klu_factor/klu_solve.
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "klu.h"
+#include "KLU_DLL.h"
+
+// Frees the shared pattern and the value arrays - Symbolic and Common are left alone
+static void LU_batch_free_factors(KLU_STRUCT_BATCH *KLUValues)
+{
+	free(KLUValues->P);
+	free(KLUValues->Pinv);
+	free(KLUValues->Q);
+	free(KLUValues->Lp);
+	free(KLUValues->Li);
+	free(KLUValues->Up);
+	free(KLUValues->Ui);
+	free(KLUValues->Lx);
+	free(KLUValues->Ux);
+	free(KLUValues->X);
+	free(KLUValues->Work);
+	free(KLUValues->Failed);
+
+	KLUValues->P = KLUValues->Pinv = KLUValues->Q = NULL;
+	KLUValues->Lp = KLUValues->Li = KLUValues->Up = KLUValues->Ui = NULL;
+	KLUValues->Lx = KLUValues->Ux = KLUValues->X = KLUValues->Work = NULL;
+	KLUValues->Failed = NULL;
+	KLUValues->n = 0;
+	KLUValues->nsys = 0;
+}
+
+// Allocates the per-solve L and U values on the kept pattern, after LU_destroy_batch freed them
+// Returns KLU_OK or KLU_OUT_OF_MEMORY
+static int LU_batch_alloc_values(KLU_STRUCT_BATCH *KLUValues)
+{
+	int n, ns;
+
+	n = (int)KLUValues->n;
+	ns = (int)KLUValues->nsys;
+
+	KLUValues->Lx = (double *)malloc(sizeof(double)*KLUValues->Lp[n]*ns);
+	KLUValues->Ux = (double *)malloc(sizeof(double)*KLUValues->Up[n]*ns);
+
+	if ((KLUValues->Lx==NULL) || (KLUValues->Ux==NULL))
+	{
+		free(KLUValues->Lx);
+		free(KLUValues->Ux);
+		KLUValues->Lx = KLUValues->Ux = NULL;
+		KLUValues->CommonVal->status = KLU_OUT_OF_MEMORY;
+		return KLU_OUT_OF_MEMORY;
+	}
+
+	return KLU_OK;
+}
+
+// Pattern function
+// Analyzes the shared pattern, factors system 0 to get the pivot order and pulls the
+// L and U patterns out of it.  A singular system 0 doesn't sink the batch - the next
+// system is tried, and PivotSystem records the one used.  Returns KLU_OK or the status
+// of the step that failed (KLU_SINGULAR if klu could factor none of them).
+static int LU_batch_analyze(KLU_STRUCT_BATCH *KLUValues, NR_SOLVER_VARS_BATCH *system_info_vars, unsigned int rowcount, unsigned int nsys)
+{
+	klu_numeric *NumericVal;
+	double *Ax0;
+	int n, nnz, lnz, unz, p, k, s, worksize;
+
+	n = (int)rowcount;
+
+	// Remove the old
+	LU_batch_free_factors(KLUValues);
+	if (KLUValues->SymbolicVal!=NULL)
+	{
+		klu_free_symbolic(&(KLUValues->SymbolicVal), KLUValues->CommonVal);
+	}
+
+	// Analyze the shared pattern
+	KLUValues->SymbolicVal = klu_analyze(n, system_info_vars->cols_LU, system_info_vars->rows_LU, KLUValues->CommonVal);
+	if (KLUValues->SymbolicVal==NULL)
+	{
+		return KLUValues->CommonVal->status;
+	}
+
+	// Factor system 0 - its pivot order is used for the whole batch
+	nnz = system_info_vars->cols_LU[n];
+	Ax0 = (double *)malloc(sizeof(double)*(nnz > 0 ? nnz : 1));
+	if (Ax0==NULL)
+	{
+		KLUValues->CommonVal->status = KLU_OUT_OF_MEMORY;
+		return KLU_OUT_OF_MEMORY;
+	}
+
+	// Singular ones are skipped - anything else (out of memory) would fail for every system
+	NumericVal = NULL;
+	for (s=0; s<(int)nsys; s++)
+	{
+		for (p=0; p<nnz; p++)
+		{
+			Ax0[p] = system_info_vars->a_LU[(size_t)p*nsys + s];
+		}
+
+		NumericVal = klu_factor(system_info_vars->cols_LU, system_info_vars->rows_LU, Ax0, KLUValues->SymbolicVal, KLUValues->CommonVal);
+		if ((NumericVal!=NULL) || (KLUValues->CommonVal->status!=KLU_SINGULAR))
+		{
+			break;
+		}
+	}
+	free(Ax0);
+
+	if (NumericVal==NULL)
+	{
+		return KLUValues->CommonVal->status;
+	}
+
+	// Sorted columns put the U diagonal last and let the update run in ascending row order
+	klu_sort(KLUValues->SymbolicVal, NumericVal, KLUValues->CommonVal);
+
+	lnz = NumericVal->lnz;
+	unz = NumericVal->unz;
+
+	// Scratch holds either two values per system (pivot checks) or one system's matrix and right-hand side (fallback)
+	worksize = nnz + n;
+	if (worksize < (int)(2*nsys))
+	{
+		worksize = 2*nsys;
+	}
+
+	KLUValues->P = (int *)malloc(sizeof(int)*n);
+	KLUValues->Pinv = (int *)malloc(sizeof(int)*n);
+	KLUValues->Q = (int *)malloc(sizeof(int)*n);
+	KLUValues->Lp = (int *)malloc(sizeof(int)*(n+1));
+	KLUValues->Li = (int *)malloc(sizeof(int)*lnz);
+	KLUValues->Up = (int *)malloc(sizeof(int)*(n+1));
+	KLUValues->Ui = (int *)malloc(sizeof(int)*unz);
+	KLUValues->Lx = (double *)malloc(sizeof(double)*lnz*nsys);
+	KLUValues->Ux = (double *)malloc(sizeof(double)*unz*nsys);
+	KLUValues->X = (double *)calloc((size_t)n*nsys, sizeof(double));
+	KLUValues->Work = (double *)malloc(sizeof(double)*worksize);
+	KLUValues->Failed = (bool *)malloc(sizeof(bool)*nsys);
+
+	if ((KLUValues->P==NULL) || (KLUValues->Pinv==NULL) || (KLUValues->Q==NULL) || (KLUValues->Lp==NULL) ||
+		(KLUValues->Li==NULL) || (KLUValues->Up==NULL) || (KLUValues->Ui==NULL) || (KLUValues->Lx==NULL) ||
+		(KLUValues->Ux==NULL) || (KLUValues->X==NULL) || (KLUValues->Work==NULL) || (KLUValues->Failed==NULL))
+	{
+		klu_free_numeric(&NumericVal, KLUValues->CommonVal);
+		LU_batch_free_factors(KLUValues);
+		KLUValues->CommonVal->status = KLU_OUT_OF_MEMORY;
+		return KLU_OUT_OF_MEMORY;
+	}
+
+	// Pull out the patterns - Lx/Ux are big enough to take system 0's values, which get recomputed anyway
+	// The batch Common has BTF off, so there is one block and no off-diagonal part to extract
+	klu_extract(NumericVal, KLUValues->SymbolicVal, KLUValues->Lp, KLUValues->Li, KLUValues->Lx, KLUValues->Up, KLUValues->Ui, KLUValues->Ux,
+		NULL, NULL, NULL, KLUValues->P, KLUValues->Q, NULL, NULL, KLUValues->CommonVal);
+	klu_free_numeric(&NumericVal, KLUValues->CommonVal);
+
+	for (k=0; k<n; k++)
+	{
+		KLUValues->Pinv[KLUValues->P[k]] = k;
+	}
+
+	KLUValues->n = rowcount;
+	KLUValues->nsys = nsys;
+	KLUValues->PivotSystem = s;
+
+	return KLU_OK;
+}
+
+// Factor function
+// Left-looking LU of every system on the shared pattern and pivot order.  Flags the
+// systems whose pivot fails klu_factor's partial pivoting test (|ukk| < tol*max|column|).
+static void LU_batch_factor(KLU_STRUCT_BATCH *KLUValues, NR_SOLVER_VARS_BATCH *system_info_vars)
+{
+	int *Ap, *Ai, *Lp, *Li, *Up, *Ui;
+	double *Ax, *Lx, *Ux, *X, *ukk, *colmax, *xi, *xj, *xk, *ax, *lx, *ux;
+	double tol;
+	int n, ns, k, col, p, pl, pu, j, s;
+
+	n = (int)KLUValues->n;
+	ns = (int)KLUValues->nsys;
+	Ap = system_info_vars->cols_LU;
+	Ai = system_info_vars->rows_LU;
+	Ax = system_info_vars->a_LU;
+	Lp = KLUValues->Lp;
+	Li = KLUValues->Li;
+	Up = KLUValues->Up;
+	Ui = KLUValues->Ui;
+	Lx = KLUValues->Lx;
+	Ux = KLUValues->Ux;
+	X = KLUValues->X;
+	ukk = KLUValues->Work;
+	colmax = KLUValues->Work + ns;
+
+	// Same threshold klu_factor uses when it picks pivots
+	tol = KLUValues->CommonVal->tol;
+	if (!(tol > 0.0))
+	{
+		tol = 0.0;
+	}
+	else if (tol > 1.0)
+	{
+		tol = 1.0;
+	}
+
+	for (s=0; s<ns; s++)
+	{
+		KLUValues->Failed[s] = false;
+	}
+
+	for (k=0; k<n; k++)
+	{
+		// Scatter column Q[k] of A into X, rows in pivot order
+		col = KLUValues->Q[k];
+		for (p=Ap[col]; p<Ap[col+1]; p++)
+		{
+			xi = X + (size_t)KLUValues->Pinv[Ai[p]]*ns;
+			ax = Ax + (size_t)p*ns;
+			for (s=0; s<ns; s++)
+			{
+				xi[s] = ax[s];
+			}
+		}
+
+		// Update with the columns of L that U(:,k) calls for - ascending rows, diagonal (last) skipped
+		for (pu=Up[k]; pu<Up[k+1]-1; pu++)
+		{
+			j = Ui[pu];
+			xj = X + (size_t)j*ns;
+
+			// Li[Lp[j]] is the unit diagonal
+			for (pl=Lp[j]+1; pl<Lp[j+1]; pl++)
+			{
+				xi = X + (size_t)Li[pl]*ns;
+				lx = Lx + (size_t)pl*ns;
+				for (s=0; s<ns; s++)
+				{
+					xi[s] -= lx[s] * xj[s];
+				}
+			}
+		}
+
+		// Pivot check against the candidates below the diagonal
+		xk = X + (size_t)k*ns;
+		for (s=0; s<ns; s++)
+		{
+			colmax[s] = fabs(xk[s]);
+		}
+
+		for (pl=Lp[k]+1; pl<Lp[k+1]; pl++)
+		{
+			xi = X + (size_t)Li[pl]*ns;
+			for (s=0; s<ns; s++)
+			{
+				if (fabs(xi[s]) > colmax[s])
+				{
+					colmax[s] = fabs(xi[s]);
+				}
+			}
+		}
+
+		for (s=0; s<ns; s++)
+		{
+			if ((xk[s] == 0.0) || (fabs(xk[s]) < tol*colmax[s]))
+			{
+				// Keep the lane finite, the fallback redoes this system
+				KLUValues->Failed[s] = true;
+				ukk[s] = 1.0;
+			}
+			else
+			{
+				ukk[s] = xk[s];
+			}
+		}
+
+		// Gather U(:,k) and clear X - the diagonal gets the (possibly replaced) pivot
+		for (pu=Up[k]; pu<Up[k+1]-1; pu++)
+		{
+			xj = X + (size_t)Ui[pu]*ns;
+			ux = Ux + (size_t)pu*ns;
+			for (s=0; s<ns; s++)
+			{
+				ux[s] = xj[s];
+				xj[s] = 0.0;
+			}
+		}
+
+		ux = Ux + (size_t)(Up[k+1]-1)*ns;
+		for (s=0; s<ns; s++)
+		{
+			ux[s] = ukk[s];
+			xk[s] = 0.0;
+		}
+
+		// Gather L(:,k) divided by the pivot and clear X
+		for (pl=Lp[k]+1; pl<Lp[k+1]; pl++)
+		{
+			xi = X + (size_t)Li[pl]*ns;
+			lx = Lx + (size_t)pl*ns;
+			for (s=0; s<ns; s++)
+			{
+				lx[s] = xi[s] / ukk[s];
+				xi[s] = 0.0;
+			}
+		}
+	}
+}
+
+// Batched forward/back substitution - rhs_LU is overwritten with the solutions
+static void LU_batch_solve(KLU_STRUCT_BATCH *KLUValues, NR_SOLVER_VARS_BATCH *system_info_vars)
+{
+	int *Lp, *Li, *Up, *Ui;
+	double *B, *Lx, *Ux, *X, *yi, *yk, *bi, *lx, *ux;
+	int n, ns, k, pl, pu, s;
+
+	n = (int)KLUValues->n;
+	ns = (int)KLUValues->nsys;
+	B = system_info_vars->rhs_LU;
+	Lp = KLUValues->Lp;
+	Li = KLUValues->Li;
+	Up = KLUValues->Up;
+	Ui = KLUValues->Ui;
+	Lx = KLUValues->Lx;
+	Ux = KLUValues->Ux;
+	X = KLUValues->X;
+
+	// Permute the right hand side, X = P*B
+	for (k=0; k<n; k++)
+	{
+		yk = X + (size_t)k*ns;
+		bi = B + (size_t)KLUValues->P[k]*ns;
+		for (s=0; s<ns; s++)
+		{
+			yk[s] = bi[s];
+		}
+	}
+
+	// Solve L*Y = X (unit diagonal)
+	for (k=0; k<n; k++)
+	{
+		yk = X + (size_t)k*ns;
+		for (pl=Lp[k]+1; pl<Lp[k+1]; pl++)
+		{
+			yi = X + (size_t)Li[pl]*ns;
+			lx = Lx + (size_t)pl*ns;
+			for (s=0; s<ns; s++)
+			{
+				yi[s] -= lx[s] * yk[s];
+			}
+		}
+	}
+
+	// Solve U*Z = Y (diagonal last in each column)
+	for (k=n-1; k>=0; k--)
+	{
+		yk = X + (size_t)k*ns;
+		ux = Ux + (size_t)(Up[k+1]-1)*ns;
+		for (s=0; s<ns; s++)
+		{
+			yk[s] /= ux[s];
+		}
+
+		for (pu=Up[k]; pu<Up[k+1]-1; pu++)
+		{
+			yi = X + (size_t)Ui[pu]*ns;
+			ux = Ux + (size_t)pu*ns;
+			for (s=0; s<ns; s++)
+			{
+				yi[s] -= ux[s] * yk[s];
+			}
+		}
+	}
+
+	// Permute the result, B = Q*Z, and leave the workspace zeroed for the next factor
+	// Systems that went through the fallback already hold their answer, so skip those
+	for (k=0; k<n; k++)
+	{
+		yk = X + (size_t)k*ns;
+		bi = B + (size_t)KLUValues->Q[k]*ns;
+		if (KLUValues->FallbackCount==0)
+		{
+			for (s=0; s<ns; s++)
+			{
+				bi[s] = yk[s];
+				yk[s] = 0.0;
+			}
+		}
+		else
+		{
+			for (s=0; s<ns; s++)
+			{
+				bi[s] = KLUValues->Failed[s] ? bi[s] : yk[s];
+				yk[s] = 0.0;
+			}
+		}
+	}
+}
+
+// Fallback function
+// Solves one flagged system by itself with klu_factor/klu_solve on the shared Symbolic
+// Returns KLU_OK or the KLU status (the right-hand side is left alone on failure)
+static int LU_batch_fallback(KLU_STRUCT_BATCH *KLUValues, NR_SOLVER_VARS_BATCH *system_info_vars, int s)
+{
+	klu_numeric *NumericVal;
+	double *Axs, *Bs;
+	int n, ns, nnz, p, i;
+
+	n = (int)KLUValues->n;
+	ns = (int)KLUValues->nsys;
+	nnz = system_info_vars->cols_LU[n];
+	Axs = KLUValues->Work;
+	Bs = KLUValues->Work + nnz;
+
+	// Gather this system's values
+	for (p=0; p<nnz; p++)
+	{
+		Axs[p] = system_info_vars->a_LU[(size_t)p*ns + s];
+	}
+
+	for (i=0; i<n; i++)
+	{
+		Bs[i] = system_info_vars->rhs_LU[(size_t)i*ns + s];
+	}
+
+	// Full partial-pivoting factorization
+	NumericVal = klu_factor(system_info_vars->cols_LU, system_info_vars->rows_LU, Axs, KLUValues->SymbolicVal, KLUValues->CommonVal);
+	if (NumericVal==NULL)
+	{
+		return KLUValues->CommonVal->status;
+	}
+
+	klu_solve(KLUValues->SymbolicVal, NumericVal, n, 1, Bs, KLUValues->CommonVal);
+	klu_free_numeric(&NumericVal, KLUValues->CommonVal);
+
+	// Scatter the solution back
+	for (i=0; i<n; i++)
+	{
+		system_info_vars->rhs_LU[(size_t)i*ns + s] = Bs[i];
+	}
+
+	return KLU_OK;
+}
+
+// Initialization function
+// Same as LU_init, but BTF is turned off so the shared factors are a single block
+void *LU_init_batch(void *ext_array)
+{
+	// Recasting variable
+	KLU_STRUCT_BATCH *KLUValues;
+
+	// See if the external array is linked yet
+	if (ext_array==NULL)	//Nope
+	{
+		// Create an array
+		KLUValues = (KLU_STRUCT_BATCH*)malloc(sizeof(KLU_STRUCT_BATCH));
+
+		// Make sure it worked
+		if (KLUValues==NULL)
+		{
+			//Needs to be caught externally
+			return NULL;
+		}
+
+		// Store the value
+		ext_array = (void *)(KLUValues);
+
+		// Zero the entries
+		memset(KLUValues, 0, sizeof(KLU_STRUCT_BATCH));
+
+		// Flag as none initially
+		KLUValues->AdmittanceChange = false;
+	}
+
+	// Already linked, link the variable to it
+	else
+	{
+		// Link the structure up
+		KLUValues = (KLU_STRUCT_BATCH*)ext_array;
+	}
+
+	// Determine if the common property is allocated yet
+	if (KLUValues->CommonVal==NULL)
+	{
+		// Allocate it
+		KLUValues->CommonVal = (klu_common *)malloc(sizeof(klu_common));
+
+		// Make sure it worked
+		if (KLUValues->CommonVal==NULL)
+		{
+			// Needs to be caught externally
+			return NULL;
+		}
+	}
+
+	// Set the defaults
+	klu_defaults(KLUValues->CommonVal);
+
+	// One block - the batch factorization has no off-diagonal block handling
+	KLUValues->CommonVal->btf = 0;
+
+	return ext_array;
+}
+
+// Allocation function
+// Just captures the admittance change, like LU_alloc - the arrays are sized in LU_solve_batch
+void LU_alloc_batch(void *ext_array, unsigned int rowcount, unsigned int nsys, bool admittance_change)
+{
+	// Recasting variable
+	KLU_STRUCT_BATCH *KLUValues;
+
+	// Link the structure up
+	KLUValues = (KLU_STRUCT_BATCH*)ext_array;
+
+	// Capture the admittance change - need it later
+	KLUValues->AdmittanceChange = admittance_change;
+}
+
+// Solution function
+// Rebuilds the shared pattern on an admittance change (or a new batch shape), then
+// factors and solves every system.  Returns KLU_OK, or the status of the first
+// system that could not be solved.
+int LU_solve_batch(void *ext_array, NR_SOLVER_VARS_BATCH *system_info_vars, unsigned int rowcount, unsigned int nsys)
+{
+	// Recasting variable
+	KLU_STRUCT_BATCH *KLUValues;
+	int status, fallback_status, s;
+	bool analyzed;
+
+	// Link the structure up
+	KLUValues = (KLU_STRUCT_BATCH*)ext_array;
+
+	// Need a pattern and at least one system
+	if ((rowcount==0) || (nsys==0) || (system_info_vars->cols_LU==NULL) || (system_info_vars->a_LU==NULL) || (system_info_vars->rhs_LU==NULL))
+	{
+		KLUValues->CommonVal->status = KLU_INVALID;
+		return KLU_INVALID;
+	}
+
+	// Pattern only moves on an admittance change - otherwise the last pivot order is reused
+	analyzed = false;
+	if ((KLUValues->AdmittanceChange) || (KLUValues->SymbolicVal==NULL) || (KLUValues->n!=rowcount) || (KLUValues->nsys!=nsys))
+	{
+		status = LU_batch_analyze(KLUValues, system_info_vars, rowcount, nsys);
+		if (status!=KLU_OK)
+		{
+			return status;
+		}
+		analyzed = true;
+	}
+	else if ((KLUValues->Lx==NULL) || (KLUValues->Ux==NULL))
+	{
+		status = LU_batch_alloc_values(KLUValues);
+		if (status!=KLU_OK)
+		{
+			return status;
+		}
+	}
+
+	// Factor everything on the shared pattern
+	// In reproducible mode a system's answer can't depend on which other systems share the call
+	// (the pivot order comes from system 0, or the first one klu can factor), so every system goes through the fallback path instead
+	if (KLUValues->Reproducible)
+	{
+		for (s=0; s<(int)nsys; s++)
+		{
+			KLUValues->Failed[s] = true;
+		}
+	}
+	else
+	{
+		LU_batch_factor(KLUValues, system_info_vars);
+
+		// klu already found the systems before the pivot system singular - rounding may
+		// have let them through the batched check, so they go to the fallback for klu's status
+		if (analyzed)
+		{
+			for (s=0; s<(int)KLUValues->PivotSystem; s++)
+			{
+				KLUValues->Failed[s] = true;
+			}
+		}
+	}
+
+	// Redo the systems whose pivots weren't good enough - before the batched solve overwrites their right-hand sides
+	status = KLU_OK;
+	KLUValues->FallbackCount = 0;
+	for (s=0; s<(int)nsys; s++)
+	{
+		if (KLUValues->Failed[s])
+		{
+			KLUValues->FallbackCount++;
+			fallback_status = LU_batch_fallback(KLUValues, system_info_vars, s);
+
+			if ((fallback_status!=KLU_OK) && (status==KLU_OK))
+			{
+				status = fallback_status;
+			}
+		}
+	}
+
+	// Solve the rest
+	if (KLUValues->FallbackCount < nsys)
+	{
+		LU_batch_solve(KLUValues, system_info_vars);
+	}
+
+	KLUValues->CommonVal->status = status;
+	return status;
+}
+
+// Destruction function
+// Frees the L and U values, like LU_destroy frees the numeric object - the pattern and pivot
+// order stay for the next LU_solve_batch, which reallocates the values
+// New iteration isn't needed here either - the values get redone EVERY solve
+void LU_destroy_batch(void *ext_array, bool new_iteration)
+{
+	// Recasting variable
+	KLU_STRUCT_BATCH *KLUValues;
+
+	// Link the structure up
+	KLUValues = (KLU_STRUCT_BATCH*)ext_array;
+
+	free(KLUValues->Lx);
+	free(KLUValues->Ux);
+	KLUValues->Lx = KLUValues->Ux = NULL;
+}
+
+// Teardown function
+// Frees everything LU_init_batch and LU_solve_batch allocated, including ext_array itself
+void LU_free_batch(void *ext_array)
+{
+	// Recasting variable
+	KLU_STRUCT_BATCH *KLUValues;
+
+	// Link the structure up
+	KLUValues = (KLU_STRUCT_BATCH*)ext_array;
+
+	if (KLUValues==NULL)
+	{
+		return;
+	}
+
+	LU_batch_free_factors(KLUValues);
+	klu_free_symbolic(&(KLUValues->SymbolicVal), KLUValues->CommonVal);
+	free(KLUValues->CommonVal);
+	free(KLUValues);
+}
+
+// Reproducibility function
+// Same as LU_reproducible - call after LU_init_batch
+void LU_reproducible_batch(void *ext_array, bool enable)
+{
+	// Recasting variable
+	KLU_STRUCT_BATCH *KLUValues;
+
+	// Link the structure up
+	KLUValues = (KLU_STRUCT_BATCH*)ext_array;
+
+	KLUValues->Reproducible = enable;
+}
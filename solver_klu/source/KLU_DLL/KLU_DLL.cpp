@@ -58,6 +58,7 @@
 
 #include "klu.h"
 #include "KLU_DLL.h"
+#include "KLU_Template.h"
 
 // Initialization function
 // Sets Common property (options)
@@ -89,6 +90,13 @@ void *LU_init(void *ext_array)
 
 		// Flag as none initially
 		KLUValues->AdmittanceChange = false;	
+
+		// No iterations yet, diagnostics off until LU_diagnostics_enable
+		KLUValues->Iteration = 0;
+		KLUValues->Diagnostics = NULL;
+
+		// Templated solves unless LU_reproducible says otherwise
+		KLUValues->Reproducible = false;
 	}
 
 	// Already linked, link the variable to it
@@ -144,6 +152,9 @@ int LU_solve(void *ext_array, NR_SOLVER_VARS *system_info_vars, unsigned int row
 	// Link the structure up
 	KLUValues = (KLU_STRUCT*)ext_array;
 
+	// Count it - diagnostics results are tagged with this
+	KLUValues->Iteration++;
+
 	// See if the admittance has changed
 	if (KLUValues->AdmittanceChange)
 	{
@@ -156,6 +167,9 @@ int LU_solve(void *ext_array, NR_SOLVER_VARS *system_info_vars, unsigned int row
 		// Not first run
 		else 
 		{
+			// Diagnostics thread may still be using it
+			LU_diagnostics_wait(KLUValues);
+
 			// Remove the old
 			klu_free_symbolic (&(KLUValues->SymbolicVal), KLUValues->CommonVal);
 
@@ -168,8 +182,22 @@ int LU_solve(void *ext_array, NR_SOLVER_VARS *system_info_vars, unsigned int row
 	// Create numeric one no matter what
 	KLUValues->NumericVal = klu_factor(system_info_vars->cols_LU,system_info_vars->rows_LU,system_info_vars->a_LU,KLUValues->SymbolicVal,KLUValues->CommonVal);
 
-	// Solve the matrix
-	klu_solve(KLUValues->SymbolicVal,KLUValues->NumericVal, rowcount, colcount, system_info_vars->rhs_LU,KLUValues->CommonVal);
+	// Solve the matrix - templated version of klu_solve, same checks and status codes
+	// Reproducible mode sticks to klu_solve itself, so results don't depend on how the wrapper was compiled
+	if (KLUValues->Reproducible)
+	{
+		klu_solve(KLUValues->SymbolicVal,KLUValues->NumericVal, rowcount, colcount, system_info_vars->rhs_LU,KLUValues->CommonVal);
+	}
+	else
+	{
+		KLU_Template::Solve(KLUValues->SymbolicVal,KLUValues->NumericVal, rowcount, colcount, system_info_vars->rhs_LU,KLUValues->CommonVal);
+	}
+
+	// Condition estimate and pivot growth in the background, if enabled - the worker takes over NumericVal
+	if (KLUValues->CommonVal->status == KLU_OK)
+	{
+		LU_diagnostics_post(KLUValues, system_info_vars, rowcount);
+	}
 
 	// For KLU - 1 = singular matrix (if failure turned off), positive values = warnings, negative = bad, -2 = Out of Memory, -3 = Invalid matrix (or singular if error), -4 = Too Large
 	return KLUValues->CommonVal->status;
@@ -189,3 +217,245 @@ void LU_destroy(void *ext_array, bool new_iteration)
 	// KLU destructive commands
 	klu_free_numeric(&(KLUValues->NumericVal),KLUValues->CommonVal);
 }
+
+// Reproducibility function
+// Bit-identical results regardless of threading or how the wrapper was built
+// Kept in KLU_STRUCT, so it lasts until changed - LU_init doesn't reset it
+void LU_reproducible(void *ext_array, bool enable)
+{
+	// Recasting variable
+	KLU_STRUCT *KLUValues;
+
+	// Link the structure up
+	KLUValues = (KLU_STRUCT*)ext_array;
+
+	KLUValues->Reproducible = enable;
+}
+
+// 64-bit index versions
+// Same flow as above, but built on the klu_l_* (UF_long) routines so very large aggregated
+// systems can be handled.  UF_long is only 64-bit on 64-bit builds, so the size checks below
+// are what keep a 32-bit build from silently wrapping its indices.
+
+// Size check function
+// Makes sure the matrix and the estimated L+U fill can be indexed and allocated
+// Returns KLU_OK, or KLU_TOO_LARGE/KLU_INVALID (also stored in the common status)
+static UF_long LU_check_size_l(KLU_STRUCT_L *KLUValues, NR_SOLVER_VARS_L *system_info_vars, UF_long rowcount, UF_long colcount)
+{
+	UF_long ok, nnz;
+	size_t entry_size, total_size;
+	double lunz;
+
+	// Need at least one row, one right-hand side (colcount), and the column pointers
+	if ((rowcount <= 0) || (colcount <= 0) || (system_info_vars->cols_LU == NULL))
+	{
+		KLUValues->CommonVal->status = KLU_INVALID;
+		return KLU_INVALID;
+	}
+
+	// Nonzero count of A - negative means the column pointers already wrapped
+	nnz = system_info_vars->cols_LU[rowcount];
+	if (nnz < 0)
+	{
+		KLUValues->CommonVal->status = KLU_TOO_LARGE;
+		return KLU_TOO_LARGE;
+	}
+
+	ok = 1;
+
+	// Storage for one entry of L or U - value plus row index
+	entry_size = klu_l_add_size_t(sizeof(double), sizeof(UF_long), &ok);
+
+	// Copy of A (values and row indices) plus the column pointers
+	total_size = klu_l_mult_size_t((size_t)nnz, entry_size, &ok);
+	total_size = klu_l_add_size_t(total_size, klu_l_mult_size_t((size_t)rowcount + 1, sizeof(UF_long), &ok), &ok);
+
+	// Add in the estimated fill, once the analysis has been done
+	if (KLUValues->SymbolicVal != NULL)
+	{
+		lunz = KLUValues->SymbolicVal->lnz + KLUValues->SymbolicVal->unz;
+
+		// Has to be indexable by UF_long, and not a NaN
+		if (!(lunz * (1.0 + 1e-8) <= (double)UF_long_max))
+		{
+			ok = 0;
+		}
+		else
+		{
+			total_size = klu_l_add_size_t(total_size, klu_l_mult_size_t((size_t)lunz, entry_size, &ok), &ok);
+		}
+	}
+
+	// See if anything overflowed
+	if (!ok)
+	{
+		KLUValues->CommonVal->status = KLU_TOO_LARGE;
+		return KLU_TOO_LARGE;
+	}
+
+	return KLU_OK;
+}
+
+// Initialization function
+// Sets Common property (options)
+void *LU_init_l(void *ext_array)
+{
+	// Recasting variable
+	KLU_STRUCT_L *KLUValues;
+
+	// See if the external array is linked yet
+	if (ext_array==NULL)	//Nope
+	{
+		// Create an array
+		KLUValues = (KLU_STRUCT_L*)malloc(sizeof(KLU_STRUCT_L));
+
+		// Make sure it worked
+		if (KLUValues==NULL)
+		{
+			//Needs to be caught externally
+			return NULL;
+		}
+
+		// Store the value
+		ext_array = (void *)(KLUValues);
+
+		// Zero the entries
+		KLUValues->CommonVal = NULL;
+		KLUValues->SymbolicVal = NULL;
+		KLUValues->NumericVal = NULL;
+
+		// Flag as none initially
+		KLUValues->AdmittanceChange = false;
+
+		// Templated solves unless LU_reproducible_l says otherwise
+		KLUValues->Reproducible = false;
+	}
+
+	// Already linked, link the variable to it
+	else
+	{
+		// Link the structure up
+		KLUValues = (KLU_STRUCT_L*)ext_array;
+	}
+
+	// Determine if the common property is allocated yet
+	if (KLUValues->CommonVal==NULL)
+	{
+		// Allocate it
+		KLUValues->CommonVal = (klu_l_common *)malloc(sizeof(klu_l_common));
+
+		// Make sure it worked
+		if (KLUValues->CommonVal==NULL)
+		{
+			// Needs to be caught externally
+			return NULL;
+		}
+	}
+
+	// Set the defaults
+	klu_l_defaults(KLUValues->CommonVal);
+
+	return ext_array;
+}
+
+// Allocation function
+// Just like the 32-bit version, only captures the admittance change
+void LU_alloc_l(void *ext_array, UF_long rowcount, UF_long colcount, bool admittance_change)
+{
+	// Recasting variable
+	KLU_STRUCT_L *KLUValues;
+
+	// Link the structure up
+	KLUValues = (KLU_STRUCT_L*)ext_array;
+
+	// Capture the admittance change - need it later
+	KLUValues->AdmittanceChange = admittance_change;
+}
+
+// Solution function
+// Same as LU_solve, with size checks before the analysis and before the factorization
+UF_long LU_solve_l(void *ext_array, NR_SOLVER_VARS_L *system_info_vars, UF_long rowcount, UF_long colcount)
+{
+	// Recasting variable
+	KLU_STRUCT_L *KLUValues;
+
+	// Link the structure up
+	KLUValues = (KLU_STRUCT_L*)ext_array;
+
+	// See if the admittance has changed
+	if (KLUValues->AdmittanceChange)
+	{
+		// Not first run - remove the old
+		if (KLUValues->SymbolicVal!=NULL)
+		{
+			klu_l_free_symbolic (&(KLUValues->SymbolicVal), KLUValues->CommonVal);
+		}
+
+		// Make sure the matrix itself is sane before analyzing it
+		if (LU_check_size_l(KLUValues, system_info_vars, rowcount, colcount) != KLU_OK)
+		{
+			return KLUValues->CommonVal->status;
+		}
+
+		// Allocate
+		KLUValues->SymbolicVal = klu_l_analyze (rowcount, system_info_vars->cols_LU, system_info_vars->rows_LU, KLUValues->CommonVal);
+
+		// Make sure it worked
+		if (KLUValues->SymbolicVal==NULL)
+		{
+			return KLUValues->CommonVal->status;
+		}
+	}
+
+	// Check the estimated fill - bail before klu_l_factor tries to allocate something it can't index
+	if (LU_check_size_l(KLUValues, system_info_vars, rowcount, colcount) != KLU_OK)
+	{
+		return KLUValues->CommonVal->status;
+	}
+
+	// Create numeric one no matter what
+	KLUValues->NumericVal = klu_l_factor(system_info_vars->cols_LU,system_info_vars->rows_LU,system_info_vars->a_LU,KLUValues->SymbolicVal,KLUValues->CommonVal);
+
+	// Solve the matrix
+	if (KLUValues->NumericVal!=NULL)
+	{
+		if (KLUValues->Reproducible)
+		{
+			klu_l_solve(KLUValues->SymbolicVal,KLUValues->NumericVal, rowcount, colcount, system_info_vars->rhs_LU,KLUValues->CommonVal);
+		}
+		else
+		{
+			KLU_Template::Solve(KLUValues->SymbolicVal,KLUValues->NumericVal, rowcount, colcount, system_info_vars->rhs_LU,KLUValues->CommonVal);
+		}
+	}
+
+	// Same status codes as the 32-bit version
+	return KLUValues->CommonVal->status;
+}
+
+// Destruction function
+// Frees up numeric array
+void LU_destroy_l(void *ext_array, bool new_iteration)
+{
+	// Recasting variable
+	KLU_STRUCT_L *KLUValues;
+
+	// Link the structure up
+	KLUValues = (KLU_STRUCT_L*)ext_array;
+
+	// KLU destructive commands
+	klu_l_free_numeric(&(KLUValues->NumericVal),KLUValues->CommonVal);
+}
+
+// Reproducibility function
+// Same as LU_reproducible
+void LU_reproducible_l(void *ext_array, bool enable)
+{
+	// Recasting variable
+	KLU_STRUCT_L *KLUValues;
+
+	// Link the structure up
+	KLUValues = (KLU_STRUCT_L*)ext_array;
+
+	KLUValues->Reproducible = enable;
+}
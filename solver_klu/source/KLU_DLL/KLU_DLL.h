@@ -7,13 +7,76 @@ typedef struct {
 	int *rows_LU;
 } NR_SOLVER_VARS;
 
+// Background diagnostics state - defined in KLU_Diagnostics.cpp
+struct KLU_DIAGNOSTICS;
+
 typedef struct {
 	klu_common *CommonVal;
 	klu_symbolic *SymbolicVal;
 	klu_numeric *NumericVal;
 	bool AdmittanceChange;
+	unsigned int Iteration;				// Number of LU_solve calls so far
+	struct KLU_DIAGNOSTICS *Diagnostics;	// NULL unless LU_diagnostics_enable was called
+	bool Reproducible;					// LU_reproducible - klu_solve instead of the templated kernels
 } KLU_STRUCT;
 
+// Condition estimate and pivot growth of one factorization, as computed by klu_condest/klu_rgrowth
+typedef struct {
+	unsigned int iteration;	// KLU_STRUCT Iteration of the factorization these belong to
+	double condest;			// Estimate of the 1-norm condition number
+	double rgrowth;			// Reciprocal pivot growth
+	int status;				// KLU status of the two calls
+} KLU_DIAGNOSTICS_RESULT;
+
+// 64-bit index versions of the above - for systems whose L+U fill exceeds the int range
+typedef struct {
+	double *a_LU;
+	double *rhs_LU;
+	UF_long *cols_LU;
+	UF_long *rows_LU;
+} NR_SOLVER_VARS_L;
+
+typedef struct {
+	klu_l_common *CommonVal;
+	klu_l_symbolic *SymbolicVal;
+	klu_l_numeric *NumericVal;
+	bool AdmittanceChange;
+	bool Reproducible;		// LU_reproducible_l - klu_l_solve instead of the templated kernels
+} KLU_STRUCT_L;
+
+// Batched version - nsys systems sharing one sparsity pattern (cols_LU/rows_LU)
+// Values are stored system-fastest: a_LU[p*nsys + s] is entry p of system s, rhs_LU[i*nsys + s] is row i of system s
+typedef struct {
+	double *a_LU;
+	double *rhs_LU;
+	int *cols_LU;
+	int *rows_LU;
+} NR_SOLVER_VARS_BATCH;
+
+typedef struct {
+	klu_common *CommonVal;
+	klu_symbolic *SymbolicVal;
+	bool AdmittanceChange;
+	unsigned int n;			// System size the pattern below was built for
+	unsigned int nsys;		// Number of systems the value arrays were allocated for
+	int *P;					// Row permutation (row P[k] of A is row k of the factors)
+	int *Pinv;				// Inverse of P
+	int *Q;					// Column permutation
+	int *Lp, *Li;			// Pattern of L, unit diagonal first in each column
+	int *Up, *Ui;			// Pattern of U, rows ascending so the diagonal is last
+	double *Lx, *Ux;		// Factor values, system-fastest like a_LU
+	double *X;				// Workspace, n*nsys
+	double *Work;			// Per-system scratch for the pivot checks and the fallback path
+	bool *Failed;			// Systems whose pivot failed the tolerance check
+	unsigned int PivotSystem;	// System whose klu_factor gave the pivot order - klu found the ones before it singular
+	unsigned int FallbackCount;	// Systems solved by the fallback path on the last call
+	bool Reproducible;		// LU_reproducible_batch - every system through the fallback path
+} KLU_STRUCT_BATCH;
+
+// Overflow-checked size arithmetic from klu_memory.c (KLU_add_size_t/KLU_mult_size_t) - not exposed by klu.h
+extern "C" size_t klu_l_add_size_t(size_t a, size_t b, UF_long *ok);
+extern "C" size_t klu_l_mult_size_t(size_t a, size_t k, UF_long *ok);
+
 //Initialization function
 extern "C" __declspec(dllexport) void *LU_init(void *ext_array);
 
@@ -26,3 +89,50 @@ extern "C" __declspec(dllexport) int LU_solve(void *ext_array, NR_SOLVER_VARS *s
 // Destructive function
 extern "C" __declspec(dllexport) void LU_destroy(void *ext_array, bool new_iteration);
 
+// Reproducibility function - call after LU_init, LU_solve then uses klu_solve itself
+extern "C" __declspec(dllexport) void LU_reproducible(void *ext_array, bool enable);
+
+// Diagnostics enable function - starts or stops the background condest/rgrowth thread
+extern "C" __declspec(dllexport) int LU_diagnostics_enable(void *ext_array, bool enable);
+
+// Diagnostics function - latest completed result, returns 0 if there isn't one yet
+extern "C" __declspec(dllexport) int LU_diagnostics(void *ext_array, KLU_DIAGNOSTICS_RESULT *result);
+
+// Hands the current factorization to the diagnostics thread (KLU_Diagnostics.cpp)
+bool LU_diagnostics_post(KLU_STRUCT *KLUValues, NR_SOLVER_VARS *system_info_vars, unsigned int rowcount);
+
+// Waits for the diagnostics thread to finish with the current Symbolic (KLU_Diagnostics.cpp)
+void LU_diagnostics_wait(KLU_STRUCT *KLUValues);
+
+// 64-bit index initialization function
+extern "C" __declspec(dllexport) void *LU_init_l(void *ext_array);
+
+// 64-bit index allocation function
+extern "C" __declspec(dllexport) void LU_alloc_l(void *ext_array, UF_long rowcount, UF_long colcount, bool admittance_change);
+
+// 64-bit index solver function
+extern "C" __declspec(dllexport) UF_long LU_solve_l(void *ext_array, NR_SOLVER_VARS_L *system_info_vars, UF_long rowcount, UF_long colcount);
+
+// 64-bit index destructive function
+extern "C" __declspec(dllexport) void LU_destroy_l(void *ext_array, bool new_iteration);
+
+// 64-bit index reproducibility function
+extern "C" __declspec(dllexport) void LU_reproducible_l(void *ext_array, bool enable);
+
+// Batched initialization function
+extern "C" __declspec(dllexport) void *LU_init_batch(void *ext_array);
+
+// Batched allocation function
+extern "C" __declspec(dllexport) void LU_alloc_batch(void *ext_array, unsigned int rowcount, unsigned int nsys, bool admittance_change);
+
+// Batched solver function
+extern "C" __declspec(dllexport) int LU_solve_batch(void *ext_array, NR_SOLVER_VARS_BATCH *system_info_vars, unsigned int rowcount, unsigned int nsys);
+
+// Batched destructive function
+extern "C" __declspec(dllexport) void LU_destroy_batch(void *ext_array, bool new_iteration);
+
+// Batched teardown function - frees the pattern, the workspace and ext_array itself
+extern "C" __declspec(dllexport) void LU_free_batch(void *ext_array);
+
+// Batched reproducibility function - every system goes through klu_factor/klu_solve on its own
+extern "C" __declspec(dllexport) void LU_reproducible_batch(void *ext_array, bool enable);
@@ -0,0 +1,302 @@
+// KLU_Diagnostics.cpp
+//
+// Condition estimate and pivot growth off the critical path.  klu_condest costs a few
+// solves' worth of work, so calling it after every factorization slows down every
+// Newton-Raphson iteration just to watch for an ill-conditioned Jacobian.
+//
+// Instead, LU_solve hands its Numeric object to a worker thread once the solve is done
+// (ownership moves, so LU_destroy has nothing left to free) along with a copy of A, and
+// the next iteration goes ahead while klu_condest/klu_rgrowth run.  Each result carries
+// the iteration number of the factorization it came from, so the caller can act on it
+// one iteration late.
+//
+// Only one factorization is in flight at a time.  If the worker is still busy when the
+// next one is posted, that one is freed by LU_destroy as usual and not diagnosed - the
+// solve never waits on the diagnostics, except when the Symbolic object is replaced.
+
+#include <windows.h>
+#include <process.h>
+#include <stdlib.h>
+#include <string.h>
+#include "klu.h"
+#include "KLU_DLL.h"
+
+struct KLU_DIAGNOSTICS {
+	HANDLE Thread;
+	HANDLE WorkReady;			// Auto-reset, set when a job is posted or on shutdown
+	HANDLE WorkDone;			// Manual-reset, set while the worker is idle
+	CRITICAL_SECTION Lock;		// Guards Result and HaveResult
+	bool Shutdown;
+
+	// Job in flight - belongs to the worker while WorkDone is reset
+	klu_common CommonVal;		// Own copy, klu_condest/klu_rgrowth write their results here
+	klu_symbolic *SymbolicVal;	// Shared with LU_solve, which waits before freeing it
+	klu_numeric *NumericVal;	// Handed over by LU_solve, freed by the worker
+	int *Ap, *Ai;				// Copy of A - the caller rebuilds its arrays every iteration
+	double *Ax;
+	int n, nnz;					// Capacity of the copies above
+	unsigned int JobIteration;
+
+	// Latest completed result
+	KLU_DIAGNOSTICS_RESULT Result;
+	bool HaveResult;
+};
+
+// Worker thread
+// Waits for a job, runs the diagnostics, frees the Numeric object and publishes the result
+static unsigned __stdcall LU_diagnostics_worker(void *arg)
+{
+	KLU_DIAGNOSTICS *Diag;
+	KLU_DIAGNOSTICS_RESULT Result;
+
+	Diag = (KLU_DIAGNOSTICS *)arg;
+
+	for (;;)
+	{
+		WaitForSingleObject(Diag->WorkReady, INFINITE);
+
+		// See if we're being shut down - only ever set while idle
+		if (Diag->Shutdown)
+		{
+			break;
+		}
+
+		Result.iteration = Diag->JobIteration;
+		Result.condest = 0.0;
+		Result.rgrowth = 0.0;
+
+		// Condition estimate first, pivot growth only if that worked
+		klu_condest(Diag->Ap, Diag->Ax, Diag->SymbolicVal, Diag->NumericVal, &(Diag->CommonVal));
+		if (Diag->CommonVal.status == KLU_OK)
+		{
+			Result.condest = Diag->CommonVal.condest;
+			klu_rgrowth(Diag->Ap, Diag->Ai, Diag->Ax, Diag->SymbolicVal, Diag->NumericVal, &(Diag->CommonVal));
+			Result.rgrowth = Diag->CommonVal.rgrowth;
+		}
+		Result.status = Diag->CommonVal.status;
+
+		// Done with the factorization
+		klu_free_numeric(&(Diag->NumericVal), &(Diag->CommonVal));
+
+		// Publish it
+		EnterCriticalSection(&(Diag->Lock));
+		Diag->Result = Result;
+		Diag->HaveResult = true;
+		LeaveCriticalSection(&(Diag->Lock));
+
+		SetEvent(Diag->WorkDone);
+	}
+
+	return 0;
+}
+
+// Shuts the worker down and frees everything
+static void LU_diagnostics_free(KLU_DIAGNOSTICS *Diag)
+{
+	// Stop the thread, once it's done with whatever it has
+	if (Diag->Thread != NULL)
+	{
+		WaitForSingleObject(Diag->WorkDone, INFINITE);
+		Diag->Shutdown = true;
+		SetEvent(Diag->WorkReady);
+		WaitForSingleObject(Diag->Thread, INFINITE);
+		CloseHandle(Diag->Thread);
+	}
+
+	if (Diag->WorkReady != NULL)
+	{
+		CloseHandle(Diag->WorkReady);
+	}
+
+	if (Diag->WorkDone != NULL)
+	{
+		CloseHandle(Diag->WorkDone);
+	}
+
+	DeleteCriticalSection(&(Diag->Lock));
+
+	free(Diag->Ap);
+	free(Diag->Ai);
+	free(Diag->Ax);
+	free(Diag);
+}
+
+// Diagnostics enable function
+// Starts (enable=true) or stops the worker thread for this solver instance
+// Returns 1 on success, 0 if the thread couldn't be started
+int LU_diagnostics_enable(void *ext_array, bool enable)
+{
+	// Recasting variable
+	KLU_STRUCT *KLUValues;
+	KLU_DIAGNOSTICS *Diag;
+
+	// Link the structure up
+	KLUValues = (KLU_STRUCT*)ext_array;
+
+	if (!enable)
+	{
+		// Stop it, if it's running
+		if (KLUValues->Diagnostics != NULL)
+		{
+			LU_diagnostics_free(KLUValues->Diagnostics);
+			KLUValues->Diagnostics = NULL;
+		}
+
+		return 1;
+	}
+
+	// Already running
+	if (KLUValues->Diagnostics != NULL)
+	{
+		return 1;
+	}
+
+	// Create the state
+	Diag = (KLU_DIAGNOSTICS *)malloc(sizeof(KLU_DIAGNOSTICS));
+
+	// Make sure it worked
+	if (Diag == NULL)
+	{
+		return 0;
+	}
+
+	memset(Diag, 0, sizeof(KLU_DIAGNOSTICS));
+	InitializeCriticalSection(&(Diag->Lock));
+
+	// Worker starts idle
+	Diag->WorkReady = CreateEvent(NULL, FALSE, FALSE, NULL);
+	Diag->WorkDone = CreateEvent(NULL, TRUE, TRUE, NULL);
+
+	if ((Diag->WorkReady == NULL) || (Diag->WorkDone == NULL))
+	{
+		LU_diagnostics_free(Diag);
+		return 0;
+	}
+
+	// _beginthreadex rather than CreateThread, since the worker goes through the CRT (malloc/free)
+	Diag->Thread = (HANDLE)_beginthreadex(NULL, 0, LU_diagnostics_worker, Diag, 0, NULL);
+
+	if (Diag->Thread == NULL)
+	{
+		LU_diagnostics_free(Diag);
+		return 0;
+	}
+
+	KLUValues->Diagnostics = Diag;
+
+	return 1;
+}
+
+// Diagnostics function
+// Copies out the latest completed result - result->iteration says which LU_solve call it's for
+// Returns 1 if there is a result, 0 if diagnostics are off or nothing has finished yet
+int LU_diagnostics(void *ext_array, KLU_DIAGNOSTICS_RESULT *result)
+{
+	// Recasting variable
+	KLU_STRUCT *KLUValues;
+	KLU_DIAGNOSTICS *Diag;
+	bool have_result;
+
+	// Link the structure up
+	KLUValues = (KLU_STRUCT*)ext_array;
+	Diag = KLUValues->Diagnostics;
+
+	if (Diag == NULL)
+	{
+		return 0;
+	}
+
+	EnterCriticalSection(&(Diag->Lock));
+	have_result = Diag->HaveResult;
+	if (have_result)
+	{
+		*result = Diag->Result;
+	}
+	LeaveCriticalSection(&(Diag->Lock));
+
+	return have_result ? 1 : 0;
+}
+
+// Post function
+// Called by LU_solve after a successful solve.  Copies A, takes over the Numeric object
+// (KLUValues->NumericVal is NULLed, so LU_destroy skips it) and wakes the worker.
+// Returns false without touching anything if diagnostics are off or the worker is busy.
+bool LU_diagnostics_post(KLU_STRUCT *KLUValues, NR_SOLVER_VARS *system_info_vars, unsigned int rowcount)
+{
+	KLU_DIAGNOSTICS *Diag;
+	int n, nnz;
+	void *temp_ptr;
+
+	Diag = KLUValues->Diagnostics;
+
+	if ((Diag == NULL) || (KLUValues->NumericVal == NULL))
+	{
+		return false;
+	}
+
+	// Still working on an earlier one - skip this one rather than wait
+	if (WaitForSingleObject(Diag->WorkDone, 0) != WAIT_OBJECT_0)
+	{
+		return false;
+	}
+
+	n = (int)rowcount;
+	nnz = system_info_vars->cols_LU[n];
+
+	// Grow the copies of A if needed
+	if (n > Diag->n)
+	{
+		temp_ptr = realloc(Diag->Ap, sizeof(int)*(n+1));
+		if (temp_ptr == NULL)
+		{
+			return false;
+		}
+		Diag->Ap = (int *)temp_ptr;
+		Diag->n = n;
+	}
+
+	if (nnz > Diag->nnz)
+	{
+		temp_ptr = realloc(Diag->Ai, sizeof(int)*nnz);
+		if (temp_ptr == NULL)
+		{
+			return false;
+		}
+		Diag->Ai = (int *)temp_ptr;
+
+		temp_ptr = realloc(Diag->Ax, sizeof(double)*nnz);
+		if (temp_ptr == NULL)
+		{
+			return false;
+		}
+		Diag->Ax = (double *)temp_ptr;
+		Diag->nnz = nnz;
+	}
+
+	memcpy(Diag->Ap, system_info_vars->cols_LU, sizeof(int)*(n+1));
+	memcpy(Diag->Ai, system_info_vars->rows_LU, sizeof(int)*nnz);
+	memcpy(Diag->Ax, system_info_vars->a_LU, sizeof(double)*nnz);
+
+	// Hand the factorization over - same options as the solve, memory accounting goes with it
+	Diag->CommonVal = *(KLUValues->CommonVal);
+	Diag->SymbolicVal = KLUValues->SymbolicVal;
+	Diag->NumericVal = KLUValues->NumericVal;
+	Diag->JobIteration = KLUValues->Iteration;
+	KLUValues->NumericVal = NULL;
+
+	// Wake the worker
+	ResetEvent(Diag->WorkDone);
+	SetEvent(Diag->WorkReady);
+
+	return true;
+}
+
+// Wait function
+// Blocks until the worker is idle - needed before the Symbolic object it may be using is freed
+void LU_diagnostics_wait(KLU_STRUCT *KLUValues)
+{
+	if (KLUValues->Diagnostics != NULL)
+	{
+		WaitForSingleObject(KLUValues->Diagnostics->WorkDone, INFINITE);
+	}
+}
@@ -0,0 +1,549 @@
+// KLU_Template.h
+//
+// C++ template versions of the KLU triangular solves (klu.c), klu_solve.c and
+// klu_tsolve.c for the KLU DLL wrapper.
+//
+// The C sources are compiled once per Entry/Int combination through the
+// DCOMPLEX/DLONG macros, and every kernel switches on the number of
+// right-hand sides at run time.  Here the scalar type, the index type and the
+// right-hand side count (NRHS, 1 to 4) are template parameters, so each
+// instantiation gets fixed-length inner loops over NRHS that the compiler can
+// unroll and vectorize.  The arithmetic is done in the same order as the C
+// code, so results match klu_solve/klu_tsolve.
+//
+// The factors are read straight out of the klu_symbolic/klu_numeric (or the
+// klu_l_ versions) objects, so nothing about the C ABI changes.  Real systems
+// use double, complex systems use std::complex<double> (same layout as the
+// KLU Double_Complex entries).  float instantiations compile as well, but KLU
+// itself only produces double factors.
+
+#ifndef _KLU_TEMPLATE_H
+#define _KLU_TEMPLATE_H
+
+#include <complex>
+#include <math.h>
+#include "klu.h"
+
+namespace KLU_Template {
+
+// Scalar operations - mirror the MULT_SUB/DIV/SCALE_DIV_ASSIGN macros of klu_version.h
+template <class Entry> struct EntryOps
+{
+	// c -= a*b
+	static inline void MultSub(Entry &c, Entry a, Entry b) { c -= a * b; }
+
+	// c -= a*conj(b) - same as MultSub for real entries
+	static inline void MultSubConj(Entry &c, Entry a, Entry b) { c -= a * b; }
+
+	// c = a/b
+	static inline void Div(Entry &c, Entry a, Entry b) { c = a / b; }
+
+	// c = conj(a)
+	static inline Entry Conj(Entry a) { return a; }
+
+	// a = c/s
+	static inline void ScaleDivAssign(Entry &a, Entry c, double s) { a = c / (Entry)s; }
+};
+
+// Complex - written out component-wise like the KLU macros, both to keep the results
+// identical and to avoid the NaN/Inf handling std::complex does on multiplication
+template <class Real> struct EntryOps< std::complex<Real> >
+{
+	typedef std::complex<Real> Entry;
+
+	static inline void MultSub(Entry &c, Entry a, Entry b)
+	{
+		c = Entry(c.real() - (a.real() * b.real() - a.imag() * b.imag()),
+				  c.imag() - (a.imag() * b.real() + a.real() * b.imag()));
+	}
+
+	static inline void MultSubConj(Entry &c, Entry a, Entry b)
+	{
+		c = Entry(c.real() - (a.real() * b.real() + a.imag() * b.imag()),
+				  c.imag() - (a.imag() * b.real() - a.real() * b.imag()));
+	}
+
+	// ACM Algorithm 116 (R. L. Smith, 1962), as in the KLU DIV macro
+	static inline void Div(Entry &c, Entry a, Entry b)
+	{
+		Real r, den, ar, ai, br, bi;
+
+		br = b.real();
+		bi = b.imag();
+		ar = a.real();
+		ai = a.imag();
+
+		if (fabs(br) >= fabs(bi))
+		{
+			r = bi / br;
+			den = br + r * bi;
+			c = Entry((ar + ai * r) / den, (ai - ar * r) / den);
+		}
+		else
+		{
+			r = br / bi;
+			den = r * br + bi;
+			c = Entry((ar * r + ai) / den, (ai * r - ar) / den);
+		}
+	}
+
+	static inline Entry Conj(Entry a) { return Entry(a.real(), -a.imag()); }
+
+	static inline void ScaleDivAssign(Entry &a, Entry c, double s)
+	{
+		a = Entry(c.real() / (Real)s, c.imag() / (Real)s);
+	}
+};
+
+// Index type of the Symbolic object - int for klu_*, UF_long for klu_l_*
+template <class Symbolic> struct SymbolicIndex;
+template <> struct SymbolicIndex<klu_symbolic> { typedef int Int; };
+template <> struct SymbolicIndex<klu_l_symbolic> { typedef UF_long Int; };
+
+// Locates column k of L or U in the packed LU array (GET_POINTER) - indices first, padded
+// out to a whole number of entries, then the values.
+//
+// The kernels walk Xi and Xx with separate pointers rather than indexing both by p.
+// Given Xi[p] and Xx[p], GCC 12.2's ivopts writes the Xx load as an offset from Xi's
+// induction variable on a literal null base (MEM[(Entry *)0B + ...]).  The late
+// pure-const and modref passes both take that for a null dereference, stop reading the
+// block there, and so record the kernel as writing no memory; callers in the same
+// translation unit then drop the call.  Nothing here is undefined - the same loop in
+// plain C, on malloc'd storage, is clean under UBSan and ASan and gives the right
+// answer at -O0 and -O1 but not -O2 - and it goes away with -fno-ivopts, or with both
+// -fno-ipa-pure-const and -fno-ipa-modref.  With separate pointers no instantiation
+// has a null-based access at -O1 to -O3; KLU/Demo/klu_template checks the results.
+template <class Int, class Entry> inline void GetPointer(Entry *LU, Int *Xip, Int *Xlen, Int k, Int *&Xi, Entry *&Xx, Int &len)
+{
+	Entry *xp = LU + Xip[k];
+
+	len = Xlen[k];
+	Xi = (Int *)xp;
+	Xx = xp + (sizeof(Int) * len + sizeof(Entry) - 1) / sizeof(Entry);
+}
+
+// Solve Lx=b - L unit lower triangular, NRHS right-hand sides interleaved in X
+template <int NRHS, class Int, class Entry> void LSolve(Int n, Int *Lip, Int *Llen, Entry *LU, Entry *X)
+{
+	Entry x[NRHS], lik;
+	Int *Li;
+	Entry *Lx;
+	Int k, p, len, i;
+	int r;
+
+	for (k = 0; k < n; k++)
+	{
+		for (r = 0; r < NRHS; r++)
+			x[r] = X[NRHS*k + r];
+
+		GetPointer(LU, Lip, Llen, k, Li, Lx, len);
+
+		// unit diagonal of L is not stored
+		for (p = 0; p < len; p++)
+		{
+			i = *Li++;
+			lik = *Lx++;
+			for (r = 0; r < NRHS; r++)
+				EntryOps<Entry>::MultSub(X[NRHS*i + r], lik, x[r]);
+		}
+	}
+}
+
+// Solve Ux=b - U upper triangular, diagonal stored separately in Udiag
+template <int NRHS, class Int, class Entry> void USolve(Int n, Int *Uip, Int *Ulen, Entry *LU, Entry *Udiag, Entry *X)
+{
+	Entry x[NRHS], uik, ukk;
+	Int *Ui;
+	Entry *Ux;
+	Int k, p, len, i;
+	int r;
+
+	for (k = n-1; k >= 0; k--)
+	{
+		GetPointer(LU, Uip, Ulen, k, Ui, Ux, len);
+		ukk = Udiag[k];
+
+		for (r = 0; r < NRHS; r++)
+		{
+			EntryOps<Entry>::Div(x[r], X[NRHS*k + r], ukk);
+			X[NRHS*k + r] = x[r];
+		}
+
+		for (p = 0; p < len; p++)
+		{
+			i = *Ui++;
+			uik = *Ux++;
+			for (r = 0; r < NRHS; r++)
+				EntryOps<Entry>::MultSub(X[NRHS*i + r], uik, x[r]);
+		}
+	}
+}
+
+// Solve L'x=b (or L^Hx=b if conj_solve)
+template <int NRHS, class Int, class Entry> void LTSolve(Int n, Int *Lip, Int *Llen, Entry *LU, bool conj_solve, Entry *X)
+{
+	Entry x[NRHS], lik;
+	Int *Li;
+	Entry *Lx;
+	Int k, p, len, i;
+	int r;
+
+	for (k = n-1; k >= 0; k--)
+	{
+		GetPointer(LU, Lip, Llen, k, Li, Lx, len);
+
+		for (r = 0; r < NRHS; r++)
+			x[r] = X[NRHS*k + r];
+
+		for (p = 0; p < len; p++)
+		{
+			i = *Li++;
+			lik = *Lx++;
+			if (conj_solve)
+			{
+				for (r = 0; r < NRHS; r++)
+					EntryOps<Entry>::MultSubConj(x[r], X[NRHS*i + r], lik);
+			}
+			else
+			{
+				for (r = 0; r < NRHS; r++)
+					EntryOps<Entry>::MultSub(x[r], lik, X[NRHS*i + r]);
+			}
+		}
+
+		for (r = 0; r < NRHS; r++)
+			X[NRHS*k + r] = x[r];
+	}
+}
+
+// Solve U'x=b (or U^Hx=b if conj_solve)
+template <int NRHS, class Int, class Entry> void UTSolve(Int n, Int *Uip, Int *Ulen, Entry *LU, Entry *Udiag, bool conj_solve, Entry *X)
+{
+	Entry x[NRHS], uik, ukk;
+	Int *Ui;
+	Entry *Ux;
+	Int k, p, len, i;
+	int r;
+
+	for (k = 0; k < n; k++)
+	{
+		GetPointer(LU, Uip, Ulen, k, Ui, Ux, len);
+
+		for (r = 0; r < NRHS; r++)
+			x[r] = X[NRHS*k + r];
+
+		for (p = 0; p < len; p++)
+		{
+			i = *Ui++;
+			uik = *Ux++;
+			if (conj_solve)
+			{
+				for (r = 0; r < NRHS; r++)
+					EntryOps<Entry>::MultSubConj(x[r], X[NRHS*i + r], uik);
+			}
+			else
+			{
+				for (r = 0; r < NRHS; r++)
+					EntryOps<Entry>::MultSub(x[r], uik, X[NRHS*i + r]);
+			}
+		}
+
+		ukk = conj_solve ? EntryOps<Entry>::Conj(Udiag[k]) : Udiag[k];
+
+		for (r = 0; r < NRHS; r++)
+			EntryOps<Entry>::Div(X[NRHS*k + r], x[r], ukk);
+	}
+}
+
+// One chunk of NRHS columns of klu_solve - X = Q*((L*U + Off)\(P*(R\B)))
+// B has leading dimension d, X is the Numeric->Xwork workspace
+template <int NRHS, class Entry, class Symbolic, class Numeric> void SolveChunk(Symbolic *SymbolicVal, Numeric *NumericVal, typename SymbolicIndex<Symbolic>::Int d, Entry *Bz)
+{
+	typedef typename SymbolicIndex<Symbolic>::Int Int;
+	Entry x[NRHS], offik, s;
+	Entry *Offx, *X, *Udiag;
+	Entry **LUbx;
+	double *Rs;
+	Int *Q, *R, *Pnum, *Offp, *Offi, *Lip, *Uip, *Llen, *Ulen;
+	Int k1, k2, nk, k, block, pend, n, p, nblocks, i;
+	int r;
+
+	n = SymbolicVal->n;
+	nblocks = SymbolicVal->nblocks;
+	Q = SymbolicVal->Q;
+	R = SymbolicVal->R;
+
+	Pnum = NumericVal->Pnum;
+	Offp = NumericVal->Offp;
+	Offi = NumericVal->Offi;
+	Offx = (Entry *)NumericVal->Offx;
+	Lip = NumericVal->Lip;
+	Llen = NumericVal->Llen;
+	Uip = NumericVal->Uip;
+	Ulen = NumericVal->Ulen;
+	LUbx = (Entry **)NumericVal->LUbx;
+	Udiag = (Entry *)NumericVal->Udiag;
+	Rs = NumericVal->Rs;
+	X = (Entry *)NumericVal->Xwork;
+
+	// Scale and permute the right hand side, X = P*(R\B)
+	if (Rs == NULL)
+	{
+		for (k = 0; k < n; k++)
+		{
+			i = Pnum[k];
+			for (r = 0; r < NRHS; r++)
+				X[NRHS*k + r] = Bz[i + d*r];
+		}
+	}
+	else
+	{
+		for (k = 0; k < n; k++)
+		{
+			i = Pnum[k];
+			for (r = 0; r < NRHS; r++)
+				EntryOps<Entry>::ScaleDivAssign(X[NRHS*k + r], Bz[i + d*r], Rs[k]);
+		}
+	}
+
+	// Solve X = (L*U + Off)\X, last block first
+	for (block = nblocks-1; block >= 0; block--)
+	{
+		k1 = R[block];
+		k2 = R[block+1];
+		nk = k2 - k1;
+
+		// Solve the block system
+		if (nk == 1)
+		{
+			s = Udiag[k1];
+			for (r = 0; r < NRHS; r++)
+				EntryOps<Entry>::Div(X[NRHS*k1 + r], X[NRHS*k1 + r], s);
+		}
+		else
+		{
+			LSolve<NRHS>(nk, Lip + k1, Llen + k1, LUbx[block], X + NRHS*k1);
+			USolve<NRHS>(nk, Uip + k1, Ulen + k1, LUbx[block], Udiag + k1, X + NRHS*k1);
+		}
+
+		// Block back-substitution for the off-diagonal-block entries
+		if (block > 0)
+		{
+			for (k = k1; k < k2; k++)
+			{
+				pend = Offp[k+1];
+				for (r = 0; r < NRHS; r++)
+					x[r] = X[NRHS*k + r];
+
+				for (p = Offp[k]; p < pend; p++)
+				{
+					i = Offi[p];
+					offik = Offx[p];
+					for (r = 0; r < NRHS; r++)
+						EntryOps<Entry>::MultSub(X[NRHS*i + r], offik, x[r]);
+				}
+			}
+		}
+	}
+
+	// Permute the result, B = Q*X
+	for (k = 0; k < n; k++)
+	{
+		i = Q[k];
+		for (r = 0; r < NRHS; r++)
+			Bz[i + d*r] = X[NRHS*k + r];
+	}
+}
+
+// One chunk of NRHS columns of klu_tsolve - X = R\(P'*((L*U + Off)'\(Q'*B)))
+template <int NRHS, class Entry, class Symbolic, class Numeric> void TSolveChunk(Symbolic *SymbolicVal, Numeric *NumericVal, typename SymbolicIndex<Symbolic>::Int d, bool conj_solve, Entry *Bz)
+{
+	typedef typename SymbolicIndex<Symbolic>::Int Int;
+	Entry x[NRHS], offik, s;
+	Entry *Offx, *X, *Udiag;
+	Entry **LUbx;
+	double *Rs;
+	Int *Q, *R, *Pnum, *Offp, *Offi, *Lip, *Uip, *Llen, *Ulen;
+	Int k1, k2, nk, k, block, pend, n, p, nblocks, i;
+	int r;
+
+	n = SymbolicVal->n;
+	nblocks = SymbolicVal->nblocks;
+	Q = SymbolicVal->Q;
+	R = SymbolicVal->R;
+
+	Pnum = NumericVal->Pnum;
+	Offp = NumericVal->Offp;
+	Offi = NumericVal->Offi;
+	Offx = (Entry *)NumericVal->Offx;
+	Lip = NumericVal->Lip;
+	Llen = NumericVal->Llen;
+	Uip = NumericVal->Uip;
+	Ulen = NumericVal->Ulen;
+	LUbx = (Entry **)NumericVal->LUbx;
+	Udiag = (Entry *)NumericVal->Udiag;
+	Rs = NumericVal->Rs;
+	X = (Entry *)NumericVal->Xwork;
+
+	// Permute the right hand side, X = Q'*B
+	for (k = 0; k < n; k++)
+	{
+		i = Q[k];
+		for (r = 0; r < NRHS; r++)
+			X[NRHS*k + r] = Bz[i + d*r];
+	}
+
+	// Solve X = (L*U + Off)'\X, first block first
+	for (block = 0; block < nblocks; block++)
+	{
+		k1 = R[block];
+		k2 = R[block+1];
+		nk = k2 - k1;
+
+		// Block back-substitution for the off-diagonal-block entries
+		if (block > 0)
+		{
+			for (k = k1; k < k2; k++)
+			{
+				pend = Offp[k+1];
+				for (r = 0; r < NRHS; r++)
+					x[r] = X[NRHS*k + r];
+
+				for (p = Offp[k]; p < pend; p++)
+				{
+					i = Offi[p];
+					offik = conj_solve ? EntryOps<Entry>::Conj(Offx[p]) : Offx[p];
+					for (r = 0; r < NRHS; r++)
+						EntryOps<Entry>::MultSub(x[r], offik, X[NRHS*i + r]);
+				}
+
+				for (r = 0; r < NRHS; r++)
+					X[NRHS*k + r] = x[r];
+			}
+		}
+
+		// Solve the block system
+		if (nk == 1)
+		{
+			s = conj_solve ? EntryOps<Entry>::Conj(Udiag[k1]) : Udiag[k1];
+			for (r = 0; r < NRHS; r++)
+				EntryOps<Entry>::Div(X[NRHS*k1 + r], X[NRHS*k1 + r], s);
+		}
+		else
+		{
+			UTSolve<NRHS>(nk, Uip + k1, Ulen + k1, LUbx[block], Udiag + k1, conj_solve, X + NRHS*k1);
+			LTSolve<NRHS>(nk, Lip + k1, Llen + k1, LUbx[block], conj_solve, X + NRHS*k1);
+		}
+	}
+
+	// Scale and permute the result, B = R\(P'X)
+	if (Rs == NULL)
+	{
+		for (k = 0; k < n; k++)
+		{
+			i = Pnum[k];
+			for (r = 0; r < NRHS; r++)
+				Bz[i + d*r] = X[NRHS*k + r];
+		}
+	}
+	else
+	{
+		for (k = 0; k < n; k++)
+		{
+			i = Pnum[k];
+			for (r = 0; r < NRHS; r++)
+				EntryOps<Entry>::ScaleDivAssign(Bz[i + d*r], X[NRHS*k + r], Rs[k]);
+		}
+	}
+}
+
+// klu_solve equivalent - B is overwritten with the solution of A*X=B
+// Entry has to match the factorization (double for klu_factor, std::complex<double> for klu_z_factor)
+// Returns true on success, false (with Common->status set) on bad inputs, like klu_solve
+template <class Entry, class Symbolic, class Numeric, class Common> bool Solve(Symbolic *SymbolicVal, Numeric *NumericVal, typename SymbolicIndex<Symbolic>::Int d, typename SymbolicIndex<Symbolic>::Int nrhs, Entry *B, Common *CommonVal)
+{
+	typedef typename SymbolicIndex<Symbolic>::Int Int;
+	Int chunk, nr;
+
+	if (CommonVal == NULL)
+		return false;
+
+	if ((NumericVal == NULL) || (SymbolicVal == NULL) || (d < SymbolicVal->n) || (nrhs < 0) || (B == NULL))
+	{
+		CommonVal->status = KLU_INVALID;
+		return false;
+	}
+	CommonVal->status = KLU_OK;
+
+	// Chunks of up to 4 columns, one instantiation per chunk width
+	for (chunk = 0; chunk < nrhs; chunk += 4)
+	{
+		nr = ((nrhs - chunk) < 4) ? (nrhs - chunk) : 4;
+
+		switch (nr)
+		{
+			case 1:
+				SolveChunk<1>(SymbolicVal, NumericVal, d, B);
+				break;
+			case 2:
+				SolveChunk<2>(SymbolicVal, NumericVal, d, B);
+				break;
+			case 3:
+				SolveChunk<3>(SymbolicVal, NumericVal, d, B);
+				break;
+			case 4:
+				SolveChunk<4>(SymbolicVal, NumericVal, d, B);
+				break;
+		}
+
+		B += d*4;
+	}
+
+	return true;
+}
+
+// klu_tsolve equivalent - B is overwritten with the solution of A'*X=B (A^H*X=B if conj_solve)
+template <class Entry, class Symbolic, class Numeric, class Common> bool TSolve(Symbolic *SymbolicVal, Numeric *NumericVal, typename SymbolicIndex<Symbolic>::Int d, typename SymbolicIndex<Symbolic>::Int nrhs, bool conj_solve, Entry *B, Common *CommonVal)
+{
+	typedef typename SymbolicIndex<Symbolic>::Int Int;
+	Int chunk, nr;
+
+	if (CommonVal == NULL)
+		return false;
+
+	if ((NumericVal == NULL) || (SymbolicVal == NULL) || (d < SymbolicVal->n) || (nrhs < 0) || (B == NULL))
+	{
+		CommonVal->status = KLU_INVALID;
+		return false;
+	}
+	CommonVal->status = KLU_OK;
+
+	for (chunk = 0; chunk < nrhs; chunk += 4)
+	{
+		nr = ((nrhs - chunk) < 4) ? (nrhs - chunk) : 4;
+
+		switch (nr)
+		{
+			case 1:
+				TSolveChunk<1>(SymbolicVal, NumericVal, d, conj_solve, B);
+				break;
+			case 2:
+				TSolveChunk<2>(SymbolicVal, NumericVal, d, conj_solve, B);
+				break;
+			case 3:
+				TSolveChunk<3>(SymbolicVal, NumericVal, d, conj_solve, B);
+				break;
+			case 4:
+				TSolveChunk<4>(SymbolicVal, NumericVal, d, conj_solve, B);
+				break;
+		}
+
+		B += d*4;
+	}
+
+	return true;
+}
+
+}	// namespace KLU_Template
+
+#endif
@@ -0,0 +1,19 @@
+// amd_l_build.c
+//
+// UF_long (DLONG) build of the AMD ordering, needed by klu_l_analyze.
+// amd_global.c has no DLONG version and still comes from AMD.lib.
+
+#define DLONG
+
+#include "../AMD/Source/amd_1.c"
+#include "../AMD/Source/amd_2.c"
+#include "../AMD/Source/amd_aat.c"
+#include "../AMD/Source/amd_control.c"
+#include "../AMD/Source/amd_defaults.c"
+#include "../AMD/Source/amd_dump.c"
+#include "../AMD/Source/amd_info.c"
+#include "../AMD/Source/amd_order.c"
+#include "../AMD/Source/amd_post_tree.c"
+#include "../AMD/Source/amd_postorder.c"
+#include "../AMD/Source/amd_preprocess.c"
+#include "../AMD/Source/amd_valid.c"
@@ -0,0 +1,9 @@
+// btf_l_build.c
+//
+// UF_long (DLONG) build of the BTF pre-ordering, needed by klu_l_analyze.
+
+#define DLONG
+
+#include "../BTF/Source/btf_maxtrans.c"
+#include "../BTF/Source/btf_order.c"
+#include "../BTF/Source/btf_strongcomp.c"
@@ -0,0 +1,8 @@
+// colamd_l_build.c
+//
+// UF_long (DLONG) build of COLAMD (colamd_l), needed when the 64-bit
+// entry points are asked for the COLAMD ordering.
+
+#define DLONG
+
+#include "../COLAMD/Source/colamd.c"
@@ -0,0 +1,25 @@
+// klu_l_build.c
+//
+// UF_long (DLONG) build of the KLU sources for the 64-bit index entry points
+// (LU_init_l, LU_solve_l, ...).  KLU.vcproj only compiles the int versions;
+// KLU/Lib/Makefile compiles both, so this file is only needed on Windows.
+
+#define DLONG
+
+#include "../KLU/Source/klu.c"
+#include "../KLU/Source/klu_analyze.c"
+#include "../KLU/Source/klu_analyze_given.c"
+#include "../KLU/Source/klu_defaults.c"
+#include "../KLU/Source/klu_diagnostics.c"
+#include "../KLU/Source/klu_dump.c"
+#include "../KLU/Source/klu_extract.c"
+#include "../KLU/Source/klu_factor.c"
+#include "../KLU/Source/klu_free_numeric.c"
+#include "../KLU/Source/klu_free_symbolic.c"
+#include "../KLU/Source/klu_kernel.c"
+#include "../KLU/Source/klu_memory.c"
+#include "../KLU/Source/klu_refactor.c"
+#include "../KLU/Source/klu_scale.c"
+#include "../KLU/Source/klu_solve.c"
+#include "../KLU/Source/klu_sort.c"
+#include "../KLU/Source/klu_tsolve.c"
@@ -0,0 +1,247 @@
+/*	$Id$
+	Copyright (C) 2008 Battelle Memorial Institute
+
+ *	CSV staging file and bulk loading for ODBC recorders and collectors.
+ */
+
+#include "ODBCBulk.h"
+#include "ODBCConnHandle.h"
+
+set<string> ODBCBulk::names;
+ODBCLock ODBCBulk::nameslock;
+
+//	writes s as a CSV field, quoted, with its quotes doubled
+static void put_field(FILE *out, const char *s){
+	fputc('"', out);
+	for(; *s != 0; ++s){
+		if(*s == '"')
+			fputc('"', out);
+		fputc(*s, out);
+	}
+	fputc('"', out);
+}
+
+ODBCBulk::ODBCBulk(ODBCConnHandle *h, ODBCTapeOptions *opts){
+	eventrow row;
+	FILE *in;
+	int n;
+	handle=h;
+	file=0;
+	checkpoint=opts->bulkrows;
+	due=checkpoint;
+	staged=0;
+	bytes=0.0;
+	loaded=0;
+	{
+		ODBCLocker locker(nameslock);
+		strncpy(filename, opts->bulk, 255);
+		filename[255]=0;
+		for(n=2; names.count(filename) > 0; ++n)
+			sprintf(filename, "%.240s.%i", opts->bulk, n);
+		names.insert(filename);
+	}
+	//	rows an earlier run staged but couldn't load go first
+	in=fopen(filename, "rb");
+	if(in != 0){
+		while(ReadRow(in, row))
+			++staged;
+		fclose(in);
+		if(staged > 0)
+			printf("WARNING:\tODBCBulk: %s holds %li rows an earlier run didn't load, loading them first\n", filename, staged);
+	}
+	file=fopen(filename, "ab");
+	if(file == 0){
+		printf("WARNING:\tODBCBulk: unable to open %s, rows will be inserted as usual\n", filename);
+		Close();
+	}
+}
+
+ODBCBulk::~ODBCBulk(){
+	Load();	//	normally done by the handle's Flush already
+	if(file != 0){
+		fclose(file);
+		file=0;
+		if(staged > 0)
+			printf("WARNING:\tODBCBulk: %li rows are still in %s for the next run\n", staged, filename);
+		else
+			remove(filename);
+	}
+	Close();
+}
+
+void ODBCBulk::Close(){
+	if(file != 0)
+		fclose(file);
+	file=0;
+	ODBCLocker locker(nameslock);
+	names.erase(filename);
+}
+
+//	ODBCBULKLOADER for a database, by its product name
+int ODBCBulk::Loader(const string &product){
+	if(product.find("MySQL") != string::npos)
+		return ODBC_BULK_LOADDATA;
+	if(product.find("PostgreSQL") != string::npos)
+		return ODBC_BULK_COPY;
+	if(product.find("SQL Server") != string::npos)
+		return ODBC_BULK_BULKINSERT;
+	return ODBC_BULK_NONE;
+}
+
+/*	the statement that has loader read filename into table.  LOAD DATA
+ *	LOCAL reads the file from this side; COPY and BULK INSERT read it on the
+ *	database server, so filename must be a path the server can see.
+ */
+string ODBCBulk::Statement(int loader, const char *filename, const string &table){
+	string path;
+	for(const char *p=filename; *p != 0; ++p){
+		if(*p == '\'' || (*p == '\\' && loader == ODBC_BULK_LOADDATA))
+			path += *p;
+		path += *p;
+	}
+	switch(loader){
+		case ODBC_BULK_LOADDATA:
+			return "LOAD DATA LOCAL INFILE '"+path+"' INTO TABLE "+table
+				+" FIELDS TERMINATED BY ',' OPTIONALLY ENCLOSED BY '\"' ESCAPED BY '' LINES TERMINATED BY '\\n'";
+		case ODBC_BULK_COPY:
+			return "COPY "+table+" FROM '"+path+"' WITH CSV";
+		case ODBC_BULK_BULKINSERT:
+			return "BULK INSERT "+table+" FROM '"+path+"' WITH (FORMAT='CSV', ROWTERMINATOR='0x0a')";
+	}
+	return "";
+}
+
+//	stages one row, and loads the file if that makes a checkpoint.  returns 1,
+//		or -1 if the file is gone and the row should be inserted as usual.
+int ODBCBulk::Push(char *object, int line, char *timestamp, char *value){
+	ODBCLocker locker(lock);
+	if(file == 0)
+		return -1;
+	put_field(file, object);
+	fprintf(file, ",%i,", line);
+	put_field(file, timestamp);
+	fputc(',', file);
+	put_field(file, value);
+	fputc('\n', file);
+	++staged;
+	bytes += strlen(object) + sizeof(int) + strlen(timestamp) + strlen(value);
+	handle->GetStats().Queued(staged);
+	if(staged >= due)
+		Load();
+	return 1;
+}
+
+/*	hands every staged row to the database: to its bulk loader in one
+ *	statement if it has one, otherwise through inserts.  returns 0 if rows
+ *	are left in the file for later.
+ */
+int ODBCBulk::Load(){
+	ODBCLocker locker(lock);
+	int rc;
+	if(file == 0 || staged == 0)
+		return 1;
+	fflush(file);
+	due=staged+checkpoint;	//	if this one fails, the next try is a checkpoint away
+	if(loaded == 0){	//	loaders only take whole files
+		rc=handle->LoadBulk(filename, staged, bytes);
+		if(rc < 0)
+			return 0;	//	the link is down, try at the next checkpoint
+		if(rc > 0){
+			Truncate();
+			return 1;
+		}
+	}
+	return Insert();
+}
+
+/*	reads the rows past loaded back from the file and inserts them, a chunk
+ *	per transaction.  returns 0 if the link went before they were all in.
+ */
+int ODBCBulk::Insert(){
+	vector<eventrow> chunk;
+	vector<long> ends;		//	file offset after each row in chunk
+	eventrow row;
+	int sent;
+	FILE *in=fopen(filename, "rb");
+	if(in == 0){
+		printf("WARNING:\tODBCBulk::Insert: unable to read %s back, its rows stay there\n", filename);
+		return 0;
+	}
+	fseek(in, loaded, SEEK_SET);
+	for(;;){
+		chunk.clear();
+		ends.clear();
+		while(chunk.size() < ODBC_BULK_CHUNK && ReadRow(in, row)){
+			chunk.push_back(row);
+			ends.push_back(ftell(in));
+		}
+		if(chunk.empty())
+			break;
+		sent=handle->WriteJournal(chunk);
+		if(sent > 0){
+			loaded=ends[sent-1];
+			staged -= sent;
+		}
+		if(sent < (int)chunk.size()){
+			fclose(in);
+			return 0;
+		}
+	}
+	fclose(in);
+	Truncate();
+	return 1;
+}
+
+//	reads one staged row.  returns 0 at the end of the file, or of its whole rows
+int ODBCBulk::ReadRow(FILE *in, eventrow &row){
+	string fields[4];
+	int c, f=0, quoted=0;
+	for(c=fgetc(in); ; c=fgetc(in)){
+		if(c == EOF)
+			return 0;
+		if(quoted){
+			if(c != '"'){
+				fields[f] += (char)c;
+				continue;
+			}
+			c=fgetc(in);
+			if(c == '"'){
+				fields[f] += '"';
+				continue;
+			}
+			quoted=0;	//	and c is whatever follows the field
+			if(c == EOF)
+				return 0;
+		}
+		if(c == '"')
+			quoted=1;
+		else if(c == ','){
+			if(++f > 3)
+				return 0;
+		} else if(c == '\n')
+			break;
+		else if(c != '\r')
+			fields[f] += (char)c;
+	}
+	if(f != 3)
+		return 0;
+	row.object=fields[0];
+	row.line=atoi(fields[1].c_str());
+	row.timestamp=fields[2];
+	row.value=fields[3];
+	return 1;
+}
+
+//	empties the file once everything in it is loaded
+void ODBCBulk::Truncate(){
+	fclose(file);
+	file=fopen(filename, "wb");
+	if(file == 0)
+		printf("WARNING:\tODBCBulk::Truncate: unable to reopen %s, rows will be inserted as usual\n", filename);
+	staged=0;
+	bytes=0.0;
+	loaded=0;
+	due=checkpoint;
+}
+
+//	end of ODBCBulk.cpp
@@ -0,0 +1,68 @@
+/*	$id$
+	Copyright (C) 2008 Battelle Memorial Institute
+
+ *	A bulk-load path for an ODBCConnHandle.  Recorder and collector rows are
+ *		appended to a local CSV file, and every bulkrows=N rows, and when a
+ *		tape closes, the file is handed to the database's own loader in one
+ *		statement.  Databases without one, or whose loader refuses the file,
+ *		get the rows back from the file in the largest multi-row inserts the
+ *		driver takes.  Rows a run couldn't load stay in the file for the
+ *		next run that stages to it.
+ */
+
+#ifndef _ODBCBULK_H_
+#define _ODBCBULK_H_
+
+#include <stdio.h>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "ODBCThread.h"
+#include "ODBCTapeOptions.h"
+#include "TapeStream.h"
+
+using std::set;
+using std::string;
+using std::vector;
+
+#define ODBC_BULK_CHUNK		10000	//	rows read back per transaction when falling back
+
+//	the statement a database loads a CSV file with
+typedef enum {ODBC_BULK_NONE, ODBC_BULK_LOADDATA, ODBC_BULK_COPY, ODBC_BULK_BULKINSERT} ODBCBULKLOADER;
+
+class ODBCConnHandle;
+
+class ODBCBulk{
+public:
+	ODBCBulk(ODBCConnHandle *, ODBCTapeOptions *);
+	~ODBCBulk();
+
+	int IsOpen(){return file != 0;}
+	const char *GetName(){return filename;}
+	int Push(char *, int, char *, char *);
+	int Load();
+
+	static int Loader(const string &);
+	static string Statement(int, const char *, const string &);
+private:
+	int Insert();
+	int ReadRow(FILE *, eventrow &);
+	void Truncate();
+	void Close();
+
+	ODBCConnHandle	*handle;
+	char			filename[256];
+	FILE			*file;		//	open for appending
+	long			checkpoint;	//	rows staged before a load
+	long			due;		//	staged count that triggers the next load
+	long			staged;		//	rows in the file past loaded
+	double			bytes;
+	long			loaded;		//	offset of the first row not yet in the database
+	ODBCLock		lock;		//	guards everything above
+
+	static set<string>	names;	//	staging files open in this process
+	static ODBCLock		nameslock;
+};
+
+#endif
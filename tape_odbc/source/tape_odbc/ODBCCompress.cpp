@@ -0,0 +1,206 @@
+/*	$Id$
+	Copyright (C) 2008 Battelle Memorial Institute
+
+ *	Sample compression for ODBC recorders, and interpolation for players.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <ctype.h>
+
+#include "ODBCCompress.h"
+#include "ODBCPlayerCursor.h"
+
+//	a value is numeric if strtod takes all of it but trailing space
+static int ParseNumber(const char *value, double *out){
+	char *end = 0;
+	if(value == 0 || *value == 0)
+		return 0;
+	*out = strtod(value, &end);
+	if(end == value)
+		return 0;
+	while(isspace((unsigned char)*end))
+		++end;
+	return *end == 0;
+}
+
+ODBCCompressor::ODBCCompressor(){
+	Reset(ODBC_COMPRESS_NONE, 0.0);
+}
+
+void ODBCCompressor::Reset(int m, double tol){
+	mode = m;
+	tolerance = tol;
+	nkept = 0;
+	haslast = 0;
+	hasheld = 0;
+	upper = HUGE_VAL;
+	lower = -HUGE_VAL;
+}
+
+//	write s, and start the next segment from it
+void ODBCCompressor::Keep(sample &s){
+	kept[nkept].timestamp = s.timestamp;
+	kept[nkept].value = s.value;
+	++nkept;
+	last = s;
+	haslast = 1;
+	hasheld = 0;
+	upper = HUGE_VAL;
+	lower = -HUGE_VAL;
+}
+
+//	write the held sample, if there is one
+void ODBCCompressor::Release(){
+	if(hasheld){
+		sample s = held;
+		Keep(s);
+	}
+}
+
+/**	Add(timestamp, value)
+	Takes the next sample.  Returns how many rows, at most two, are ready
+		to be written through Kept().
+*/
+int ODBCCompressor::Add(char *timestamp, char *value){
+	sample now;
+	double dt;
+	nkept = 0;
+	now.timestamp = timestamp;
+	now.value = value;
+	now.numeric = ParseNumber(value, &now.num);
+	now.timed = ODBCTimeToEpoch(timestamp, &now.secs);
+
+	if(!haslast){
+		Keep(now);
+		return nkept;
+	}
+	if(!now.numeric || !last.numeric){
+		//	text goes out when it changes, closing any segment first
+		if(now.value != last.value){
+			if(mode == ODBC_COMPRESS_SWINGDOOR)
+				Release();
+			Keep(now);
+		} else {
+			held = now;
+			hasheld = 1;
+		}
+		return nkept;
+	}
+	if(mode == ODBC_COMPRESS_DEADBAND){
+		if(fabs(now.num - last.num) > tolerance){
+			Keep(now);
+		} else {
+			held = now;
+			hasheld = 1;
+		}
+		return nkept;
+	}
+
+	//	swinging door.  the line from last to now must pass within the
+	//		tolerance of every sample since last, which holds while its
+	//		slope stays between the doors those samples open.  a sample
+	//		that can't be placed after last on a line ends the segment.
+	if(!now.timed || !last.timed || now.secs <= last.secs){
+		Release();
+		Keep(now);
+		return nkept;
+	}
+	if(hasheld){
+		dt = (double)(held.secs - last.secs);
+		double u = (held.num + tolerance - last.num) / dt;
+		double l = (held.num - tolerance - last.num) / dt;
+		double slope = (now.num - last.num) / (double)(now.secs - last.secs);
+		if(u < upper)
+			upper = u;
+		if(l > lower)
+			lower = l;
+		if(slope > upper || slope < lower){
+			//	the held sample ends this segment and starts the next
+			Release();
+			if(now.secs <= last.secs){
+				Keep(now);
+				return nkept;
+			}
+		}
+	}
+	held = now;
+	hasheld = 1;
+	return nkept;
+}
+
+/**	Finish()
+	Writes the last sample if it was held, so a series ends where it did.
+*/
+int ODBCCompressor::Finish(){
+	nkept = 0;
+	Release();
+	return nkept;
+}
+
+ODBCInterpolator::ODBCInterpolator(){
+	Reset(0);
+}
+
+void ODBCInterpolator::Reset(int s){
+	step = s;
+	started = 0;
+	hasto = 0;
+	linear = 0;
+}
+
+//	read the row after from, and see if the two can be joined by a line
+void ODBCInterpolator::Advance(ODBCPlayerCursor &cursor){
+	eventrow *row = cursor.Next();
+	hasto = (row != 0);
+	linear = 0;
+	if(!hasto)
+		return;
+	to = *row;
+	if(ODBCTimeToEpoch(from.timestamp.c_str(), &t0)
+		&& ODBCTimeToEpoch(to.timestamp.c_str(), &t1)
+		&& ParseNumber(from.value.c_str(), &v0)
+		&& ParseNumber(to.value.c_str(), &v1)
+		&& t1 - t0 > step){
+		linear = 1;
+		tcur = t0;
+	}
+}
+
+/**	Next(cursor)
+	Returns the next row to play: a stored row, or one every step seconds
+		on the line between two stored numeric rows.  0 at the end.
+*/
+eventrow *ODBCInterpolator::Next(ODBCPlayerCursor &cursor){
+	if(!started){
+		eventrow *row = cursor.Next();
+		if(row == 0)
+			return 0;
+		started = 1;
+		from = *row;
+		Advance(cursor);
+		out = from;
+		return &out;
+	}
+	if(!hasto)
+		return 0;
+	if(linear && tcur + step < t1){
+		char buffer[64];
+		tcur += step;
+		ODBCEpochToTime(tcur, buffer);
+		out.timestamp = buffer;
+		if(from.timestamp.length() > 19)
+			out.timestamp += from.timestamp.substr(19);	//	the time zone
+		sprintf(buffer, "%.12g", v0 + (v1 - v0) * (double)(tcur - t0) / (double)(t1 - t0));
+		out.value = buffer;
+		out.line = from.line;
+		return &out;
+	}
+	from = to;
+	Advance(cursor);
+	out = from;
+	return &out;
+}
+
+//	end of ODBCCompress.cpp
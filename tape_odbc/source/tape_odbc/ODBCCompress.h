@@ -0,0 +1,74 @@
+/*	$id$
+	Copyright (C) 2008 Battelle Memorial Institute
+
+ *	Sample compression for ODBC recorders, and the interpolation players
+ *		use to fill it back in.  A deadband recorder writes a sample when
+ *		it moves more than the tolerance from the last one written, so
+ *		holding each value reproduces the series within the tolerance.  A
+ *		swinging-door recorder writes the ends of straight segments that
+ *		every sample in between lies within the tolerance of, so a player
+ *		interpolating between rows reproduces it.  Values that aren't
+ *		plain numbers are written whenever they change.
+ */
+
+#ifndef _ODBCCOMPRESS_H_
+#define _ODBCCOMPRESS_H_
+
+#include <string>
+
+#include "ODBCSchema.h"
+#include "ODBCTapeOptions.h"
+#include "TapeStream.h"
+
+using std::string;
+
+class ODBCPlayerCursor;
+
+class ODBCCompressor{
+public:
+	ODBCCompressor();
+
+	void Reset(int, double);
+	int IsOn(){return mode != ODBC_COMPRESS_NONE;}
+	int Add(char *, char *);
+	int Finish();
+	eventrow &Kept(int i){return kept[i];}	//	after Add or Finish
+private:
+	struct sample{
+		string		timestamp, value;
+		odbc::Long	secs;
+		double		num;
+		int			timed, numeric;
+	};
+	void Keep(sample &);
+	void Release();
+
+	int		mode;			//	ODBCCOMPRESSMODE
+	double	tolerance;
+	eventrow kept[2];
+	int		nkept;
+	sample	last;			//	the last sample written
+	sample	held;			//	the last sample seen, if it wasn't written
+	int		haslast, hasheld;
+	double	upper, lower;	//	slopes from last the samples since it allow, per second
+};
+
+class ODBCInterpolator{
+public:
+	ODBCInterpolator();
+
+	void Reset(int);
+	int IsOn(){return step > 0;}
+	eventrow *Next(ODBCPlayerCursor &);
+	int More(){return !started || hasto;}
+private:
+	void Advance(ODBCPlayerCursor &);
+
+	int			step;		//	seconds between interpolated rows
+	int			started, hasto, linear;
+	eventrow	from, to, out;
+	odbc::Long	t0, t1, tcur;
+	double		v0, v1;
+};
+
+#endif
@@ -5,31 +5,81 @@
  *	author: Matt Hauer, matthew.hauer@pnl.gov, 6/4/07 - ***
  */
 
+#include <time.h>
+
 #include "ODBCConnHandle.h"
 
 ODBCConnHandle::ODBCConnHandle(){
 	Reset();
 }
 
-ODBCConnHandle::ODBCConnHandle(Connection *inconn, char *hostname){
+ODBCConnHandle::ODBCConnHandle(Connection *inconn, char *hostname, char *user, char *pass){
 	Reset();
 	conn=inconn;
-	strncpy(servername, hostname, 128);
+	strncpy(servername, hostname, 127);
+	strncpy(uid, user, 255);
+	strncpy(pwd, pass, 63);
+	SetCommit();	//	there may be a default policy
 }
 
 ODBCConnHandle::~ODBCConnHandle(){
+	map<string, ODBCGroup *>::iterator itr;
+	statsstop.Set();
+	statsthread.Join();
+	for(itr=groups.begin(); itr != groups.end(); ++itr)
+		delete itr->second;	//	writes their last rows
+	groups.clear();
+	Flush();
+	delete journal;	//	drained by the Flush, as far as the database allows
+	delete bulk;	//	loaded by the Flush, as far as the database allows
+	delete writer;	//	drained by the Flush
 	Disconnect();	//	clears list
+	delete source;	//	players are closed now
+	delete reader;
+	FreeInserts();
 	delete conn;
+	while(!retired.empty()){
+		delete retired.front();	//	after the players that may have used them
+		retired.pop_front();
+	}
 }
 
 void ODBCConnHandle::Reset(){
 	tapect=0;
 	conn=0;
+	configured=0;
+	multirow=1;
+	options.Reset();
+	rows.clear();
+	rowbytes=0;
+	inserts.clear();
+	statements.clear();
+	writer=0;
+	journal=0;
+	bulk=0;
+	bulkloader=-1;
+	reader=0;
+	source=0;
+	transactions=-1;
+	manual=0;
+	uncommitted=0;
+	txnstart=0;
+	steptime.clear();
+	down=0;
+	backoff=ODBC_MINBACKOFF;
+	retryat=0;
+	dropped=0;
+	stats.Reset();
+	statsinsert=0;
+	statscreated=0;
+	runopen=0;
 	if(!tapelist.empty()){
 		printf("WARNING:\tODBCConnHandle::Reset: we're reseting a non-empty handle?\n");
 	}
 	tapelist.clear();
 	memset(servername, 0, 128);
+	memset(uid, 0, 256);
+	memset(pwd, 0, 64);
 }
 
 int ODBCConnHandle::CheckName(char *hostname){
@@ -37,12 +87,18 @@ int ODBCConnHandle::CheckName(char *hostname){
 }
 
 void ODBCConnHandle::DisconnectTape(ODBCTapeStream *ts){
+	size_t waiting;
+	ODBCLocker locker(connlock);
 	if(tapelist.empty()) return;	//	nothing to remove
 	tapelist.remove(ts);
 	int tapelistsize=(int)(tapelist.size());
 	if(tapelistsize > tapect)
 		printf("WARNING:\tODBCConnHandle::DisconnectTape: we disconnected a tape and ended up with more tapes than we started with?\n");
 	tapect=tapelistsize;			//	shouldn't assume single instence removed
+	if(tapect == 0 && down && !rows.empty())
+		printf("WARNING:\tODBCConnHandle::DisconnectTape: %s is down, %i rows are still held for it\n", servername, (int)rows.size());
+	if(tapect == 0 && journal != 0 && (waiting=journal->Pending()) > 0)
+		printf("WARNING:\tODBCConnHandle::DisconnectTape: %li rows for %s are still in its journal\n", (long)waiting, servername);
 }
 
 void ODBCConnHandle::Disconnect(){	//	as in, everything
@@ -53,9 +109,642 @@ void ODBCConnHandle::Disconnect(){	//	as in, everything
 }
 
 int ODBCConnHandle::RegisterStream(ODBCTapeStream *ts){
+	ODBCLocker locker(connlock);
 	tapelist.push_back(ts);
 	++tapect;
 	return 1;	//	success
 }
 
+//	the first tape to give options sets them for the connection
+int ODBCConnHandle::Configure(ODBCTapeOptions *opts){
+	if(!opts->given) return 0;
+	ODBCLocker locker(connlock);	//	tapes may open on several threads
+	if(configured){
+		if(options.Differs(opts))
+			printf("WARNING:\tODBCConnHandle::Configure: %s already has tape options, ignoring later ones\n", servername);
+		return 0;
+	}
+	Flush();	//	rows queued under the old options go out as they were
+	options=*opts;
+	configured=1;
+	if(options.journal[0] != 0){
+		journal=new ODBCJournal(this, &options);
+		if(!journal->IsOpen()){
+			delete journal;
+			journal=0;
+		}
+	}
+	if(options.bulk[0] != 0){
+		if(journal != 0){
+			printf("WARNING:\tODBCConnHandle::Configure: %s journals its rows, so bulk is ignored\n", servername);
+		} else {
+			bulk=new ODBCBulk(this, &options);
+			if(!bulk->IsOpen()){
+				delete bulk;
+				bulk=0;
+			}
+		}
+	}
+	if(options.async && journal == 0 && bulk == 0)
+		writer=new ODBCWriter(this, &options);
+	if(options.readahead > 0)
+		reader=new ODBCReader(servername);
+	SetCommit();
+	if(options.statsperiod > 0)
+		statsthread.Start(RunStats, this);
+	if(options.typed){
+		try{
+			if(options.run[0] == 0 && !writeschema.Negotiate(conn, "OBJECT_TABLE"))	//	a run's is made by OpenRun
+				printf("WARNING:\tODBCConnHandle::Configure: %s OBJECT_TABLE has no typed time or value columns, writing text\n", servername);
+			readschema.Negotiate(conn, "EVENT_TABLE");
+		} catch(SQLException& e) {
+			cout << "Exception caught: "<<e.getMessage()<<endl;
+			writeschema.Reset();
+			readschema.Reset();
+		}
+	}
+	return 1;
+}
+
+//	the query players share with shared, or 0 if they each have their own
+ODBCPlayerSource *ODBCConnHandle::GetSource(){
+	ODBCLocker locker(connlock);
+	if(!options.shared) return 0;
+	if(source == 0)
+		source=new ODBCPlayerSource(this, &readschema, options.fetchrows, options.readahead);
+	return source;
+}
+
+ODBCGroup *ODBCConnHandle::JoinGroup(char *name){
+	ODBCLocker locker(connlock);
+	map<string, ODBCGroup *>::iterator itr=groups.find(name);
+	if(itr != groups.end()) return itr->second;
+	ODBCGroup *group=new ODBCGroup(this, name);
+	groups[name]=group;
+	return group;
+}
+
+//	hands one OBJECT_TABLE row to the writer, or buffers it here
+int ODBCConnHandle::QueueEvent(char *object, int line, char *timestamp, char *value){
+	if(journal != 0)
+		return journal->Push(object, line, timestamp, value);
+	if(bulk != 0){
+		int staged=bulk->Push(object, line, timestamp, value);
+		if(staged >= 0)
+			return staged;
+	}
+	if(writer != 0)
+		return writer->Push(object, line, timestamp, value);
+	eventrow row(object, line, timestamp, value);
+	ODBCLocker locker(connlock);	//	recorders may write from several threads
+	return BufferEvent(row);
+}
+
+//	number of tapes using this connection
+int ODBCConnHandle::GetTapeCount(){
+	ODBCLocker locker(connlock);
+	return tapect;
+}
+
+//	tries to reconnect now if the connection is down and due a retry.  returns 1 if it's up.
+int ODBCConnHandle::Check(){
+	ODBCLocker locker(connlock);
+	return !down || Reconnect();
+}
+
+/*	notes a driver error.  returns 1 if it says the link to the database is
+ *	gone (SQLSTATE class 08), in which case writes stop until Reconnect.
+ */
+int ODBCConnHandle::Lost(SQLException &e){
+	if(e.getSQLState().compare(0, 2, "08") != 0) return 0;
+	if(!down){
+		cout << "Exception caught: "<<e.getMessage()<<endl;
+		printf("WARNING:\tODBCConnHandle::Lost: lost the connection to %s, holding rows until it's back\n", servername);
+		down=1;
+		backoff=ODBC_MINBACKOFF;
+		retryat=ODBCMillis()+backoff;
+	}
+	return 1;
+}
+
+/*	gets the run's tables ready when the first recorder opens, or falls back
+ *	to the shared ones if they can't be made.
+ */
+void ODBCConnHandle::OpenRun(){
+	ODBCLocker locker(connlock);
+	if(options.run[0] == 0 || runopen) return;
+	runopen=1;
+	if(!ODBCRun::Open(this, options.run, options.typed, options.keep)){
+		printf("WARNING:\tODBCConnHandle::OpenRun: %s will write to the shared tables instead of run %s\n", servername, options.run);
+		options.run[0]=0;
+	}
+	if(options.typed){
+		try{
+			string table=RunTable("OBJECT_TABLE");
+			if(!writeschema.Negotiate(conn, table.c_str()))
+				printf("WARNING:\tODBCConnHandle::OpenRun: %s %s has no typed time or value columns, writing text\n", servername, table.c_str());
+		} catch(SQLException& e) {
+			cout << "Exception caught: "<<e.getMessage()<<endl;
+			writeschema.Reset();
+		}
+	}
+}
+
+/*	opens a new connection in place of a lost one, if the backoff has run
+ *	out, and doubles the backoff if that fails.  statements on the old one
+ *	are dropped; the old connection itself is kept until the handle goes,
+ *	since open players may still refer to it.  caller holds the lock.
+ */
+int ODBCConnHandle::Reconnect(){
+	odbc::Connection *fresh=0;
+	unsigned long now=ODBCMillis();
+	if(!down) return 1;
+	if((long)(now-retryat) < 0) return 0;
+	stats.Retried();
+	try{
+		fresh=odbc::DriverManager::getConnection(servername, uid, pwd);
+	} catch(SQLException& e) {
+		fresh=0;
+	}
+	if(fresh == 0){
+		backoff=(backoff*2 > ODBC_MAXBACKOFF ? ODBC_MAXBACKOFF : backoff*2);
+		retryat=now+backoff;
+		return 0;
+	}
+	FreeInserts();
+	map<string, ODBCGroup *>::iterator itr;
+	for(itr=groups.begin(); itr != groups.end(); ++itr)
+		itr->second->Unprepare();
+	retired.push_back(conn);
+	conn=fresh;
+	down=0;
+	transactions=-1;
+	manual=0;
+	SetCommit();
+	printf("WARNING:\tODBCConnHandle::Reconnect: reconnected to %s", servername);
+	if(dropped > 0)
+		printf(", %li rows were dropped while it was down", dropped);
+	printf("\n");
+	dropped=0;
+	return 1;
+}
+
+//	sends or drains everything queued so far, and commits it.  returns the
+//		number of rows written here.
+int ODBCConnHandle::Flush(){
+	int written=0;
+	if(journal != 0)
+		journal->Drain();
+	else if(writer != 0)
+		writer->Drain();
+	else {
+		if(bulk != 0)
+			bulk->Load();
+		written=WriteBuffer();
+	}
+	Commit();
+	return written;
+}
+
+/*	turns autocommit off if the options ask for a commit policy and the
+ *	database has transactions, or back on if a policy is dropped.
+ */
+void ODBCConnHandle::SetCommit(){
+	ODBCLocker locker(connlock);
+	int want=(options.commitrows > 0 || options.commitms > 0 || options.commitstep);
+	if(want == manual) return;
+	try{
+		if(want){
+			if(transactions < 0)
+				transactions=conn->getMetaData()->supportsTransactions() ? 1 : 0;
+			if(!transactions){
+				printf("WARNING:\tODBCConnHandle::SetCommit: %s doesn't support transactions, every row is committed as it's written\n", servername);
+				return;
+			}
+			conn->setAutoCommit(false);
+			manual=1;
+			uncommitted=0;
+			txnstart=ODBCMillis();
+		} else {
+			Commit();
+			conn->setAutoCommit(true);
+			manual=0;
+		}
+	} catch(SQLException& e) {
+		cout << "Exception caught: "<<e.getMessage()<<endl;
+	}
+}
+
+//	notes rows written under the commit policy, and commits if one of its
+//		limits is reached.  stepdone is set when a timestep is finished.
+void ODBCConnHandle::CountWork(int count, int stepdone){
+	ODBCLocker locker(connlock);
+	if(!manual) return;
+	uncommitted += count;
+	if((stepdone && options.commitstep)
+		|| (options.commitrows > 0 && uncommitted >= options.commitrows)
+		|| (options.commitms > 0 && ODBCMillis()-txnstart >= (unsigned long)options.commitms))
+		Commit();
+}
+
+//	commits whatever is outstanding; a no-op in autocommit.  returns 1 on a commit.
+int ODBCConnHandle::Commit(){
+	ODBCLocker locker(connlock);
+	if(!manual || down) return 0;
+	uncommitted=0;
+	txnstart=ODBCMillis();
+	try{
+		conn->commit();
+		return 1;
+	} catch(SQLException& e) {
+		if(!Lost(e))
+			cout << "Exception caught: "<<e.getMessage()<<endl;
+		printf("WARNING:\tODBCConnHandle::Commit: %s failed to commit, rows since the last commit may be lost\n", servername);
+	}
+	return 0;
+}
+
+//	writer thread: one group of rows, in one transaction where supported.
+//		with a commit policy the policy decides when to commit instead.
+int ODBCConnHandle::WriteGroup(vector<eventrow> &group){
+	ODBCLocker locker(connlock);
+	int written=0;
+	if(manual){
+		for(size_t i=0; i < group.size(); ++i)
+			written += BufferEvent(group[i]);
+		return written;
+	}
+	try{
+		if(transactions < 0)
+			transactions=conn->getMetaData()->supportsTransactions() ? 1 : 0;
+		if(transactions)
+			conn->setAutoCommit(false);
+	} catch(SQLException& e) {
+		cout << "Exception caught: "<<e.getMessage()<<endl;
+		transactions=0;
+	}
+	for(size_t i=0; i < group.size(); ++i)
+		written += BufferEvent(group[i]);
+	written += WriteBuffer();
+	if(transactions){
+		try{
+			conn->commit();
+			conn->setAutoCommit(true);
+		} catch(SQLException& e) {
+			cout << "Exception caught: "<<e.getMessage()<<endl;
+		}
+	}
+	return written;
+}
+
+/*	journal thread, or a bulk load without a loader: rows replayed from the
+ *	local file, in one transaction where supported.  returns how many rows, from the front, the journal can let go
+ *	of: those in the database, and those the database refused outright.  rows
+ *	held because the link went, or in a transaction that didn't commit, stay
+ *	in the journal instead of here.
+ */
+int ODBCConnHandle::WriteJournal(vector<eventrow> &group){
+	ODBCLocker locker(connlock);
+	size_t left;
+	int txn=0, committed=0;
+	if(down && !Reconnect())
+		return 0;
+	try{
+		if(transactions < 0)
+			transactions=conn->getMetaData()->supportsTransactions() ? 1 : 0;
+		if(transactions && !manual)
+			conn->setAutoCommit(false);
+		txn=transactions;
+	} catch(SQLException& e) {
+		if(Lost(e))
+			return 0;
+		cout << "Exception caught: "<<e.getMessage()<<endl;
+		transactions=0;
+	}
+	rows.insert(rows.end(), group.begin(), group.end());
+	WriteBuffer();
+	left=rows.size();
+	rows.clear();
+	rowbytes=0;
+	if(txn){
+		if(!down){
+			try{
+				conn->commit();
+				committed=1;
+				if(!manual)
+					conn->setAutoCommit(true);
+			} catch(SQLException& e) {
+				if(!Lost(e)){
+					cout << "Exception caught: "<<e.getMessage()<<endl;
+					Abandon();
+				}
+			}
+		}
+		if(!committed)
+			left=group.size();	//	nothing went in; the rows stay journaled
+		uncommitted=0;
+		txnstart=ODBCMillis();
+	}
+	return (int)(group.size()-left);
+}
+
+/*	a transaction the database refused to commit, as in a deadlock, or one
+ *	a rejected statement spoiled: rolls it back and puts autocommit back
+ *	unless a commit policy turned it off.  returns 0 if the link went.
+ *	caller holds connlock.
+ */
+int ODBCConnHandle::Abandon(){
+	try{
+		conn->rollback();
+		if(!manual)
+			conn->setAutoCommit(true);
+	} catch(SQLException& e) {
+		if(Lost(e))
+			return 0;
+		cout << "Exception caught: "<<e.getMessage()<<endl;
+	}
+	uncommitted=0;
+	txnstart=ODBCMillis();
+	return 1;
+}
+
+/*	bulk checkpoint: has the database's own loader read the staged file into
+ *	OBJECT_TABLE in one statement.  returns 1 if it did, -1 if the link is
+ *	down, and 0 if there's no loader to use and the rows should be inserted.
+ */
+int ODBCConnHandle::LoadBulk(const char *filename, long count, double bytes){
+	ODBCLocker locker(connlock);
+	odbc::Statement *stmt=0;
+	double t0;
+	if(down && !Reconnect())
+		return -1;
+	if(bulkloader < 0){
+		bulkloader=ODBC_BULK_NONE;
+		try{
+			bulkloader=ODBCBulk::Loader(conn->getMetaData()->getDatabaseProductName());
+		} catch(SQLException& e) {
+			if(Lost(e)){
+				bulkloader=-1;
+				return -1;
+			}
+			cout << "Exception caught: "<<e.getMessage()<<endl;
+		}
+		if(bulkloader != ODBC_BULK_NONE && !writeschema.IsText()){
+			printf("WARNING:\tODBCConnHandle::LoadBulk: staged rows are text, so %s gets them through inserts under schema=typed\n", servername);
+			bulkloader=ODBC_BULK_NONE;
+		}
+	}
+	if(bulkloader == ODBC_BULK_NONE)
+		return 0;
+	try{
+		stmt=conn->createStatement();
+		t0=ODBCMicros();
+		stmt->executeUpdate(ODBCBulk::Statement(bulkloader, filename, RunTable("OBJECT_TABLE")));
+		stats.Executed(ODBCMicros()-t0, count, bytes);
+		delete stmt;
+	} catch(SQLException& e) {
+		delete stmt;
+		if(Lost(e))
+			return -1;
+		cout << "Exception caught: "<<e.getMessage()<<endl;
+		printf("WARNING:\tODBCConnHandle::LoadBulk: %s refused the bulk load of %s, inserting its rows instead\n", servername, filename);
+		bulkloader=ODBC_BULK_NONE;
+		return 0;
+	}
+	CountWork((int)count, 0);
+	return 1;
+}
+
+//	buffers one row, writing the buffer on the row, byte, or timestep limits
+int ODBCConnHandle::BufferEvent(eventrow &row){
+	int written=0;
+	if(down && rows.size() >= ODBC_MAXDOWNROWS){
+		++dropped;	//	don't hold rows forever
+		return 0;
+	}
+	if(steptime != row.timestamp){
+		if(options.flushstep || (manual && options.commitstep))
+			written += WriteBuffer();
+		if(!steptime.empty())
+			CountWork(0, 1);
+		steptime=row.timestamp;
+	}
+	rows.push_back(row);
+	rowbytes += row.object.size() + sizeof(int) + row.timestamp.size() + row.value.size();
+	stats.Queued((long)rows.size());
+	if((int)rows.size() >= options.batchrows || (options.batchbytes > 0 && rowbytes >= (size_t)options.batchbytes))
+		written += WriteBuffer();
+	return written;
+}
+
+/*	sends everything buffered.  full batches go out in one statement, and the
+ *	remainder is split into power-of-two pieces so that only a handful of
+ *	statements are ever prepared.  returns the number of rows written.
+ */
+int ODBCConnHandle::WriteBuffer(){
+	ODBCLocker locker(connlock);
+	size_t done=0, left;
+	int count, written=0, ok;
+	if(down && !Reconnect())
+		return 0;	//	keep the rows for when it's back
+	int maxrows=ODBC_MAXPARAMS/(2+writeschema.Params());
+	if(maxrows > options.batchrows && bulk == 0)	//	bulk rows go in as large as they can
+		maxrows=options.batchrows;
+	while(done < rows.size()){
+		left=rows.size()-done;
+		if(!multirow)
+			count=1;
+		else if(left >= (size_t)maxrows)
+			count=maxrows;
+		else
+			for(count=1; (size_t)(count*2) <= left; count*=2);
+		ok=InsertRows(done, count);
+		if(ok < 0){
+			rows.erase(rows.begin(), rows.begin()+done);	//	hold the rest
+			CountWork(written, 0);
+			return written;
+		}
+		if(ok){
+			written += count;
+		} else if(count > 1){
+			printf("WARNING:\tODBCConnHandle::WriteBuffer: %s rejected a multi-row insert, falling back to single rows\n", servername);
+			multirow=0;
+			continue;	//	retry the same rows one at a time
+		}	//	else the row is lost, InsertRows already said why
+		done += count;
+	}
+	rows.clear();
+	rowbytes=0;
+	CountWork(written, 0);
+	return written;
+}
+
+odbc::PreparedStatement *ODBCConnHandle::GetInsert(int count){
+	map<int, odbc::PreparedStatement *>::iterator itr=inserts.find(count);
+	if(itr != inserts.end()) return itr->second;
+	string sql, row="(?, ?, ?, ?)";
+	if(writeschema.IsText()){
+		sql="INSERT INTO "+RunTable("OBJECT_TABLE")+" VALUES ";
+	} else {
+		//	name the columns, the table may have more than we fill
+		sql="INSERT INTO "+RunTable("OBJECT_TABLE")+" (EVENT_OBJECT_NAME, EVENT_LINE, "+writeschema.Columns()+") VALUES ";
+		if(writeschema.imagcol)
+			row="(?, ?, ?, ?, ?)";
+	}
+	sql += row;
+	for(int i=1; i < count; ++i)
+		sql += ", "+row;
+	double t0=ODBCMicros();
+	odbc::PreparedStatement *feeder=conn->prepareStatement(sql);
+	stats.Prepared(ODBCMicros()-t0);
+	inserts[count]=feeder;
+	return feeder;
+}
+
+int ODBCConnHandle::InsertRows(size_t first, int count){
+	try{
+		odbc::PreparedStatement *feeder=GetInsert(count);
+		int params=2+writeschema.Params();
+		double bytes=0.0, t0;
+		for(int i=0; i < count; ++i){
+			eventrow &row=rows[first+i];
+			feeder->setString(params*i+1, row.object);
+			feeder->setInt(params*i+2, row.line);
+			writeschema.Bind(feeder, params*i+3, row);
+			bytes += row.object.size() + sizeof(int) + row.timestamp.size() + row.value.size();
+		}
+		t0=ODBCMicros();
+		feeder->executeUpdate();
+		stats.Executed(ODBCMicros()-t0, count, bytes);
+		return 1;
+	} catch(SQLException& e) {
+		if(Lost(e))
+			return -1;
+		if(count == 1)
+			cout << "Exception caught: "<<e.getMessage()<<endl;
+	}
+	return 0;
+}
+
+/*	the connection's statement for sql, prepared the first time it's asked
+ *	for.  sql carries ? for every value, so each statement shape is prepared
+ *	once per connection however many objects use it.  the statement stays
+ *	the handle's; use it, and finish with any result set, without letting go
+ *	of the lock.  caller holds the lock.  throws SQLException.
+ */
+odbc::PreparedStatement *ODBCConnHandle::Prepare(const string &sql){
+	map<string, odbc::PreparedStatement *>::iterator itr=statements.find(sql);
+	if(itr != statements.end()) return itr->second;
+	double t0=ODBCMicros();
+	odbc::PreparedStatement *stmt=conn->prepareStatement(sql);
+	stats.Prepared(ODBCMicros()-t0);
+	statements[sql]=stmt;
+	return stmt;
+}
+
+//	drops every statement prepared on the connection
+void ODBCConnHandle::FreeInserts(){
+	map<int, odbc::PreparedStatement *>::iterator itr;
+	map<string, odbc::PreparedStatement *>::iterator sitr;
+	for(itr=inserts.begin(); itr != inserts.end(); ++itr)
+		delete itr->second;
+	inserts.clear();
+	for(sitr=statements.begin(); sitr != statements.end(); ++sitr)
+		delete sitr->second;
+	statements.clear();
+	delete statsinsert;
+	statsinsert=0;
+}
+
+void ODBCConnHandle::RunStats(void *vp){
+	ODBCConnHandle *handle=(ODBCConnHandle *)vp;
+	while(!handle->statsstop.Wait((unsigned long)handle->options.statsperiod*1000))
+		handle->WriteStats(0);
+}
+
+/*	adds a STATS_TABLE row for tape, or for every open tape and then the
+ *	connection if tape is 0, making the table the first time.  the counts
+ *	are totals since each tape opened.  returns 0 if nothing was written.
+ */
+int ODBCConnHandle::WriteStats(ODBCTapeStream *tape){
+	ODBCCounters counters;
+	char now[64];
+	time_t t=time(NULL);
+	list<ODBCTapeStream *>::iterator itr;
+	ODBCLocker locker(connlock);
+	if(down && !Reconnect())
+		return 0;
+	strftime(now, sizeof(now), "%Y-%m-%d %H:%M:%S", localtime(&t));
+	try{
+		if(!statscreated){
+			odbc::Statement *stmt=conn->createStatement();
+			try{
+				stmt->executeUpdate("CREATE TABLE STATS_TABLE (STATS_TIME VARCHAR(32), STATS_KIND VARCHAR(16), STATS_NAME VARCHAR(128),"
+					" STATS_ROWS INTEGER, STATS_BYTES DOUBLE PRECISION, STATS_RETRIES INTEGER, STATS_QUEUE INTEGER, STATS_QUEUE_MAX INTEGER,"
+					" STATS_PREPARES INTEGER, STATS_PREPARE_P50 DOUBLE PRECISION, STATS_PREPARE_P99 DOUBLE PRECISION,"
+					" STATS_EXECUTES INTEGER, STATS_EXECUTE_P50 DOUBLE PRECISION, STATS_EXECUTE_P99 DOUBLE PRECISION, STATS_EXECUTE_MAX DOUBLE PRECISION)");
+			} catch(SQLException& e) {
+				if(Lost(e)){
+					delete stmt;
+					return 0;
+				}	//	otherwise it's there already
+			}
+			delete stmt;
+			statscreated=1;
+		}
+		if(statsinsert == 0)
+			statsinsert=conn->prepareStatement("INSERT INTO STATS_TABLE VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)");
+		if(tape != 0){
+			tape->GetStats().Get(counters);
+			InsertStats(now, "tape", tape->GetName(), counters);
+		} else {
+			for(itr=tapelist.begin(); itr != tapelist.end(); ++itr){
+				(*itr)->GetStats().Get(counters);
+				InsertStats(now, "tape", (*itr)->GetName(), counters);
+			}
+			stats.Get(counters);
+			InsertStats(now, "connection", servername, counters);
+		}
+		CountWork(0, 0);
+		return 1;
+	} catch(SQLException& e) {
+		if(!Lost(e))
+			cout << "Exception caught: "<<e.getMessage()<<endl;
+	}
+	return 0;
+}
+
+//	one STATS_TABLE row.  caller holds the lock.  throws SQLException.
+void ODBCConnHandle::InsertStats(char *now, const char *kind, const char *name, ODBCCounters &c){
+	statsinsert->setString(1, now);
+	statsinsert->setString(2, kind);
+	statsinsert->setString(3, name);
+	statsinsert->setInt(4, (int)c.rows);
+	statsinsert->setDouble(5, c.bytes);
+	statsinsert->setInt(6, (int)c.retries);
+	statsinsert->setInt(7, (int)c.queue);
+	statsinsert->setInt(8, (int)c.queuemax);
+	statsinsert->setInt(9, (int)c.prepare.GetCount());
+	statsinsert->setDouble(10, c.prepare.Percentile(0.50));
+	statsinsert->setDouble(11, c.prepare.Percentile(0.99));
+	statsinsert->setInt(12, (int)c.execute.GetCount());
+	statsinsert->setDouble(13, c.execute.Percentile(0.50));
+	statsinsert->setDouble(14, c.execute.Percentile(0.99));
+	statsinsert->setDouble(15, c.execute.GetMax());
+	statsinsert->executeUpdate();
+}
+
+//	at the end of the run: prints the connection's totals and writes its last row, as asked
+void ODBCConnHandle::ReportStats(){
+	ODBCCounters counters;
+	if(options.stats){
+		stats.Get(counters);
+		counters.Print("connection", servername);
+	}
+	if(options.statsperiod > 0){
+		WriteStats(0);
+		Commit();
+	}
+}
+
 //	end of ODBCConnHandle.cpp
@@ -10,21 +10,45 @@
 #define _ODBCCONNHANDLE_H_
 
 #include <list>
+#include <map>
+#include <string>
+#include <vector>
 #include <string.h>
 
 #include <odbc++/connection.h>
+#include <odbc++/databasemetadata.h>
 #include <odbc++/drivermanager.h>
+#include <odbc++/preparedstatement.h>
 
 #include "ODBCTapeStream.h"
+#include "ODBCTapeOptions.h"
+#include "ODBCThread.h"
+#include "ODBCWriter.h"
+#include "ODBCJournal.h"
+#include "ODBCBulk.h"
+#include "ODBCReader.h"
+#include "ODBCPlayerSource.h"
+#include "ODBCSchema.h"
+#include "ODBCStats.h"
+#include "ODBCGroup.h"
+#include "ODBCRun.h"
 
 using std::list;
+using std::map;
+using std::string;
+using std::vector;
+
+//	reconnect backoff in milliseconds, and rows held while disconnected
+#define ODBC_MINBACKOFF		250
+#define ODBC_MAXBACKOFF		30000
+#define ODBC_MAXDOWNROWS	100000
 
 class ODBCTapeStream;
 
 class ODBCConnHandle{
 public:
 	ODBCConnHandle();
-	ODBCConnHandle(Connection *, char *);
+	ODBCConnHandle(Connection *, char *, char *, char *);
 	~ODBCConnHandle();
 
 	void Reset();
@@ -32,13 +56,87 @@ public:
 	void DisconnectTape(ODBCTapeStream *);
 	void Disconnect();
 	int RegisterStream(ODBCTapeStream *);
+	int GetTapeCount();
+	int Check();
+	int Lost(SQLException &);
+
+	int Configure(ODBCTapeOptions *);
+	int QueueEvent(char *, int, char *, char *);
+	int Flush();
+	int WriteGroup(vector<eventrow> &);
+	int WriteJournal(vector<eventrow> &);
+	int Abandon();
+	int LoadBulk(const char *, long, double);
+	void CountWork(int, int);
+	int Commit();
+	ODBCGroup *JoinGroup(char *);
+	ODBCPlayerSource *GetSource();
+	void OpenRun();
+	odbc::PreparedStatement *Prepare(const string &);
+	int WriteStats(ODBCTapeStream *);
+	void ReportStats();
 
 	odbc::Connection *GetConn(){return conn;}
+	char *GetName(){return servername;}
+	ODBCLock &GetLock(){return connlock;}	//	hold while using GetConn()
+	ODBCReader *GetReader(){return reader;}	//	0 unless readahead
+	ODBCSchema *GetReadSchema(){return &readschema;}	//	EVENT_TABLE
+	ODBCStats &GetStats(){return stats;}
+	int StatsWanted(){return options.stats;}
+	int StatsPeriod(){return options.statsperiod;}
+	const char *GetRun(){return options.run;}	//	"" for the shared tables
+	string RunTable(const char *base){return ODBCRun::Table(base, options.run);}
 private:
+	int BufferEvent(eventrow &);
+	int WriteBuffer();
+	odbc::PreparedStatement *GetInsert(int);
+	int InsertRows(size_t, int);
+	void FreeInserts();
+	void SetCommit();
+	int Reconnect();
+	void InsertStats(char *, const char *, const char *, ODBCCounters &);
+	static void RunStats(void *);
+
 	odbc::Connection *conn;
 	char	servername[128];
+	char	uid[256];
+	char	pwd[64];
 	int		tapect;
 	list<ODBCTapeStream *> tapelist;
+
+	ODBCTapeOptions	options;
+	int		configured;
+	int		multirow;		//	cleared if the driver rejects multi-row VALUES
+	vector<eventrow> rows;
+	size_t	rowbytes;
+	map<int, odbc::PreparedStatement *> inserts;	//	keyed by row count
+	map<string, odbc::PreparedStatement *> statements;	//	Prepare's, keyed by SQL
+	ODBCWriter		*writer;	//	0 unless async
+	ODBCJournal		*journal;	//	0 unless journal
+	ODBCBulk		*bulk;		//	0 unless bulk
+	int				bulkloader;	//	ODBCBULKLOADER, -1 until asked
+	ODBCReader		*reader;	//	0 unless readahead
+	ODBCPlayerSource	*source;	//	0 until a shared player opens
+	ODBCLock		connlock;
+	int		transactions;	//	-1 until asked
+	int		manual;			//	autocommit is off, the commit policy is in charge
+	int		uncommitted;	//	rows written since the last commit
+	unsigned long	txnstart;	//	ODBCMillis() at the last commit
+	string	steptime;		//	timestamp of the last row buffered
+	ODBCSchema		writeschema;	//	OBJECT_TABLE
+	ODBCSchema		readschema;		//	EVENT_TABLE
+	map<string, ODBCGroup *> groups;
+	int		down;			//	the link is lost, rows are held
+	unsigned long	backoff;	//	ms before the next reconnect try
+	unsigned long	retryat;
+	long	dropped;		//	rows refused while down
+	list<odbc::Connection *> retired;	//	replaced by reconnects
+	ODBCStats		stats;
+	odbc::PreparedStatement	*statsinsert;	//	STATS_TABLE row, 0 until needed
+	int				statscreated;
+	int				runopen;		//	OpenRun has been called
+	ODBCThread		statsthread;	//	writes STATS_TABLE every stats= seconds
+	ODBCSignal		statsstop;
 };
 
 #endif
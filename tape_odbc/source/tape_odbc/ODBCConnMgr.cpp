@@ -9,58 +9,116 @@
 #include "ODBCConnMgr.h"
 
 ODBCConnMgr *ODBCConnMgr::mgr=0;
+ODBCLock ODBCConnMgr::mgrlock;
 
 ODBCConnMgr::ODBCConnMgr(){
 	mgr=this;
-	handles.clear();
+	pools.clear();
 }
 
 ODBCConnMgr::~ODBCConnMgr(){
+	map<string, vector<ODBCConnHandle *> >::iterator itr;
 	mgr=0;
-	while(!handles.empty()){
-		delete handles.front();
-		handles.pop_front();
-	}
+	for(itr=pools.begin(); itr != pools.end(); ++itr)
+		for(size_t i=0; i < itr->second.size(); ++i)
+			delete itr->second[i];
+	pools.clear();
+	affinity.clear();
 }
 
 ODBCConnMgr *ODBCConnMgr::GetMgr(){
+	ODBCLocker locker(mgrlock);	//	tapes may open on several threads at once
 	if(mgr == 0) return new ODBCConnMgr();
 	return mgr;
 }
 
-ODBCConnHandle *ODBCConnMgr::ConnectToHost(char *hostname, char *uid, char *pwd){
-	if(!handles.empty()){
-		list<ODBCConnHandle *>::iterator itr=handles.begin();
-		do{
-			if(0 == (*itr)->CheckName(hostname)) return *itr;
-		} while(itr!=handles.end());
+ODBCConnHandle *ODBCConnMgr::ConnectToHost(char *hostname, char *uid, char *pwd, ODBCTapeOptions *opts){
+	char tid[32];
+	ODBCLocker locker(lock);
+	string key=string(hostname)+"\n"+uid;
+	sprintf(tid, "\n%lu", ODBCThreadId());
+	//	a group's recorders have to share one connection, so groups use the pool's first
+	if(opts != 0 && opts->group[0] != 0 && !pools[key].empty()){
+		pools[key][0]->Check();
+		return pools[key][0];
+	}
+	map<string, ODBCConnHandle *>::iterator aff=affinity.find(key+tid);
+	if(aff != affinity.end()){
+		aff->second->Check();	//	reconnects if it's down and due a retry
+		return aff->second;
+	}
+	//	the first tape to ask sizes the pool
+	if(poolsize.find(key) == poolsize.end())
+		poolsize[key]=(opts != 0 && opts->poolsize > 0 ? opts->poolsize : 1);
+	vector<ODBCConnHandle *> &pool=pools[key];
+	ODBCConnHandle *handle=0;
+	if((int)pool.size() >= poolsize[key]){
+		//	share the least busy one
+		handle=pool[0];
+		for(size_t i=1; i < pool.size(); ++i)
+			if(pool[i]->GetTapeCount() < handle->GetTapeCount())
+				handle=pool[i];
+		handle->Check();
+		affinity[key+tid]=handle;
+		return handle;
 	}
 	//	guess we aren't connected to that host.
 //	then again, let's give it a shot.  -MH
 //	if((uid == null) || (pwd == null)) return null;	//	no uid or pwd, auto-fail.
-	odbc::Connection *conn=odbc::DriverManager::getConnection(hostname, uid, pwd);
+	odbc::Connection *conn=0;
+	try{
+		conn=odbc::DriverManager::getConnection(hostname, uid, pwd);
+	} catch(SQLException& e) {
+		cout << "Exception caught: "<<e.getMessage()<<endl;
+		conn=0;
+	}
 	if(conn != 0){
-		handles.push_back(new ODBCConnHandle(conn, hostname));
+		handle=new ODBCConnHandle(conn, hostname, uid, pwd);
+		pool.push_back(handle);
+		affinity[key+tid]=handle;
 	} else {
 		printf("WARNING:\tODBCConnMgr::ConnectToHost: unable to connect to host %s with uid %s!\n", hostname, uid);
 		return 0;
 	}
-	return handles.back();
+	return handle;
 }
 
+//	closes every pooled connection to hostname
 int ODBCConnMgr::DisconnectFromHost(char *hostname){
-	if(!handles.empty()){
-		list<ODBCConnHandle *>::iterator itr=handles.begin();
-		do{
-			if(0 == (*itr)->CheckName(hostname)){
-				(*itr)->Disconnect();
-				handles.erase(itr);
-				return 1;
+	ODBCLocker locker(lock);
+	map<string, vector<ODBCConnHandle *> >::iterator itr;
+	map<string, ODBCConnHandle *>::iterator aff;
+	int found=0;
+	for(itr=pools.begin(); itr != pools.end(); ){
+		if(itr->second.empty() || 0 != itr->second[0]->CheckName(hostname)){
+			++itr;
+			continue;
+		}
+		for(size_t i=0; i < itr->second.size(); ++i){
+			for(aff=affinity.begin(); aff != affinity.end(); ){
+				if(aff->second == itr->second[i])
+					affinity.erase(aff++);
+				else
+					++aff;
 			}
-		} while(itr!=handles.end());
+			itr->second[i]->Disconnect();
+			delete itr->second[i];
+		}
+		pools.erase(itr++);
+		found=1;
 	}
+	if(found) return 1;
 	printf("WARNING:\tODBCConnMgr::DisconnectFromHost(%s): we're not connected to that host!\n", hostname);
 	return 0;
 }
 
+//	prints or writes every connection's stats, for those that asked
+void ODBCConnMgr::ReportStats(){
+	ODBCLocker locker(lock);
+	map<string, vector<ODBCConnHandle *> >::iterator itr;
+	for(itr=pools.begin(); itr != pools.end(); ++itr)
+		for(size_t i=0; i < itr->second.size(); ++i)
+			itr->second[i]->ReportStats();
+}
+
 //	end of ODBCConnMgr.cpp
@@ -8,6 +8,11 @@
  *	The observer routines will hypothetically clean the objects and
  *		gracefully kill the app if a database connection is lost when
  *		I/O is needed.
+ *	Connections are pooled by DSN and user.  A pool holds up to pool=N
+ *		connections; a thread keeps getting the connection it got first,
+ *		and new threads get a new connection until the pool is full, then
+ *		the one with the fewest tapes.  Tapes in a group= all get the
+ *		pool's first connection.  All of this is under one lock.
  *	author: Matt Hauer, matthew.hauer@pnl.gov, 6/4/07 - ***
  */
 
@@ -15,8 +20,13 @@
 #define _ODBCCONNMGR_H_
 
 #include <list>
+#include <map>
+#include <string>
+#include <vector>
 
 #include "ODBCConnHandle.h"
+#include "ODBCTapeOptions.h"
+#include "ODBCThread.h"
 
 using namespace std;
 
@@ -26,14 +36,19 @@ class ODBCConnMgr{
 public:
 	~ODBCConnMgr();
 
-	ODBCConnHandle *ConnectToHost(char *, char *, char *);
+	ODBCConnHandle *ConnectToHost(char *, char *, char *, ODBCTapeOptions *opts=0);
 	int DisconnectFromHost(char *);
+	void ReportStats();
 	static ODBCConnMgr *GetMgr();
 private:
 	ODBCConnMgr();
 
-	list<ODBCConnHandle *>	handles;
+	map<string, vector<ODBCConnHandle *> >	pools;		//	by DSN and user
+	map<string, ODBCConnHandle *>			affinity;	//	by DSN, user, and thread
+	map<string, int>						poolsize;
+	ODBCLock				lock;
 	static ODBCConnMgr *mgr;
+	static ODBCLock mgrlock;
 };
 
 #endif
@@ -0,0 +1,154 @@
+/*	$Id$
+	Copyright (C) 2008 Battelle Memorial Institute
+
+ *	Polling reads for players that follow a table as it's written.
+ */
+
+#include <limits.h>
+
+#include "ODBCFollower.h"
+#include "ODBCConnHandle.h"
+
+using std::cout;
+using std::endl;
+
+ODBCFollower::ODBCFollower(ODBCConnHandle *h, int ahead, int wait){
+	handle=h;
+	schema=0;
+	lookahead=(ahead > 0 ? ahead : 3600);
+	waitms=(wait > 0 ? (unsigned long)wait*1000 : 0);
+	tapestats=0;
+	connstats=0;
+	Restart();
+}
+
+//	follows object in table from the first row at or after start, or from the top if start is empty
+void ODBCFollower::Open(ODBCSchema *sch, const string &tbl, const string &obj, const string &start, ODBCStats *t, ODBCStats *c){
+	schema=sch;
+	table=tbl;
+	object=obj;
+	from=start;
+	tapestats=t;
+	connstats=c;
+	Restart();
+}
+
+int ODBCFollower::Seek(char *timestamp){
+	from=(timestamp != 0 ? timestamp : "");
+	Restart();
+	return 1;
+}
+
+int ODBCFollower::Rewind(){
+	Restart();
+	return 1;
+}
+
+//	forgets what was read and puts the watermark back where the tape starts
+void ODBCFollower::Restart(){
+	rows.clear();
+	marktime=from;
+	markline=INT_MIN;	//	every line at from
+	ended=0;
+}
+
+/*	the next row to play, polling until one is written or wait= runs out,
+ *	when it returns 0 and the tape ends.  the row is good until the next call.
+ */
+eventrow *ODBCFollower::Next(){
+	unsigned long began=ODBCMillis(), pause=ODBC_FOLLOW_MINPOLL, waited;
+	if(ended)
+		return 0;
+	while(rows.empty()){
+		if(Poll() > 0)
+			break;
+		waited=ODBCMillis()-began;
+		if(waitms > 0 && waited >= waitms){
+			printf("WARNING:\tODBCFollower::Next: nothing new for %s past %s in %lu s, ending its tape\n",
+				object.c_str(), marktime.empty() ? "the top" : marktime.c_str(), waitms/1000);
+			ended=1;
+			return 0;
+		}
+		if(waitms > 0 && pause > waitms-waited)
+			pause=waitms-waited;
+		wake.Wait(pause);
+		pause=(pause*2 > ODBC_FOLLOW_MAXPOLL ? ODBC_FOLLOW_MAXPOLL : pause*2);
+	}
+	played=rows.front();
+	rows.pop_front();
+	return &played;
+}
+
+/*	reads the rows past the watermark, up to lookahead seconds beyond it.
+ *	if there are none, reads just the next row, however far on, so a gap
+ *	longer than lookahead doesn't stall the tape.  returns the rows read;
+ *	0 if the link is down, which counts as nothing written yet.
+ */
+int ODBCFollower::Poll(){
+	odbc::Long t;
+	char until[32];
+	int count;
+	ODBCLocker locker(handle->GetLock());
+	if(!handle->Check())
+		return 0;
+	try{
+		if(!marktime.empty() && ODBCTimeToEpoch(marktime.c_str(), &t)){
+			ODBCEpochToTime(t+lookahead, until);
+			count=Fetch(1, until, 0);
+			if(count > 0)
+				return count;
+		}
+		return Fetch(!marktime.empty(), 0, 1);
+	} catch(odbc::SQLException& e) {
+		if(!handle->Lost(e))
+			cout << "Exception caught: "<<e.getMessage()<<endl;
+	}
+	return 0;
+}
+
+/*	queues up to limit rows (0 for all of them) past the watermark, if
+ *	after, and before until, if that's given, and moves the watermark to
+ *	the last one.  each form is prepared once per connection.  caller holds
+ *	the connection lock.  throws SQLException.
+ */
+int ODBCFollower::Fetch(int after, const char *until, int limit){
+	string sql="SELECT "+schema->Columns()+", EVENT_LINE FROM "+table+" WHERE EVENT_OBJECT_NAME=?";
+	int idx=1, count=0, linecol=schema->Params()+1;
+	double t0, bytes=0.0;
+	if(after)
+		sql += " AND EVENT_TIME >= ? AND (EVENT_TIME > ? OR EVENT_LINE > ?)";
+	if(until != 0)
+		sql += " AND EVENT_TIME < ?";
+	sql += " ORDER BY EVENT_TIME, EVENT_LINE";
+	odbc::PreparedStatement *stmt=handle->Prepare(sql);
+	stmt->setString(idx++, object);
+	if(after){
+		schema->BindTime(stmt, idx++, marktime);
+		schema->BindTime(stmt, idx++, marktime);
+		stmt->setInt(idx++, markline);
+	}
+	if(until != 0)
+		schema->BindTime(stmt, idx++, until);
+	t0=ODBCMicros();
+	odbc::ResultSet *rs=stmt->executeQuery();
+	while((limit == 0 || count < limit) && rs->next()){
+		rows.push_back(eventrow());
+		schema->Decode(rs, rows.back());
+		rows.back().line=rs->getInt(linecol);
+		bytes += rows.back().timestamp.size() + rows.back().value.size() + sizeof(int);
+		++count;
+	}
+	delete rs;
+	t0=ODBCMicros()-t0;
+	if(tapestats != 0)
+		tapestats->Executed(t0, count, bytes);
+	if(connstats != 0)
+		connstats->Executed(t0, count, bytes);
+	if(count > 0){
+		marktime=rows.back().timestamp;
+		markline=rows.back().line;
+	}
+	return count;
+}
+
+//	end of ODBCFollower.cpp
@@ -0,0 +1,66 @@
+/*	$id$
+	Copyright (C) 2008 Battelle Memorial Institute
+
+ *	A player that follows EVENT_TABLE while another process is still
+ *		writing it, as in a co-simulation.  With follow, each poll reads the
+ *		rows past a watermark, the time and line of the last row read, up
+ *		to lookahead=S seconds of event time beyond it, a range scan an
+ *		index on (EVENT_OBJECT_NAME, EVENT_TIME) serves.  A read that finds
+ *		nothing new polls again, more slowly each time, and the tape ends
+ *		once wait=S seconds pass without a row.  Rows must arrive in time
+ *		order for each object; one written behind the watermark is missed.
+ */
+
+#ifndef _ODBCFOLLOWER_H_
+#define _ODBCFOLLOWER_H_
+
+#include <deque>
+#include <string>
+
+#include <odbc++/preparedstatement.h>
+#include <odbc++/resultset.h>
+
+#include "ODBCSchema.h"
+#include "ODBCStats.h"
+#include "ODBCThread.h"
+#include "TapeStream.h"
+
+using std::deque;
+using std::string;
+
+//	ms between polls that find nothing, doubling up to the maximum
+#define ODBC_FOLLOW_MINPOLL		50
+#define ODBC_FOLLOW_MAXPOLL		1000
+
+class ODBCConnHandle;
+
+class ODBCFollower{
+public:
+	ODBCFollower(ODBCConnHandle *, int, int);
+
+	void Open(ODBCSchema *, const string &, const string &, const string &, ODBCStats *, ODBCStats *);
+	int Seek(char *);
+	int Rewind();
+	eventrow *Next();
+	int More(){return !ended;}
+private:
+	void Restart();
+	int Poll();
+	int Fetch(int, const char *, int);
+
+	ODBCConnHandle	*handle;
+	ODBCSchema		*schema;
+	string			table, object;
+	string			from;		//	where the tape starts, "" for the top
+	int				lookahead;	//	seconds of event time per poll
+	unsigned long	waitms;		//	how long a read waits for a row, 0 for ever
+	string			marktime;	//	the watermark: the last row read, "" before any
+	int				markline;
+	deque<eventrow>	rows;		//	read, not yet played
+	eventrow		played;		//	the row Next last returned
+	int				ended;		//	a read gave up waiting
+	ODBCSignal		wake;		//	never set; paces the polls
+	ODBCStats		*tapestats, *connstats;
+};
+
+#endif
@@ -0,0 +1,191 @@
+/*	$Id$
+	Copyright (C) 2008 Battelle Memorial Institute
+
+ *	One row per timestamp for a group of recorders.
+ */
+
+#include <ctype.h>
+
+#include "ODBCGroup.h"
+#include "ODBCConnHandle.h"
+
+ODBCGroup::ODBCGroup(ODBCConnHandle *h, char *name){
+	handle=h;
+	table=h->RunTable(name);
+	frozen=0;
+	failed=0;
+	insert=0;
+	pending=0;
+}
+
+ODBCGroup::~ODBCGroup(){
+	Flush();
+	ODBCLocker locker(handle->GetLock());
+	delete insert;
+}
+
+//	adds a column for a recorder.  returns its index, or -1 if it has to go to OBJECT_TABLE.
+int ODBCGroup::Join(char *objname){
+	char buffer[64];
+	size_t i;
+	ODBCLocker locker(lock);
+	if(frozen){
+		printf("WARNING:\tODBCGroup::Join: group %s was laid out before %s opened, it will write to OBJECT_TABLE\n", table.c_str(), objname);
+		return -1;
+	}
+	if(objects.size() >= ODBC_MAXGROUPCOLS){
+		printf("WARNING:\tODBCGroup::Join: group %s is full at %i columns, %s will write to OBJECT_TABLE\n", table.c_str(), ODBC_MAXGROUPCOLS, objname);
+		return -1;
+	}
+	//	column names are the object name as an identifier, made unique
+	for(i=0; objname[i] != 0 && i < 48; ++i)
+		buffer[i]=isalnum((unsigned char)objname[i]) ? toupper(objname[i]) : '_';
+	buffer[i]=0;
+	string col=(isalpha((unsigned char)buffer[0]) ? "" : "C_");
+	col += buffer;
+	string base=col;
+	for(int n=2; ; ++n){
+		for(i=0; i < columns.size() && columns[i] != col; ++i);
+		if(i == columns.size()) break;
+		sprintf(buffer, "_%i", n);
+		col=base+buffer;
+	}
+	objects.push_back(objname);
+	columns.push_back(col);
+	lines.push_back(0);
+	values.push_back("");
+	have.push_back(0);
+	return (int)objects.size()-1;
+}
+
+//	puts a recorder's value in the current row, writing the row first if the timestamp moved on
+int ODBCGroup::Set(int col, char *timestamp, char *value){
+	int written=0;
+	ODBCLocker locker(lock);
+	if(pending && curtime != timestamp)
+		written=WriteRow();
+	curtime=timestamp;
+	values[col]=value;
+	have[col]=1;
+	pending=1;
+	return written;
+}
+
+int ODBCGroup::Flush(){
+	ODBCLocker locker(lock);
+	return pending ? WriteRow() : 0;
+}
+
+//	drops the insert after a reconnect; the next row prepares it again.  caller holds the connection lock.
+void ODBCGroup::Unprepare(){
+	delete insert;
+	insert=0;
+}
+
+//	fixes the column layout, makes sure the table is there, and prepares the insert
+int ODBCGroup::Freeze(){
+	string sql;
+	size_t i;
+	frozen=1;
+	ODBCLocker locker(handle->GetLock());
+	//	try to create the table; if it's already there that's fine too
+	sql="CREATE TABLE "+table+" (GROUP_TIME VARCHAR(32)";
+	for(i=0; i < columns.size(); ++i)
+		sql += ", "+columns[i]+" VARCHAR(32)";
+	sql += ")";
+	try{
+		odbc::Statement *stmt=handle->GetConn()->createStatement();
+		try{
+			stmt->executeUpdate(sql);
+			ODBCRun::Register(handle, handle->GetRun(), table);
+		} catch(SQLException&) {
+			;	//	exists already, the insert will tell us if it doesn't fit
+		}
+		delete stmt;
+	} catch(SQLException& e) {
+		if(!handle->Lost(e))
+			cout << "Exception caught: "<<e.getMessage()<<endl;
+	}
+	return Prepare();
+}
+
+int ODBCGroup::Prepare(){
+	string sql;
+	size_t i;
+	ODBCLocker locker(handle->GetLock());
+	sql="INSERT INTO "+table+" (GROUP_TIME";
+	for(i=0; i < columns.size(); ++i)
+		sql += ", "+columns[i];
+	sql += ") VALUES (?";
+	for(i=0; i < columns.size(); ++i)
+		sql += ", ?";
+	sql += ")";
+	try{
+		double t0=ODBCMicros();
+		insert=handle->GetConn()->prepareStatement(sql);
+		handle->GetStats().Prepared(ODBCMicros()-t0);
+	} catch(SQLException& e) {
+		if(handle->Lost(e))
+			return 0;	//	try again once it's back
+		cout << "Exception caught: "<<e.getMessage()<<endl;
+		printf("WARNING:\tODBCGroup::Prepare: can't write group %s as a table, writing to OBJECT_TABLE\n", table.c_str());
+		failed=1;
+	}
+	return !failed;
+}
+
+int ODBCGroup::WriteRow(){
+	size_t i;
+	int written=0, narrow=0;
+	if(!frozen)
+		Freeze();
+	else if(insert == 0 && !failed && handle->Check())
+		Freeze();	//	again, on the new connection
+	if(failed || insert == 0){
+		narrow=1;	//	for good, or while the connection is down
+	} else {
+		ODBCLocker locker(handle->GetLock());
+		try{
+			double bytes=curtime.size(), t0;
+			insert->setString(1, curtime);
+			for(i=0; i < columns.size(); ++i){
+				if(have[i]){
+					insert->setString(i+2, values[i]);
+					bytes += values[i].size();
+				} else
+					insert->setNull(i+2, Types::VARCHAR);
+			}
+			t0=ODBCMicros();
+			insert->executeUpdate();
+			handle->GetStats().Executed(ODBCMicros()-t0, 1, bytes);
+			written=1;
+			handle->CountWork(1, 1);	//	a group row is a whole timestep
+		} catch(SQLException& e) {
+			if(!handle->Lost(e)){
+				cout << "Exception caught: "<<e.getMessage()<<endl;
+				printf("WARNING:\tODBCGroup::WriteRow: %s rejected a group row, writing to OBJECT_TABLE from now on\n", table.c_str());
+				failed=1;
+			} else
+				Unprepare();	//	prepared again after the reconnect
+			narrow=1;
+		}
+	}
+	if(narrow){
+		//	narrow rows, as if the recorders weren't grouped
+		for(i=0; i < columns.size(); ++i){
+			if(have[i]){
+				handle->QueueEvent((char *)objects[i].c_str(), ++lines[i], (char *)curtime.c_str(), (char *)values[i].c_str());
+				++written;
+			}
+		}
+	} else {
+		for(i=0; i < columns.size(); ++i)
+			if(have[i]) ++lines[i];
+	}
+	for(i=0; i < columns.size(); ++i)
+		have[i]=0;
+	pending=0;
+	return written;
+}
+
+//	end of ODBCGroup.cpp
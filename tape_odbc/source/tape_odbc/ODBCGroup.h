@@ -0,0 +1,64 @@
+/*	$id$
+	Copyright (C) 2008 Battelle Memorial Institute
+
+ *	Wide-row recording.  Recorders that name the same group on the same
+ *		connection each get a column in one table, and everything they
+ *		write for a timestamp goes out as a single row:
+ *			GROUP_TIME, <recorder 1>, <recorder 2>, ...
+ *	The layout is fixed when the first timestamp is done, by which time
+ *		every recorder in the group has opened and written once; later
+ *		joiners, and groups the database won't take, fall back to
+ *		ordinary OBJECT_TABLE rows.
+ */
+
+#ifndef _ODBCGROUP_H_
+#define _ODBCGROUP_H_
+
+#include <string>
+#include <vector>
+
+#include <odbc++/connection.h>
+#include <odbc++/preparedstatement.h>
+
+#include "ODBCThread.h"
+
+using std::string;
+using std::vector;
+
+//	drivers commonly cap a table at ~1000 columns
+#define ODBC_MAXGROUPCOLS	1000
+
+class ODBCConnHandle;
+
+class ODBCGroup{
+public:
+	ODBCGroup(ODBCConnHandle *, char *);
+	~ODBCGroup();
+
+	int Join(char *);
+	int Set(int, char *, char *);
+	int Flush();
+	void Unprepare();
+	const char *GetName(){return table.c_str();}
+private:
+	int Freeze();
+	int Prepare();
+	int WriteRow();
+
+	ODBCConnHandle			*handle;
+	string					table;
+	vector<string>			objects;	//	tape object names, by column
+	vector<string>			columns;	//	column names, by column
+	vector<int>				lines;		//	rows written, by column
+	int						frozen;
+	int						failed;		//	write OBJECT_TABLE rows instead
+	odbc::PreparedStatement	*insert;
+
+	string					curtime;	//	timestamp of the row being filled
+	vector<string>			values;
+	vector<char>			have;
+	int						pending;
+	ODBCLock				lock;		//	recorders may write from several threads
+};
+
+#endif
@@ -0,0 +1,373 @@
+/*	$Id$
+	Copyright (C) 2008 Battelle Memorial Institute
+
+ *	Memory-mapped journal and upload thread for ODBC recorders and collectors.
+ */
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "ODBCJournal.h"
+#include "ODBCConnHandle.h"
+
+//	a record is its length and line, then the object, time, and value as C
+//		strings, padded out to a multiple of four bytes
+#define ODBC_JRNL_RECORD	(2*sizeof(int))
+
+set<string> ODBCJournal::names;
+ODBCLock ODBCJournal::nameslock;
+
+//	the string after s, or 0 if s isn't terminated before end
+static char *next_string(char *s, char *end){
+	char *nul=(char *)memchr(s, 0, end-s);
+	return nul == 0 ? 0 : nul+1;
+}
+
+ODBCJournal::ODBCJournal(ODBCConnHandle *h, ODBCTapeOptions *opts){
+	handle=h;
+	filename[0]=0;
+	base=0;
+	jh=0;
+#ifdef WIN32
+	file=INVALID_HANDLE_VALUE;
+	mapping=0;
+#else
+	fd=-1;
+#endif
+	take=opts->queuesize;
+	dropped=0;
+	busy=0;
+	stalled=0;
+	stop=0;
+	if(!Open(opts->journal))
+		return;
+	if(!thread.Start(Run, this))
+		printf("WARNING:\tODBCJournal::ODBCJournal: unable to start the upload thread, rows will be uploaded when tapes close\n");
+}
+
+ODBCJournal::~ODBCJournal(){
+	Stop();
+	if(base != 0 && jh->head > jh->tail)
+		printf("WARNING:\tODBCJournal: %li rows are still in %s, they'll be uploaded the next time it's used\n", (long)Pending(), filename);
+	Close();
+}
+
+/*	opens or creates the journal.  a journal name another connection in this
+ *	process already has gets a ".2", ".3", and so on.  an existing file is only
+ *	used if it's a journal; returns 0 if there's no usable file.
+ */
+int ODBCJournal::Open(char *name){
+	unsigned long existing;
+	int n;
+	{
+		ODBCLocker locker(nameslock);
+		strncpy(filename, name, 255);
+		filename[255]=0;
+		for(n=2; names.count(filename) > 0; ++n)
+			sprintf(filename, "%.240s.%i", name, n);
+		names.insert(filename);
+	}
+#ifdef WIN32
+	file=CreateFileA(filename, GENERIC_READ|GENERIC_WRITE, 0, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if(file == INVALID_HANDLE_VALUE){
+		printf("WARNING:\tODBCJournal::Open: unable to open %s, rows won't be journaled\n", filename);
+		Close();
+		return 0;
+	}
+	existing=GetFileSize(file, NULL);
+#else
+	struct stat st;
+	fd=open(filename, O_RDWR|O_CREAT, 0644);
+	if(fd < 0 || fstat(fd, &st) != 0){
+		printf("WARNING:\tODBCJournal::Open: unable to open %s, rows won't be journaled\n", filename);
+		Close();
+		return 0;
+	}
+	existing=(unsigned long)st.st_size;
+#endif
+	if(existing == 0){
+		if(!Map(ODBC_JRNL_MINSIZE)){
+			printf("WARNING:\tODBCJournal::Open: unable to map %s, rows won't be journaled\n", filename);
+			Close();
+			return 0;
+		}
+		memcpy(jh->magic, ODBC_JRNL_MAGIC, 8);
+		jh->head=ODBC_JRNL_HEAD;
+		jh->tail=ODBC_JRNL_HEAD;
+		return 1;
+	}
+	if(existing < ODBC_JRNL_HEAD || existing > ODBC_JRNL_MAXSIZE || !Map(existing)
+		|| 0 != memcmp(jh->magic, ODBC_JRNL_MAGIC, 8)
+		|| jh->tail < ODBC_JRNL_HEAD || jh->tail > jh->head || jh->head > existing){
+		printf("WARNING:\tODBCJournal::Open: %s isn't a usable tape_odbc journal, leaving it alone and not journaling\n", filename);
+		Close();
+		return 0;
+	}
+	if(jh->head > jh->tail)
+		printf("WARNING:\tODBCJournal::Open: %s has %li rows from an earlier run, uploading them\n", filename, (long)Pending());
+	return 1;
+}
+
+//	maps size bytes of the file, growing it if need be
+int ODBCJournal::Map(unsigned int size){
+#ifdef WIN32
+	mapping=CreateFileMapping(file, NULL, PAGE_READWRITE, 0, size, NULL);
+	if(mapping == 0) return 0;
+	base=(char *)MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, size);
+	if(base == 0){
+		CloseHandle(mapping);
+		mapping=0;
+		return 0;
+	}
+#else
+	void *p;
+	if(ftruncate(fd, size) != 0) return 0;
+	p=mmap(0, size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+	if(p == MAP_FAILED) return 0;
+	base=(char *)p;
+#endif
+	jh=(journalhead *)base;
+	jh->size=size;
+	return 1;
+}
+
+void ODBCJournal::Unmap(){
+	if(base == 0) return;
+#ifdef WIN32
+	UnmapViewOfFile(base);
+	CloseHandle(mapping);
+	mapping=0;
+#else
+	munmap(base, jh->size);
+#endif
+	base=0;
+	jh=0;
+}
+
+void ODBCJournal::Close(){
+	if(base != 0)
+		Sync(1);
+	Unmap();
+#ifdef WIN32
+	if(file != INVALID_HANDLE_VALUE)
+		CloseHandle(file);
+	file=INVALID_HANDLE_VALUE;
+#else
+	if(fd >= 0)
+		close(fd);
+	fd=-1;
+#endif
+	ODBCLocker locker(nameslock);
+	names.erase(filename);
+}
+
+//	pushes the written records toward the disk; wait makes sure they're there
+void ODBCJournal::Sync(int wait){
+#ifdef WIN32
+	FlushViewOfFile(base, jh->head);
+	if(wait)
+		FlushFileBuffers(file);
+#else
+	msync(base, jh->head, wait ? MS_SYNC : MS_ASYNC);
+#endif
+}
+
+/*	makes room for a need-byte record.  sent rows are reclaimed by copying
+ *	the unsent ones down to the front, when they don't overlap, and otherwise
+ *	the file doubles.  caller holds lock.  returns 0 if there's no room.
+ */
+int ODBCJournal::Grow(unsigned int need){
+	unsigned int used=jh->head-jh->tail, size=jh->size, old=jh->size;
+	if(used <= jh->tail-ODBC_JRNL_HEAD && ODBC_JRNL_HEAD+used+need <= size){
+		memcpy(base+ODBC_JRNL_HEAD, base+jh->tail, used);
+		//	head first: a crash between these leaves a journal Open refuses,
+		//		rather than one that replays rows twice
+		jh->head=ODBC_JRNL_HEAD+used;
+		jh->tail=ODBC_JRNL_HEAD;
+		return 1;
+	}
+	while(size < jh->head+need && size <= ODBC_JRNL_MAXSIZE/2)
+		size *= 2;
+	if(size < jh->head+need)
+		return 0;
+	Sync(0);
+	Unmap();
+	if(Map(size))
+		return 1;
+	printf("WARNING:\tODBCJournal::Grow: unable to grow %s to %u bytes\n", filename, size);
+	if(!Map(old))
+		printf("WARNING:\tODBCJournal::Grow: lost the mapping of %s, rows won't be journaled\n", filename);
+	return 0;
+}
+
+//	called from the sync loop.  returns 1 if journaled, 0 if dropped.
+int ODBCJournal::Push(char *object, int line, char *timestamp, char *value){
+	size_t lo=strlen(object)+1, lt=strlen(timestamp)+1, lv=strlen(value)+1;
+	unsigned int len=(unsigned int)((ODBC_JRNL_RECORD+lo+lt+lv+3) & ~(size_t)3);
+	char *rec;
+	lock.Lock();
+	if(base == 0 || (jh->head+len > jh->size && !Grow(len))){
+		++dropped;
+		lock.Unlock();
+		return 0;
+	}
+	rec=base+jh->head;
+	memcpy(rec, &len, sizeof(int));
+	memcpy(rec+sizeof(int), &line, sizeof(int));
+	rec += ODBC_JRNL_RECORD;
+	memcpy(rec, object, lo);
+	memcpy(rec+lo, timestamp, lt);
+	memcpy(rec+lo+lt, value, lv);
+	jh->head += len;	//	last, so a torn record is never counted
+	lock.Unlock();
+	ready.Set();
+	return 1;
+}
+
+/*	sends up to take rows from the tail and moves the tail past the ones the
+ *	database kept.  returns how many that was, or -1 if it kept none.
+ */
+int ODBCJournal::Upload(){
+	vector<eventrow> group;
+	vector<unsigned int> lens;
+	unsigned int at, len;
+	int line, sent;
+	char *rec, *t, *v;
+	size_t i;
+	lock.Lock();
+	if(base == 0){
+		lock.Unlock();
+		return 0;
+	}
+	for(at=jh->tail; at < jh->head && group.size() < take; at += len){
+		rec=base+at;
+		memcpy(&len, rec, sizeof(int));
+		memcpy(&line, rec+sizeof(int), sizeof(int));
+		t=(len < ODBC_JRNL_RECORD || len > jh->head-at) ? 0 : next_string(rec+ODBC_JRNL_RECORD, rec+len);
+		v=(t == 0) ? 0 : next_string(t, rec+len);
+		if(v == 0 || next_string(v, rec+len) == 0){
+			printf("WARNING:\tODBCJournal::Upload: %s is damaged after row %li, dropping the rest\n", filename, (long)group.size());
+			jh->head=at;
+			break;
+		}
+		group.push_back(eventrow(rec+ODBC_JRNL_RECORD, line, t, v));
+		lens.push_back(len);
+	}
+	Sync(0);	//	on its way to the disk before it's sent
+	lock.Unlock();
+	if(group.empty())
+		return 0;
+	sent=handle->WriteJournal(group);
+	lock.Lock();
+	//	by length, not offset, since Grow may have moved the rows meanwhile
+	for(i=0; i < (size_t)sent; ++i)
+		jh->tail += lens[i];
+	lock.Unlock();
+	return sent > 0 ? sent : -1;
+}
+
+/*	returns once everything journaled so far is in the database, or the
+ *	database is away; then the rows stay in the journal, safe on disk.
+ */
+void ODBCJournal::Drain(){
+	lock.Lock();
+	if(base == 0){
+		lock.Unlock();
+		return;
+	}
+	if(!thread.IsRunning()){
+		//	no thread to hand to, so upload from here
+		lock.Unlock();
+		while(Upload() > 0);
+		lock.Lock();
+	} else {
+		stalled=0;	//	give it another try now
+		wake.Set();
+		while((jh->tail != jh->head || busy) && !stalled){
+			lock.Unlock();
+			ready.Set();
+			idle.Wait();
+			lock.Lock();
+		}
+	}
+	if(base != 0)
+		Sync(1);
+	Report();
+	lock.Unlock();
+}
+
+//	caller holds lock
+void ODBCJournal::Report(){
+	if(dropped > 0)
+		printf("WARNING:\tODBCJournal: %s is full, %li rows were dropped\n", filename, dropped);
+	dropped=0;
+}
+
+//	rows not yet in the database
+size_t ODBCJournal::Pending(){
+	size_t count=0;
+	unsigned int at, len;
+	ODBCLocker locker(lock);
+	if(base == 0) return 0;
+	for(at=jh->tail; at < jh->head; at += len, ++count){
+		memcpy(&len, base+at, sizeof(int));
+		if(len < ODBC_JRNL_RECORD) break;
+	}
+	return count;
+}
+
+void ODBCJournal::Stop(){
+	Drain();
+	lock.Lock();
+	stop=1;
+	lock.Unlock();
+	ready.Set();
+	wake.Set();
+	thread.Join();
+}
+
+void ODBCJournal::Run(void *vp){
+	((ODBCJournal *)vp)->Loop();
+}
+
+void ODBCJournal::Loop(){
+	for(;;){
+		lock.Lock();
+		while(base != 0 && jh->tail == jh->head && !stop){
+			//	everything is sent, so start the file over
+			jh->head=ODBC_JRNL_HEAD;
+			jh->tail=ODBC_JRNL_HEAD;
+			lock.Unlock();
+			idle.Set();
+			ready.Wait();
+			lock.Lock();
+		}
+		if(base == 0 || jh->tail == jh->head || (stop && stalled)){
+			lock.Unlock();
+			idle.Set();
+			return;
+		}
+		busy=1;
+		lock.Unlock();
+		if(Upload() < 0){
+			//	the database is away.  let tapes close meanwhile, the rows keep.
+			lock.Lock();
+			busy=0;
+			stalled=1;
+			lock.Unlock();
+			idle.Set();
+			wake.Wait(ODBC_JRNL_RETRY);
+			continue;
+		}
+		lock.Lock();
+		busy=0;
+		stalled=0;
+		lock.Unlock();
+	}
+}
+
+//	end of ODBCJournal.cpp
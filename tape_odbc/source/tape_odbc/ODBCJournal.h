@@ -0,0 +1,89 @@
+/*	$id$
+	Copyright (C) 2008 Battelle Memorial Institute
+
+ *	A local, append-only journal for an ODBCConnHandle.  Recorder and
+ *		collector rows are appended to a memory-mapped file and return at
+ *		once; a background thread replays them into the database and only
+ *		then moves the journal's tail past them.  The head and tail live in
+ *		the file, so rows a run couldn't upload are sent by the next run
+ *		that opens the same journal.
+ */
+
+#ifndef _ODBCJOURNAL_H_
+#define _ODBCJOURNAL_H_
+
+#include <stdio.h>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "ODBCThread.h"
+#include "ODBCTapeOptions.h"
+#include "TapeStream.h"
+
+using std::set;
+using std::string;
+using std::vector;
+
+#define ODBC_JRNL_MAGIC		"GLDJRNL1"
+#define ODBC_JRNL_HEAD		32			//	bytes before the first record
+#define ODBC_JRNL_MINSIZE	(1<<20)		//	bytes mapped to start with
+#define ODBC_JRNL_MAXSIZE	(1<<30)		//	bytes the file may grow to
+#define ODBC_JRNL_RETRY		1000		//	ms between uploads while the database is away
+
+//	the start of the file.  offsets are from the start of the file.
+struct journalhead{
+	char			magic[8];
+	unsigned int	size;	//	file size
+	unsigned int	head;	//	end of the last whole record
+	unsigned int	tail;	//	first record not yet in the database
+};
+
+class ODBCConnHandle;
+
+class ODBCJournal{
+public:
+	ODBCJournal(ODBCConnHandle *, ODBCTapeOptions *);
+	~ODBCJournal();
+
+	int IsOpen(){return base != 0;}
+	int Push(char *, int, char *, char *);
+	void Drain();
+	void Stop();
+	size_t Pending();
+private:
+	static void Run(void *);
+	void Loop();
+	int Upload();
+	int Open(char *);
+	int Map(unsigned int);
+	void Unmap();
+	void Close();
+	void Sync(int);
+	int Grow(unsigned int);
+	void Report();
+
+	ODBCConnHandle	*handle;
+	char			filename[256];
+	char			*base;		//	the mapped file
+	journalhead		*jh;		//	base, as a header
+#ifdef WIN32
+	HANDLE			file, mapping;
+#else
+	int				fd;
+#endif
+	size_t			take;		//	rows an upload takes at most
+	long			dropped;
+
+	ODBCLock		lock;		//	guards everything above and below, and the mapping
+	ODBCSignal		ready;		//	rows appended, or stop/drain wanted
+	ODBCSignal		idle;		//	the uploader caught up or stalled
+	ODBCSignal		wake;		//	stop, while the uploader waits out a stall
+	int				busy, stalled, stop;
+	ODBCThread		thread;
+
+	static set<string>	names;	//	journals open in this process
+	static ODBCLock		nameslock;
+};
+
+#endif
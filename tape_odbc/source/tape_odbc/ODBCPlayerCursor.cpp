@@ -0,0 +1,462 @@
+/*	$Id$
+	Copyright (C) 2008 Battelle Memorial Institute
+
+ *	Chunked player reads, optionally filled ahead by an ODBCReader.
+ */
+
+#include <limits.h>
+
+#include "ODBCPlayerCursor.h"
+#include "ODBCReader.h"
+
+using std::cout;
+using std::endl;
+
+ODBCPlayerCursor::ODBCPlayerCursor(){
+	conn=0;
+	table="EVENT_TABLE";
+	query=0;
+	tail=0;
+	lines=0;
+	connlock=0;
+	reader=0;
+	schema=0;
+	fetchsize=1;
+	depth=2;
+	ringreader=0;
+	source=0;
+	shared=0;
+	follower=0;
+	head=0;
+	ready=0;
+	pos=0;
+	filling=0;
+	atend=1;
+	firstend=1;
+	firstline=0;
+	tailline=0;
+	skipline=INT_MIN;
+	resume=0;
+	rows=0;
+	chunks=0;
+	underruns=0;
+	tapestats=0;
+	connstats=0;
+}
+
+ODBCPlayerCursor::~ODBCPlayerCursor(){
+	Close();
+	delete follower;
+}
+
+//	polls h for rows as they're written, lookahead seconds of them at a time, waiting up to wait seconds
+void ODBCPlayerCursor::SetFollow(ODBCConnHandle *h, int lookahead, int wait){
+	delete follower;
+	follower=new ODBCFollower(h, lookahead, wait);
+}
+
+/*	starts at the first row at or after start, or at the top if start is 0 or
+ *	empty.  returns 1 if there are any rows, 0 if not.  throws SQLException.
+ */
+int ODBCPlayerCursor::Open(odbc::Connection *c, ODBCLock *clock, ODBCReader *rdr, ODBCSchema *sch, char *objname, int fetch, int ringdepth, char *start){
+	Close();
+	conn=c;
+	connlock=clock;
+	schema=sch;
+	object=objname;
+	seektime=(start != 0 ? start : "");
+	fetchsize=(fetch > 0 ? fetch : 1);
+	depth=ringdepth;
+	ringreader=rdr;
+	if(follower != 0){
+		follower->Open(schema, table, object, seektime, tapestats, connstats);
+		return 1;	//	rows may be on their way
+	}
+	if(source != 0 && seektime.empty() && (shared=source->Add(object)) != 0)
+		return 1;	//	the source's query, run at the first read, says whether there are rows
+	ring.resize(rdr != 0 && depth > 2 ? depth : 2);
+	{
+		ODBCLocker locker(*connlock);
+		query=Prepare(0);
+	}
+	Claim();
+	Start();
+	reader=rdr;
+	if(reader != 0)
+		reader->Add(this);
+	else
+		FillOne();
+	return More();
+}
+
+//	moves to the first row at or after timestamp, which is also where rewinds go from now on
+int ODBCPlayerCursor::Seek(char *timestamp){
+	if(follower != 0) return follower->Seek(timestamp);
+	if(shared != 0) return Detach(timestamp, INT_MIN);
+	if(query == 0) return 0;
+	Claim();
+	try{
+		{
+			ODBCLocker locker(*connlock);
+			delete lines;
+			lines=0;
+			delete tail;
+			tail=0;
+			delete query;
+			query=0;
+			seektime=(timestamp != 0 ? timestamp : "");
+			query=Prepare(0);
+		}
+		Start();
+	} catch(odbc::SQLException& e) {
+		cout << "Exception caught: "<<e.getMessage()<<endl;
+		Release();
+		return 0;
+	}
+	if(reader != 0)
+		reader->Wake();
+	else
+		FillOne();
+	return More();
+}
+
+/*	plays the tape again from where it started.  the kept first chunk is
+ *	played at once; the rest is fetched with the tail query when the player,
+ *	or the reader, gets to it.
+ */
+int ODBCPlayerCursor::Rewind(){
+	if(follower != 0) return follower->Rewind();
+	if(shared != 0) return Detach(0, INT_MIN);
+	if(query == 0) return 0;
+	Claim();
+	{
+		ODBCLocker locker(*connlock);
+		delete lines;	//	forward-only, it can't go back
+		lines=0;
+	}
+	lock.Lock();
+	for(size_t i=0; i < ring.size(); ++i)
+		ring[i].clear();
+	ring[0]=first;
+	head=0;
+	ready=1;
+	pos=0;
+	atend=firstend;
+	resume=!firstend;
+	tailline=firstline;
+	filling=0;
+	lock.Unlock();
+	filled.Set();
+	if(reader != 0)
+		reader->Wake();
+	return More();
+}
+
+void ODBCPlayerCursor::Close(){
+	if(shared != 0){
+		source->Remove(shared);
+		shared=0;
+	}
+	if(reader != 0){
+		reader->Remove(this);	//	the reader is done with us once this returns
+		reader=0;
+	}
+	if(query != 0){
+		Claim();
+		{
+			ODBCLocker locker(*connlock);
+			delete lines;
+			lines=0;
+			delete tail;
+			tail=0;
+			delete query;
+			query=0;
+		}
+		lock.Lock();
+		filling=0;
+		lock.Unlock();
+	}
+	ring.clear();
+	first.clear();
+	head=0;
+	ready=0;
+	pos=0;
+	atend=1;
+	firstend=1;
+	resume=0;
+}
+
+//	the next row to play, or 0 at the end of the tape.  the row is good until the next call.
+eventrow *ODBCPlayerCursor::Next(){
+	int advanced=0, starved=0, after;
+	long ahead;
+	eventrow *row;
+	if(follower != 0)
+		return follower->Next();
+	if(shared != 0){
+		if((row=source->Next(shared)) != 0 || !shared->cut)
+			return row;
+		after=shared->lastline;
+		if(!Detach(0, after))
+			return 0;
+	}
+	lock.Lock();
+	while(ring.empty() || pos >= ring[head].size()){
+		if(ready > 1){
+			//	move on to the next decoded chunk, freeing this one
+			ring[head].clear();
+			head=(head+1)%ring.size();
+			--ready;
+			pos=0;
+			advanced=1;
+			continue;
+		}
+		if(ring.empty() || (atend && !filling)){
+			lock.Unlock();
+			return 0;
+		}
+		//	nothing decoded yet; fetch it here, or wait for whoever is
+		if(reader != 0 && !starved){
+			++underruns;
+			starved=1;
+		}
+		lock.Unlock();
+		if(FillOne() < 0)
+			filled.Wait();
+		lock.Lock();
+	}
+	row=&ring[head][pos++];
+	ahead=(long)ready-1;
+	lock.Unlock();
+	if(advanced){
+		if(tapestats != 0)
+			tapestats->Queued(ahead);	//	chunks decoded ahead
+		if(reader != 0)
+			reader->Wake();
+		else
+			FillOne();	//	keep one chunk ahead
+	}
+	return row;
+}
+
+int ODBCPlayerCursor::More(){
+	if(follower != 0)
+		return follower->More();
+	if(shared != 0)
+		return source->More(shared);
+	ODBCLocker locker(lock);
+	return !ring.empty() && (pos < ring[head].size() || ready > 1 || !atend || filling);
+}
+
+/*	decodes one more chunk into the ring, if there's room and rows left.
+ *	returns 1 if it fetched, 0 if there was nothing to do, and -1 if
+ *	another thread is already fetching for this cursor.
+ */
+int ODBCPlayerCursor::FillOne(){
+	size_t slot;
+	int count=0;
+	double t0;
+	lock.Lock();
+	if(filling){
+		lock.Unlock();
+		return -1;
+	}
+	if(atend || (lines == 0 && !resume) || ready >= ring.size()){
+		lock.Unlock();
+		return 0;
+	}
+	filling=1;
+	slot=(head+ready)%ring.size();
+	lock.Unlock();
+	try{
+		ODBCLocker locker(*connlock);
+		if(lines == 0)
+			Resume();	//	after a rewind
+		t0=ODBCMicros();
+		count=Fill(ring[slot]);
+		Note(t0, &ring[slot]);
+	} catch(odbc::SQLException& e) {
+		cout << "Exception caught: "<<e.getMessage()<<endl;
+		ring[slot].clear();
+		count=0;
+	}
+	lock.Lock();
+	if(count > 0){
+		++ready;
+		++chunks;
+		rows += count;
+	}
+	if(count < fetchsize)
+		atend=1;
+	filling=0;
+	lock.Unlock();
+	filled.Set();
+	return 1;
+}
+
+//	waits out any fetch in progress and keeps others off until Start or Close
+void ODBCPlayerCursor::Claim(){
+	lock.Lock();
+	while(filling){
+		lock.Unlock();
+		filled.Wait();
+		lock.Lock();
+	}
+	filling=1;
+	lock.Unlock();
+}
+
+//	lets fetches go again after a Claim
+void ODBCPlayerCursor::Release(){
+	lock.Lock();
+	filling=0;
+	lock.Unlock();
+	filled.Set();
+}
+
+//	(re)runs the query and decodes and keeps the first chunk.  caller holds the claim.
+int ODBCPlayerCursor::Start(){
+	int count=0;
+	double t0;
+	for(size_t i=0; i < ring.size(); ++i)
+		ring[i].clear();
+	head=0;
+	ready=1;
+	pos=0;
+	atend=1;
+	resume=0;
+	first.clear();
+	firstend=1;
+	try{
+		ODBCLocker locker(*connlock);
+		delete lines;
+		lines=0;
+		Bind(query, 0);
+		t0=ODBCMicros();
+		lines=query->executeQuery();
+		lines->setFetchSize(fetchsize);
+		count=Fill(ring[0]);
+		Note(t0, &ring[0]);
+	} catch(odbc::SQLException& e) {
+		Release();
+		throw;
+	}
+	first=ring[0];
+	firstend=(count < fetchsize);
+	firstline=(count > 0 ? first.back().line : 0);
+	tailline=firstline;
+	if(skipline != INT_MIN){
+		//	cut from the shared query: drop what was played, and if that's the
+		//	whole chunk go on with the tail query from after it
+		size_t played=0;
+		while(played < ring[0].size() && ring[0][played].line <= skipline)
+			++played;
+		ring[0].erase(ring[0].begin(), ring[0].begin()+played);
+		if(ring[0].empty() && !firstend){
+			ODBCLocker locker(*connlock);
+			delete lines;
+			lines=0;
+			resume=1;
+			tailline=skipline;
+		}
+		skipline=INT_MIN;
+	}
+	lock.Lock();
+	atend=firstend;
+	rows += count;
+	++chunks;
+	filling=0;
+	lock.Unlock();
+	filled.Set();
+	return count;
+}
+
+//	decodes up to fetchsize rows.  returns the number read.  caller holds the connection lock.
+int ODBCPlayerCursor::Fill(vector<eventrow> &buf){
+	int count=0, linecol=schema->Params()+1;
+	buf.clear();
+	while(count < fetchsize && lines->next()){
+		buf.push_back(eventrow());
+		schema->Decode(lines, buf.back());
+		buf.back().line=lines->getInt(linecol);
+		++count;
+	}
+	return count;
+}
+
+/*	the player query, or with tail set the same query for the rows after
+ *	tailline.  an index on (EVENT_OBJECT_NAME, EVENT_TIME) serves the seek
+ *	form, and one on (EVENT_OBJECT_NAME, EVENT_LINE) the others.  caller holds
+ *	the connection lock.
+ */
+odbc::PreparedStatement *ODBCPlayerCursor::Prepare(int tailrows){
+	string sql="SELECT "+schema->Columns()+", EVENT_LINE FROM "+table+" WHERE EVENT_OBJECT_NAME=?";
+	if(!seektime.empty())
+		sql += " AND EVENT_TIME >= ?";
+	if(tailrows)
+		sql += " AND EVENT_LINE > ?";
+	sql += " ORDER BY EVENT_LINE";
+	double t0=ODBCMicros();
+	odbc::PreparedStatement *stmt=conn->prepareStatement(sql,
+		odbc::ResultSet::TYPE_FORWARD_ONLY, odbc::ResultSet::CONCUR_READ_ONLY);
+	t0=ODBCMicros()-t0;
+	if(tapestats != 0)
+		tapestats->Prepared(t0);
+	if(connstats != 0)
+		connstats->Prepared(t0);
+	stmt->setFetchSize(fetchsize);	//	rowset size for the driver
+	return stmt;
+}
+
+void ODBCPlayerCursor::Bind(odbc::PreparedStatement *stmt, int tailrows){
+	int idx=1;
+	stmt->setString(idx++, object);
+	if(!seektime.empty())
+		schema->BindTime(stmt, idx++, seektime);
+	if(tailrows)
+		stmt->setInt(idx++, tailline);
+}
+
+//	picks the tape up after the kept first chunk.  caller holds the connection lock.
+void ODBCPlayerCursor::Resume(){
+	resume=0;
+	if(tail == 0)
+		tail=Prepare(1);
+	Bind(tail, 1);
+	double t0=ODBCMicros();
+	lines=tail->executeQuery();
+	lines->setFetchSize(fetchsize);
+	Note(t0, 0);
+}
+
+//	leaves the shared query for one of our own, from start or the top, playing the lines after after
+int ODBCPlayerCursor::Detach(char *start, int after){
+	string name=object;
+	Close();	//	leaves the source
+	source=0;
+	skipline=after;
+	try{
+		return Open(conn, connlock, ringreader, schema, (char *)name.c_str(), fetchsize, depth, start);
+	} catch(odbc::SQLException& e) {
+		cout << "Exception caught: "<<e.getMessage()<<endl;
+	}
+	return 0;
+}
+
+//	counts a query or fetch that started at t0 and decoded buf, if any
+void ODBCPlayerCursor::Note(double t0, vector<eventrow> *buf){
+	double us=ODBCMicros()-t0, bytes=0.0;
+	long count=0;
+	if(tapestats == 0 && connstats == 0) return;
+	if(buf != 0){
+		count=(long)buf->size();
+		for(size_t i=0; i < buf->size(); ++i)
+			bytes += (*buf)[i].timestamp.size() + (*buf)[i].value.size() + sizeof(int);
+	}
+	if(tapestats != 0)
+		tapestats->Executed(us, count, bytes);
+	if(connstats != 0)
+		connstats->Executed(us, count, bytes);
+}
+
+//	end of ODBCPlayerCursor.cpp
@@ -0,0 +1,114 @@
+/*	$id$
+	Copyright (C) 2008 Battelle Memorial Institute
+
+ *	Forward-only, streaming read of a player's EVENT_TABLE rows.  Rows are
+ *		decoded a fetch-sized chunk at a time into a ring of chunks; the
+ *		head chunk is played from while the rest hold what comes next, so
+ *		memory and startup time don't depend on the length of the tape.
+ *	Without a reader the ring is two chunks and the next one is fetched
+ *		as soon as the head is used up.  With an ODBCReader the ring is
+ *		filled ahead by the connection's read-ahead thread.
+ *	A cursor may start at a time instead of the top of the tape.  The
+ *		first chunk from wherever it started is kept, so a rewind plays
+ *		that copy straight away and the rest of the tape is re-queried,
+ *		from the line after it, only when it's needed.
+ *	Given an ODBCPlayerSource, a cursor that starts at the top of the tape
+ *		plays the rows the source's one query queues for it instead, until
+ *		it seeks or rewinds, or the source cuts it loose to read on alone.
+ *	Given an ODBCFollower, the cursor plays what it polls for instead, and
+ *		waits for rows another process hasn't written yet.
+ *	Callers must not hold the connection lock; the cursor takes it
+ *		itself around driver calls.
+ */
+
+#ifndef _ODBCPLAYERCURSOR_H_
+#define _ODBCPLAYERCURSOR_H_
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <odbc++/connection.h>
+#include <odbc++/preparedstatement.h>
+#include <odbc++/resultset.h>
+
+#include "ODBCFollower.h"
+#include "ODBCPlayerSource.h"
+#include "ODBCSchema.h"
+#include "ODBCStats.h"
+#include "ODBCThread.h"
+#include "TapeStream.h"
+
+using std::string;
+using std::vector;
+
+class ODBCReader;
+
+class ODBCPlayerCursor{
+public:
+	ODBCPlayerCursor();
+	~ODBCPlayerCursor();
+
+	int Open(odbc::Connection *, ODBCLock *, ODBCReader *, ODBCSchema *, char *, int, int, char *);
+	int Seek(char *);
+	int Rewind();
+	void Close();
+	eventrow *Next();
+	int More();
+	int FillOne();
+	void SetStats(ODBCStats *t, ODBCStats *c){tapestats=t; connstats=c;}
+	void SetTable(const string &t){table=t;}	//	before Open
+	void SetSource(ODBCPlayerSource *s){source=s;}	//	before Open
+	void SetFollow(ODBCConnHandle *, int, int);	//	before Open
+
+	long GetRows(){return rows;}
+	long GetChunks(){return chunks;}
+	long GetUnderruns(){return underruns;}
+private:
+	int Fill(vector<eventrow> &);
+	void Claim();
+	void Release();
+	int Start();
+	odbc::PreparedStatement *Prepare(int);
+	void Bind(odbc::PreparedStatement *, int);
+	void Resume();
+	void Note(double, vector<eventrow> *);
+	int Detach(char *, int);
+
+	odbc::Connection		*conn;
+	string					object;
+	string					table;		//	EVENT_TABLE, or a run's table
+	string					seektime;	//	where the tape starts, "" for the top
+	odbc::PreparedStatement	*query;		//	from seektime
+	odbc::PreparedStatement	*tail;		//	from seektime, after tailline
+	odbc::ResultSet			*lines;
+	ODBCLock				*connlock;
+	ODBCReader				*reader;
+	ODBCSchema				*schema;
+	int						fetchsize;
+	int						depth;		//	chunks the ring holds with a reader
+	ODBCReader				*ringreader;	//	the reader to use once on our own
+	ODBCPlayerSource		*source;	//	0 unless shared
+	sourceplayer			*shared;	//	our place in source's query, 0 once on our own
+	ODBCFollower			*follower;	//	0 unless following
+
+	ODBCLock				lock;		//	guards the ring bookkeeping below
+	ODBCSignal				filled;		//	a FillOne finished
+	vector< vector<eventrow> > ring;
+	size_t					head;		//	chunk being played
+	size_t					ready;		//	chunks decoded, counting head
+	size_t					pos;		//	next row in ring[head]
+	int						filling;	//	a FillOne is fetching
+	int						atend;		//	the result set has no more rows
+	vector<eventrow>		first;		//	the first chunk, for rewinds
+	int						firstend;	//	the first chunk is the whole tape
+	int						firstline;	//	EVENT_LINE of its last row
+	int						tailline;	//	the tail query's, firstline but after a cut
+	int						skipline;	//	Start drops lines up to this, played before a cut
+	int						resume;		//	lines is to be the tail query
+	long					rows, chunks, underruns;
+	ODBCStats				*tapestats;	//	the player's, or 0
+	ODBCStats				*connstats;	//	the connection's, or 0
+};
+
+#endif
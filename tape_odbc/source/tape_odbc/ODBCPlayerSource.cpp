@@ -0,0 +1,206 @@
+/*	$Id$
+	Copyright (C) 2008 Battelle Memorial Institute
+
+ *	A single time-ordered query shared by a connection's players.
+ */
+
+#include <limits.h>
+
+#include "ODBCPlayerSource.h"
+#include "ODBCConnHandle.h"
+
+using std::cout;
+using std::endl;
+
+//	depth is the chunks of fetch rows a player's queue holds, as in its cursor's ring
+ODBCPlayerSource::ODBCPlayerSource(ODBCConnHandle *h, ODBCSchema *sch, int fetch, int depth){
+	handle=h;
+	schema=sch;
+	fetchsize=(fetch > 0 ? fetch : 1);
+	cap=(size_t)fetchsize*(depth > 2 ? depth : 2);
+	full=0;
+	query=0;
+	lines=0;
+	started=0;
+	atend=0;
+	rows=0;
+	skipped=0;
+}
+
+ODBCPlayerSource::~ODBCPlayerSource(){
+	map<string, vector<sourceplayer *> >::iterator itr;
+	Stop();
+	for(itr=players.begin(); itr != players.end(); ++itr)
+		for(size_t i=0; i < itr->second.size(); ++i)
+			delete itr->second[i];
+	players.clear();
+}
+
+//	a player for object, or 0 if the query has already run
+sourceplayer *ODBCPlayerSource::Add(const string &object){
+	ODBCLocker locker(lock);
+	if(started)
+		return 0;
+	sourceplayer *player=new sourceplayer;
+	player->object=object;
+	player->lastline=INT_MIN;
+	player->cut=0;
+	players[object].push_back(player);
+	return player;
+}
+
+//	drops player and whatever was queued for it; the last one out ends the query
+void ODBCPlayerSource::Remove(sourceplayer *player){
+	ODBCLocker locker(lock);
+	map<string, vector<sourceplayer *> >::iterator itr=players.find(player->object);
+	if(itr != players.end()){
+		for(size_t i=0; i < itr->second.size(); ++i){
+			if(itr->second[i] == player){
+				itr->second.erase(itr->second.begin()+i);
+				break;
+			}
+		}
+		if(itr->second.empty())
+			players.erase(itr);
+	}
+	if(full == player)
+		full=0;
+	delete player;
+	if(players.empty() && started)
+		Stop();
+}
+
+/*	the player's next row, reading on until it has one, or 0 at the end.  also
+ *	0, with cut set, if another player's queue is full first; the player then
+ *	reads on from after lastline by itself.  the row is good until the next call.
+ */
+eventrow *ODBCPlayerSource::Next(sourceplayer *player){
+	ODBCLocker locker(lock);
+	if(!started)
+		Start();
+	while(player->rows.empty()){
+		if(atend)
+			return 0;
+		if(full != 0 && full->rows.size() >= cap){
+			player->cut=1;
+			return 0;
+		}
+		full=0;
+		Fill();
+	}
+	player->played=player->rows.front();
+	player->rows.pop_front();
+	player->lastline=player->played.line;
+	return &player->played;
+}
+
+//	whether the player may have rows left; not known for sure until the query reaches them
+int ODBCPlayerSource::More(sourceplayer *player){
+	ODBCLocker locker(lock);
+	return !started || !atend || !player->rows.empty();
+}
+
+/*	runs the query for every object added so far, listing them when there
+ *	aren't too many and reading the whole table otherwise.  an index on
+ *	EVENT_TIME serves the order.  caller holds the lock.  returns 0 if it
+ *	failed, which ends every player.
+ */
+int ODBCPlayerSource::Start(){
+	map<string, vector<sourceplayer *> >::iterator itr;
+	string sql="SELECT "+schema->Columns()+", EVENT_LINE, EVENT_OBJECT_NAME FROM EVENT_TABLE";
+	int idx=1, listed=(players.size() <= ODBC_SOURCE_MAXLIST);
+	double t0;
+	started=1;
+	atend=1;
+	if(players.empty())
+		return 0;
+	if(listed){
+		sql += " WHERE EVENT_OBJECT_NAME IN (?";
+		for(size_t i=1; i < players.size(); ++i)
+			sql += ", ?";
+		sql += ")";
+	}
+	sql += " ORDER BY EVENT_TIME, EVENT_LINE";
+	ODBCLocker locker(handle->GetLock());
+	try{
+		t0=ODBCMicros();
+		query=handle->GetConn()->prepareStatement(sql,
+			odbc::ResultSet::TYPE_FORWARD_ONLY, odbc::ResultSet::CONCUR_READ_ONLY);
+		handle->GetStats().Prepared(ODBCMicros()-t0);
+		query->setFetchSize(fetchsize);
+		if(listed)
+			for(itr=players.begin(); itr != players.end(); ++itr)
+				query->setString(idx++, itr->first);
+		t0=ODBCMicros();
+		lines=query->executeQuery();
+		lines->setFetchSize(fetchsize);
+		handle->GetStats().Executed(ODBCMicros()-t0, 0, 0.0);
+	} catch(odbc::SQLException& e) {
+		if(!handle->Lost(e))
+			cout << "Exception caught: "<<e.getMessage()<<endl;
+		return 0;
+	}
+	atend=0;
+	return 1;
+}
+
+/*	reads up to fetchsize rows into the players' queues, stopping early at
+ *	the row that fills one, which is left in full.  caller holds the lock.
+ */
+int ODBCPlayerSource::Fill(){
+	map<string, vector<sourceplayer *> >::iterator itr;
+	eventrow row;
+	int count=0, more=0, linecol=schema->Params()+1;
+	double t0, bytes=0.0;
+	{
+		ODBCLocker locker(handle->GetLock());
+		try{
+			t0=ODBCMicros();
+			while(full == 0 && count < fetchsize && (more=lines->next()) != 0){
+				++count;
+				schema->Decode(lines, row);
+				row.line=lines->getInt(linecol);
+				itr=players.find(lines->getString(linecol+1));
+				if(itr == players.end()){
+					++skipped;	//	closed, or not ours in a whole-table read
+					continue;
+				}
+				for(size_t i=0; i < itr->second.size(); ++i){
+					itr->second[i]->rows.push_back(row);
+					if(itr->second[i]->rows.size() >= cap)
+						full=itr->second[i];
+				}
+				bytes += row.timestamp.size() + row.value.size() + sizeof(int);
+				++rows;
+			}
+			handle->GetStats().Executed(ODBCMicros()-t0, count, bytes);
+		} catch(odbc::SQLException& e) {
+			if(!handle->Lost(e))
+				cout << "Exception caught: "<<e.getMessage()<<endl;
+			more=0;
+		}
+	}
+	if(!more)
+		Stop();
+	return count;
+}
+
+//	lets the query go.  caller holds the lock.
+void ODBCPlayerSource::Stop(){
+	atend=1;
+	if(query == 0)
+		return;
+	{
+		ODBCLocker locker(handle->GetLock());
+		delete lines;
+		lines=0;
+		delete query;
+		query=0;
+	}
+	printf("ODBCPlayerSource: %s: queued %li rows for the players from one query", handle->GetName(), rows);
+	if(skipped > 0)
+		printf(", %li rows skipped", skipped);
+	printf("\n");
+}
+
+//	end of ODBCPlayerSource.cpp
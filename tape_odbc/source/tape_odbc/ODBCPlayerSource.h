@@ -0,0 +1,80 @@
+/*	$id$
+	Copyright (C) 2008 Battelle Memorial Institute
+
+ *	One EVENT_TABLE query for all the players on an ODBCConnHandle.  With
+ *		shared, players hand their object names over as they open, and the
+ *		first read runs a single query for all of them, in time order,
+ *		queueing each row for the player or players it belongs to.  Opening
+ *		costs no round trips and the server keeps one cursor open instead
+ *		of one per player.  A player that starts late, seeks, or rewinds,
+ *		or opens after the query has run, reads with its own query instead.
+ *	Each player's queue holds as many rows as its own cursor's ring would.
+ *		When one is full the query stops there, and a player that has
+ *		nothing queued is cut loose to read on with its own query rather
+ *		than have the rest of the table read into the others' queues.
+ */
+
+#ifndef _ODBCPLAYERSOURCE_H_
+#define _ODBCPLAYERSOURCE_H_
+
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <odbc++/connection.h>
+#include <odbc++/preparedstatement.h>
+#include <odbc++/resultset.h>
+
+#include "ODBCSchema.h"
+#include "ODBCThread.h"
+#include "TapeStream.h"
+
+using std::deque;
+using std::map;
+using std::string;
+using std::vector;
+
+//	players beyond this many objects are found by scanning the whole table
+#define ODBC_SOURCE_MAXLIST	1000
+
+class ODBCConnHandle;
+
+//	one player's place in the shared query
+struct sourceplayer{
+	string			object;
+	deque<eventrow>	rows;		//	handed over, not yet played
+	eventrow		played;		//	the row Next last returned
+	int				lastline;	//	EVENT_LINE of played, INT_MIN before any
+	int				cut;		//	the query can't go on for us; read on alone
+};
+
+class ODBCPlayerSource{
+public:
+	ODBCPlayerSource(ODBCConnHandle *, ODBCSchema *, int, int);
+	~ODBCPlayerSource();
+
+	sourceplayer *Add(const string &);
+	void Remove(sourceplayer *);
+	eventrow *Next(sourceplayer *);
+	int More(sourceplayer *);
+private:
+	int Start();
+	int Fill();
+	void Stop();
+
+	ODBCConnHandle			*handle;
+	ODBCSchema				*schema;	//	EVENT_TABLE's
+	int						fetchsize;
+	size_t					cap;		//	rows a player's queue holds
+	sourceplayer			*full;		//	the queue the last Fill stopped at, if any
+	map<string, vector<sourceplayer *> > players;	//	by object
+	odbc::PreparedStatement	*query;
+	odbc::ResultSet			*lines;
+	int						started;	//	the query has run; no more players join
+	int						atend;
+	long					rows, skipped;	//	queued, and for objects nobody plays
+	ODBCLock				lock;		//	guards everything above, and every player's rows
+};
+
+#endif
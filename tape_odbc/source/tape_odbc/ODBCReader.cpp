@@ -0,0 +1,77 @@
+/*	$Id$
+	Copyright (C) 2008 Battelle Memorial Institute
+
+ *	Background read-ahead thread for ODBC players.
+ */
+
+#include "ODBCReader.h"
+#include "ODBCPlayerCursor.h"
+
+ODBCReader::ODBCReader(char *servername){
+	strncpy(name, servername, 127);
+	name[127]=0;
+	stop=0;
+	rows=0;
+	chunks=0;
+	underruns=0;
+	if(!thread.Start(Run, this))
+		printf("WARNING:\tODBCReader::ODBCReader: unable to start the read-ahead thread, players will read on demand\n");
+}
+
+ODBCReader::~ODBCReader(){
+	lock.Lock();
+	stop=1;
+	lock.Unlock();
+	work.Set();
+	thread.Join();
+}
+
+void ODBCReader::Add(ODBCPlayerCursor *cursor){
+	lock.Lock();
+	cursors.push_back(cursor);
+	lock.Unlock();
+	work.Set();
+}
+
+//	blocks until any pass in progress is done, so the cursor is ours again
+void ODBCReader::Remove(ODBCPlayerCursor *cursor){
+	lock.Lock();
+	cursors.remove(cursor);
+	rows += cursor->GetRows();
+	chunks += cursor->GetChunks();
+	underruns += cursor->GetUnderruns();
+	if(cursors.empty() && rows > 0)
+		printf("ODBCReader: %s: read %li rows ahead in %li chunks, %li underruns\n", name, rows, chunks, underruns);
+	lock.Unlock();
+}
+
+//	a player used up a chunk
+void ODBCReader::Wake(){
+	work.Set();
+}
+
+void ODBCReader::Run(void *vp){
+	((ODBCReader *)vp)->Loop();
+}
+
+void ODBCReader::Loop(){
+	list<ODBCPlayerCursor *>::iterator itr;
+	int fetched;
+	for(;;){
+		fetched=0;
+		lock.Lock();
+		if(stop){
+			lock.Unlock();
+			return;
+		}
+		//	one chunk per player per pass, so a long tape can't starve the rest
+		for(itr=cursors.begin(); itr != cursors.end(); ++itr)
+			if((*itr)->FillOne() > 0)
+				fetched=1;
+		lock.Unlock();
+		if(!fetched)
+			work.Wait();
+	}
+}
+
+//	end of ODBCReader.cpp
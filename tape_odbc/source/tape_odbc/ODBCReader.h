@@ -0,0 +1,49 @@
+/*	$id$
+	Copyright (C) 2008 Battelle Memorial Institute
+
+ *	Read-ahead for the players on an ODBCConnHandle.  A background thread
+ *		goes round the open player cursors, decoding one chunk for each
+ *		that has room, until every ring is full or at the end of its tape.
+ *		ReadLine then only copies rows out of the ring; when it finds the
+ *		ring empty that's counted as an underrun.
+ */
+
+#ifndef _ODBCREADER_H_
+#define _ODBCREADER_H_
+
+#include <stdio.h>
+#include <string.h>
+#include <list>
+
+#include "ODBCThread.h"
+
+using std::list;
+
+class ODBCPlayerCursor;
+
+class ODBCReader{
+public:
+	ODBCReader(char *);
+	~ODBCReader();
+
+	void Add(ODBCPlayerCursor *);
+	void Remove(ODBCPlayerCursor *);
+	void Wake();
+
+	long GetRows(){return rows;}
+	long GetChunks(){return chunks;}
+	long GetUnderruns(){return underruns;}
+private:
+	static void Run(void *);
+	void Loop();
+
+	char					name[128];
+	list<ODBCPlayerCursor *> cursors;
+	ODBCLock				lock;		//	held for a whole pass over cursors
+	ODBCSignal				work;
+	int						stop;
+	ODBCThread				thread;
+	long					rows, chunks, underruns;	//	from closed players
+};
+
+#endif
@@ -0,0 +1,201 @@
+/*	$Id$
+	Copyright (C) 2008 Battelle Memorial Institute
+
+ *	Making, listing, and dropping per-run tables.
+ */
+
+#include <ctype.h>
+#include <time.h>
+#include <vector>
+
+#include <odbc++/resultset.h>
+#include <odbc++/statement.h>
+
+#include "ODBCRun.h"
+#include "ODBCConnHandle.h"
+
+using std::vector;
+
+set<string> ODBCRun::opened;
+ODBCLock ODBCRun::lock;
+
+//	base, or base_run for a run
+string ODBCRun::Table(const char *base, const char *run){
+	if(run == 0 || run[0] == 0) return base;
+	return string(base)+"_"+run;
+}
+
+//	makes id fit in a table name: letters, digits, and '_', ODBC_MAXRUNID at most
+char *ODBCRun::CleanId(char *id){
+	size_t i;
+	for(i=0; id[i] != 0 && i < ODBC_MAXRUNID; ++i)
+		if(!isalnum((unsigned char)id[i]))
+			id[i]='_';
+	id[i]=0;
+	return id;
+}
+
+string ODBCRun::Now(){
+	char buffer[64];
+	time_t now=time(NULL);
+	strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", localtime(&now));
+	return buffer;
+}
+
+/*	gets run ready on handle's database, once per process: drops any earlier
+ *	run with the same ID and, with keep, the oldest runs, then makes the run's
+ *	header and object tables, typed if asked.  returns 0 if they couldn't be
+ *	made.  caller holds the connection lock.
+ */
+int ODBCRun::Open(ODBCConnHandle *handle, const char *run, int typed, int keep){
+	string key=string(handle->GetName())+"\n"+run;
+	string header=Table("HEADER_TABLE", run), object=Table("OBJECT_TABLE", run);
+	string stmts[3];
+	ODBCLocker locker(lock);
+	if(opened.find(key) != opened.end())
+		return 1;
+	try{
+		odbc::Statement *stmt=handle->GetConn()->createStatement();
+		try{
+			stmt->executeUpdate("CREATE TABLE RUN_TABLE (RUN_ID VARCHAR(64), RUN_TABLE_NAME VARCHAR(128), RUN_TIME VARCHAR(32))");
+		} catch(SQLException& e) {
+			if(handle->Lost(e)){
+				delete stmt;
+				return 0;
+			}	//	otherwise it's there already
+		}
+		delete stmt;
+	} catch(SQLException& e) {
+		if(!handle->Lost(e))
+			cout << "Exception caught: "<<e.getMessage()<<endl;
+		return 0;
+	}
+	if(!Drop(handle, run))
+		return 0;
+	if(keep > 0)
+		Prune(handle, run, keep);
+	stmts[0]="CREATE TABLE "+header+" (HEADER_OBJECT_NAME VARCHAR(64), HEADER_TIME VARCHAR(64), HEADER_USER VARCHAR(64),"
+		" HEADER_HOST VARCHAR(64), HEADER_TARGET VARCHAR(64), HEADER_PROPERTY VARCHAR(64), HEADER_TRIGGER VARCHAR(64),"
+		" HEADER_INTERVAL INTEGER, HEADER_LIMIT INTEGER)";
+	if(typed)
+		stmts[1]="CREATE TABLE "+object+" (EVENT_OBJECT_NAME VARCHAR(64), EVENT_LINE INTEGER, EVENT_TIME TIMESTAMP,"
+			" EVENT_VAL DOUBLE PRECISION, EVENT_VAL_IMAG DOUBLE PRECISION)";
+	else
+		stmts[1]="CREATE TABLE "+object+" (EVENT_OBJECT_NAME VARCHAR(64), EVENT_LINE INTEGER, EVENT_TIME VARCHAR(32), EVENT_VAL VARCHAR(32))";
+	//	for players replaying the run
+	stmts[2]="CREATE INDEX "+object+"_KEY ON "+object+" (EVENT_OBJECT_NAME, EVENT_LINE)";
+	try{
+		odbc::Statement *stmt=handle->GetConn()->createStatement();
+		for(int i=0; i < 3; ++i){
+			stmt->executeUpdate(stmts[i]);
+			if(i < 2)
+				Register(handle, run, i == 0 ? header : object);
+		}
+		delete stmt;
+	} catch(SQLException& e) {
+		if(!handle->Lost(e))
+			cout << "Exception caught: "<<e.getMessage()<<endl;
+		printf("WARNING:\tODBCRun::Open: unable to make the tables for run %s on %s\n", run, handle->GetName());
+		return 0;
+	}
+	opened.insert(key);
+	return 1;
+}
+
+/*	lists table in RUN_TABLE as part of run, so dropping the run drops it
+ *	too.  does nothing without a run.  caller holds the connection lock.
+ */
+int ODBCRun::Register(ODBCConnHandle *handle, const char *run, const string &table){
+	int found=0;
+	if(run == 0 || run[0] == 0) return 1;
+	try{
+		odbc::PreparedStatement *stmt=handle->Prepare("SELECT COUNT(*) FROM RUN_TABLE WHERE RUN_ID=? AND RUN_TABLE_NAME=?");
+		stmt->setString(1, run);
+		stmt->setString(2, table);
+		odbc::ResultSet *rs=stmt->executeQuery();
+		if(rs->next())
+			found=rs->getInt(1);
+		delete rs;
+		if(found)
+			return 1;
+		stmt=handle->Prepare("INSERT INTO RUN_TABLE VALUES (?, ?, ?)");
+		stmt->setString(1, run);
+		stmt->setString(2, table);
+		stmt->setString(3, Now());
+		stmt->executeUpdate();
+		return 1;
+	} catch(SQLException& e) {
+		if(!handle->Lost(e))
+			cout << "Exception caught: "<<e.getMessage()<<endl;
+	}
+	return 0;
+}
+
+/*	drops every table listed for run and forgets it.  returns 0 if the link
+ *	went.  caller holds the connection lock.
+ */
+int ODBCRun::Drop(ODBCConnHandle *handle, const string &run){
+	vector<string> tables;
+	try{
+		odbc::PreparedStatement *query=handle->Prepare("SELECT RUN_TABLE_NAME FROM RUN_TABLE WHERE RUN_ID=?");
+		query->setString(1, run);
+		odbc::ResultSet *rs=query->executeQuery();
+		while(rs->next())
+			tables.push_back(rs->getString(1));
+		delete rs;
+		if(tables.empty())
+			return 1;
+		printf("WARNING:\tODBCRun::Drop: dropping run %s from %s, %i tables\n", run.c_str(), handle->GetName(), (int)tables.size());
+		odbc::Statement *stmt=handle->GetConn()->createStatement();
+		for(size_t i=0; i < tables.size(); ++i){
+			try{
+				stmt->executeUpdate("DROP TABLE "+tables[i]);
+			} catch(SQLException& e) {
+				if(handle->Lost(e)){
+					delete stmt;
+					return 0;
+				}	//	otherwise it's gone already
+			}
+		}
+		delete stmt;
+		query=handle->Prepare("DELETE FROM RUN_TABLE WHERE RUN_ID=?");
+		query->setString(1, run);
+		query->executeUpdate();
+	} catch(SQLException& e) {
+		if(handle->Lost(e))
+			return 0;
+		cout << "Exception caught: "<<e.getMessage()<<endl;
+	}
+	return 1;
+}
+
+//	drops all but the keep newest runs, counting run.  caller holds the connection lock.
+int ODBCRun::Prune(ODBCConnHandle *handle, const char *run, int keep){
+	vector<string> older;
+	int kept=1;
+	try{
+		odbc::Statement *stmt=handle->GetConn()->createStatement();
+		odbc::ResultSet *rs=stmt->executeQuery("SELECT RUN_ID, MIN(RUN_TIME) FROM RUN_TABLE GROUP BY RUN_ID ORDER BY 2 DESC");
+		while(rs->next()){
+			string id=rs->getString(1);
+			if(id == run)
+				continue;
+			if(kept < keep)
+				++kept;
+			else
+				older.push_back(id);
+		}
+		delete rs;
+		delete stmt;
+	} catch(SQLException& e) {
+		if(!handle->Lost(e))
+			cout << "Exception caught: "<<e.getMessage()<<endl;
+		return 0;
+	}
+	for(size_t i=0; i < older.size(); ++i)
+		if(!Drop(handle, older[i]))
+			return 0;
+	return 1;
+}
+
+//	end of ODBCRun.cpp
@@ -0,0 +1,49 @@
+/*	$id$
+	Copyright (C) 2008 Battelle Memorial Institute
+
+ *	Per-run tables for ODBC recorders.  With run=ID a connection writes
+ *		HEADER_TABLE_ID and OBJECT_TABLE_ID, and its groups and staged
+ *		collectors their own tables with the same suffix, instead of the
+ *		shared ones, so a run never has to delete what an earlier run left.
+ *		Every table a run makes is listed in RUN_TABLE,
+ *			RUN_ID, RUN_TABLE_NAME, RUN_TIME
+ *		so a whole run can be dropped, table by table, in constant time.
+ *	The first connection in the process to use a run ID drops any run
+ *		already recorded under it, and with keep=N all but the N newest
+ *		runs, then makes the run's tables.
+ */
+
+#ifndef _ODBCRUN_H_
+#define _ODBCRUN_H_
+
+#include <set>
+#include <string>
+
+#include <odbc++/connection.h>
+#include <odbc++/preparedstatement.h>
+
+#include "ODBCThread.h"
+
+using std::set;
+using std::string;
+
+#define ODBC_MAXRUNID	32
+
+class ODBCConnHandle;
+
+class ODBCRun{
+public:
+	static string Table(const char *, const char *);
+	static char *CleanId(char *);
+	static int Open(ODBCConnHandle *, const char *, int, int);
+	static int Register(ODBCConnHandle *, const char *, const string &);
+	static int Drop(ODBCConnHandle *, const string &);
+private:
+	static int Prune(ODBCConnHandle *, const char *, int);
+	static string Now();
+
+	static set<string>	opened;		//	by DSN and run, for this process
+	static ODBCLock		lock;
+};
+
+#endif
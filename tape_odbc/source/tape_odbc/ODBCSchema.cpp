@@ -0,0 +1,240 @@
+/*	$Id$
+	Copyright (C) 2008 Battelle Memorial Institute
+
+ *	Typed binding and decoding of event times and values.
+ */
+
+#include <math.h>
+#include <ctype.h>
+
+#include <odbc++/databasemetadata.h>
+#include <odbc++/types.h>
+
+#include "ODBCSchema.h"
+
+#ifndef PI
+#define PI 3.1415926535897932384626433832795
+#endif
+
+using odbc::Types;
+
+//	days since 1970-01-01 in the proleptic Gregorian calendar
+static long days_from_civil(int y, int m, int d){
+	long era, yoe, doy, doe;
+	y -= (m <= 2);
+	era=(y >= 0 ? y : y-399) / 400;
+	yoe=y - era*400;
+	doy=(153*(m + (m > 2 ? -3 : 9)) + 2)/5 + d-1;
+	doe=yoe*365 + yoe/4 - yoe/100 + doy;
+	return era*146097 + doe - 719468;
+}
+
+static void civil_from_days(long z, int *y, int *m, int *d){
+	long era, doe, yoe, doy, mp;
+	z += 719468;
+	era=(z >= 0 ? z : z-146096) / 146097;
+	doe=z - era*146097;
+	yoe=(doe - doe/1460 + doe/36524 - doe/146096) / 365;
+	doy=doe - (365*yoe + yoe/4 - yoe/100);
+	mp=(5*doy + 2)/153;
+	*d=(int)(doy - (153*mp+2)/5 + 1);
+	*m=(int)(mp + (mp < 10 ? 3 : -9));
+	*y=(int)(yoe + era*400 + (*m <= 2));
+}
+
+int ODBCTimeToEpoch(const char *ts, odbc::Long *secs){
+	int y, m, d, hh, mm, ss;
+	if(sscanf(ts, "%d-%d-%d %d:%d:%d", &y, &m, &d, &hh, &mm, &ss) != 6)
+		return 0;
+	*secs=(odbc::Long)days_from_civil(y, m, d)*86400 + hh*3600 + mm*60 + ss;
+	return 1;
+}
+
+void ODBCEpochToTime(odbc::Long t, char *buffer){
+	odbc::Long days=t/86400, secs=t%86400;
+	int y, m, d;
+	if(secs < 0){
+		secs += 86400;
+		--days;
+	}
+	civil_from_days((long)days, &y, &m, &d);
+	sprintf(buffer, "%04i-%02i-%02i %02i:%02i:%02i", y, m, d, (int)(secs/3600), (int)(secs/60%60), (int)(secs%60));
+}
+
+static int is_numeric(int type){
+	switch(type){
+		case Types::DOUBLE: case Types::FLOAT: case Types::REAL:
+		case Types::NUMERIC: case Types::DECIMAL:
+		case Types::BIGINT: case Types::INTEGER: case Types::SMALLINT:
+			return 1;
+	}
+	return 0;
+}
+
+ODBCSchema::ODBCSchema(){
+	Reset();
+}
+
+void ODBCSchema::Reset(){
+	timetype=ODBC_TIME_TEXT;
+	typedvalue=0;
+	imagcol=0;
+	lasttime="";
+	lastok=0;
+	warned=0;
+}
+
+//	looks up the table's columns.  returns 1 if anything is typed.  throws SQLException.
+int ODBCSchema::Negotiate(odbc::Connection *conn, const char *table){
+	odbc::ResultSet *cols;
+	string name;
+	int type, found=0;
+	Reset();
+	cols=conn->getMetaData()->getColumns("", "", table, "%");
+	while(cols->next()){
+		name=cols->getString(4);
+		for(size_t i=0; i < name.size(); ++i)
+			name[i]=toupper(name[i]);
+		type=cols->getShort(5);
+		++found;
+		if(name == "EVENT_TIME"){
+			if(type == Types::TIMESTAMP || type == Types::DATE)
+				timetype=ODBC_TIME_TIMESTAMP;
+			else if(is_numeric(type))
+				timetype=ODBC_TIME_EPOCH;
+		} else if(name == "EVENT_VAL"){
+			typedvalue=is_numeric(type);
+		} else if(name == "EVENT_VAL_IMAG"){
+			imagcol=is_numeric(type);
+		}
+	}
+	delete cols;
+	if(!typedvalue) imagcol=0;
+	if(found == 0)
+		printf("WARNING:\tODBCSchema::Negotiate: no columns found for %s, using text\n", table);
+	return !IsText();
+}
+
+string ODBCSchema::Columns(){
+	return imagcol ? "EVENT_TIME, EVENT_VAL, EVENT_VAL_IMAG" : "EVENT_TIME, EVENT_VAL";
+}
+
+//	binds a timestamp as an EVENT_TIME parameter
+void ODBCSchema::BindTime(odbc::PreparedStatement *stmt, int idx, const string &timestamp){
+	if(timetype == ODBC_TIME_TEXT){
+		stmt->setString(idx, timestamp);
+	} else if(!ParseTime(timestamp)){
+		stmt->setNull(idx, timetype == ODBC_TIME_TIMESTAMP ? Types::TIMESTAMP : Types::BIGINT);
+	} else if(timetype == ODBC_TIME_TIMESTAMP){
+		stmt->setTimestamp(idx, odbc::Timestamp(year, month, day, hour, minute, second));
+	} else {
+		stmt->setLong(idx, (odbc::Long)days_from_civil(year, month, day)*86400 + hour*3600 + minute*60 + second);
+	}
+}
+
+//	binds the time and value parameters of row, starting at parameter idx
+void ODBCSchema::Bind(odbc::PreparedStatement *stmt, int idx, eventrow &row){
+	double re, im;
+	int isvalue;
+	BindTime(stmt, idx, row.timestamp);
+	if(!typedvalue){
+		stmt->setString(idx+1, row.value);
+		return;
+	}
+	isvalue=ParseValue(row.value, &re, &im);
+	if(isvalue)
+		stmt->setDouble(idx+1, re);
+	else
+		stmt->setNull(idx+1, Types::DOUBLE);
+	if(imagcol){
+		if(isvalue == 2)
+			stmt->setDouble(idx+2, im);
+		else
+			stmt->setNull(idx+2, Types::DOUBLE);
+	}
+}
+
+//	reads columns 1 and up back into the text form players return
+void ODBCSchema::Decode(odbc::ResultSet *rs, eventrow &row){
+	char buffer[64];
+	double re, im;
+	if(timetype == ODBC_TIME_TEXT){
+		row.timestamp=rs->getString(1);
+	} else if(timetype == ODBC_TIME_TIMESTAMP){
+		odbc::Timestamp ts=rs->getTimestamp(1);
+		sprintf(buffer, "%04i-%02i-%02i %02i:%02i:%02i", ts.getYear(), ts.getMonth(), ts.getDay(), ts.getHour(), ts.getMinute(), ts.getSecond());
+		row.timestamp=(rs->wasNull() ? "" : buffer);
+	} else {
+		ODBCEpochToTime(rs->getLong(1), buffer);
+		row.timestamp=(rs->wasNull() ? "" : buffer);
+	}
+	if(!typedvalue){
+		row.value=rs->getString(2);
+		return;
+	}
+	re=rs->getDouble(2);
+	if(rs->wasNull()){
+		row.value="";
+		return;
+	}
+	if(imagcol){
+		im=rs->getDouble(3);
+		if(!rs->wasNull()){
+			sprintf(buffer, "%.15g%+.15gj", re, im);
+			row.value=buffer;
+			return;
+		}
+	}
+	sprintf(buffer, "%.15g", re);
+	row.value=buffer;
+}
+
+//	YYYY-MM-DD HH:MM:SS, with anything after (a timezone) ignored
+int ODBCSchema::ParseTime(const string &ts){
+	if(ts == lasttime) return lastok;
+	lasttime=ts;
+	lastok=(sscanf(ts.c_str(), "%d-%d-%d %d:%d:%d", &year, &month, &day, &hour, &minute, &second) == 6);
+	if(!lastok && !warned){
+		printf("WARNING:\tODBCSchema::ParseTime: can't store '%s' as a time, writing NULL\n", ts.c_str());
+		warned=1;
+	}
+	return lastok;
+}
+
+//	returns 0 if not a number, 1 for a real, 2 for a complex (polar forms converted)
+int ODBCSchema::ParseValue(const string &value, double *re, double *im){
+	const char *str=value.c_str();
+	char *end, *end2;
+	double mag, ang;
+	*re=strtod(str, &end);
+	*im=0;
+	if(end == str){
+		if(!warned){
+			printf("WARNING:\tODBCSchema::ParseValue: can't store '%s' as a number, writing NULL\n", str);
+			warned=1;
+		}
+		return 0;
+	}
+	if(*end != '+' && *end != '-') return 1;
+	*im=strtod(end, &end2);
+	if(end2 == end) return 1;
+	switch(*end2){
+		case 'i': case 'j':
+			return 2;
+		case 'd':
+			mag=*re;
+			ang=*im*PI/180;
+			*re=mag*cos(ang);
+			*im=mag*sin(ang);
+			return 2;
+		case 'r':
+			mag=*re;
+			ang=*im;
+			*re=mag*cos(ang);
+			*im=mag*sin(ang);
+			return 2;
+	}
+	return 1;
+}
+
+//	end of ODBCSchema.cpp
@@ -0,0 +1,61 @@
+/*	$id$
+	Copyright (C) 2008 Battelle Memorial Institute
+
+ *	Column types for the time and value fields of OBJECT_TABLE and
+ *		EVENT_TABLE.  The text schema is the original one.  With
+ *		schema=typed the table's columns are looked up through
+ *		DatabaseMetaData when the connection is configured: a TIMESTAMP
+ *		or DATE EVENT_TIME is bound as a timestamp, a numeric one as
+ *		epoch seconds, a numeric EVENT_VAL as a double, and a numeric
+ *		EVENT_VAL_IMAG, if the table has one, holds the imaginary part
+ *		of complex values.  Anything else stays text.
+ */
+
+#ifndef _ODBCSCHEMA_H_
+#define _ODBCSCHEMA_H_
+
+#include <string>
+
+#include <odbc++/connection.h>
+#include <odbc++/preparedstatement.h>
+#include <odbc++/resultset.h>
+
+#include "TapeStream.h"
+
+using std::string;
+
+typedef enum {ODBC_TIME_TEXT, ODBC_TIME_TIMESTAMP, ODBC_TIME_EPOCH} ODBCTIMETYPE;
+
+//	seconds since 1970 for a "YYYY-MM-DD HH:MM:SS" time, anything after it
+//		ignored.  returns 0 if it isn't one.
+int ODBCTimeToEpoch(const char *, odbc::Long *);
+//	the "YYYY-MM-DD HH:MM:SS" form of seconds since 1970, in 20 chars
+void ODBCEpochToTime(odbc::Long, char *);
+
+class ODBCSchema{
+public:
+	ODBCSchema();
+
+	void Reset();
+	int Negotiate(odbc::Connection *, const char *);
+	int IsText(){return timetype == ODBC_TIME_TEXT && !typedvalue;}
+	int Params(){return imagcol ? 3 : 2;}	//	time, value[, imaginary]
+	string Columns();
+	void BindTime(odbc::PreparedStatement *, int, const string &);
+	void Bind(odbc::PreparedStatement *, int, eventrow &);
+	void Decode(odbc::ResultSet *, eventrow &);
+	int ParseValue(const string &, double *, double *);
+
+	int		timetype;		//	ODBCTIMETYPE
+	int		typedvalue;		//	EVENT_VAL is numeric
+	int		imagcol;		//	numeric EVENT_VAL_IMAG is present
+private:
+	int ParseTime(const string &);
+
+	string	lasttime;		//	every recorder in a timestep sends the same string
+	int		lastok;
+	int		year, month, day, hour, minute, second;
+	int		warned;
+};
+
+#endif
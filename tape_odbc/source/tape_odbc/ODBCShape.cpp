@@ -0,0 +1,173 @@
+/*	$Id$
+	Copyright (C) 2008 Battelle Memorial Institute
+
+ *	Loading, compiling, and sharing SHAPE_TABLE shapes.
+ */
+
+#include <odbc++/preparedstatement.h>
+#include <odbc++/resultset.h>
+
+#include "ODBCShape.h"
+#include "ODBCConnHandle.h"
+
+map<string, ODBCShape *> ODBCShape::cache;
+ODBCLock ODBCShape::cachelock;
+
+//	first and last index a shape column covers; -1 (NULL) is all of them
+static int first_of(int v){return v < 0 ? 0 : v;}
+static int last_of(int v, int n){return v < 0 ? n-1 : v;}
+
+static int gcd(int a, int b){
+	while(b != 0){
+		int t=a%b;
+		a=b;
+		b=t;
+	}
+	return a;
+}
+
+ODBCShape::ODBCShape(string &k){
+	key=k;
+	refs=0;
+	peak=0;
+	shape=0;
+}
+
+ODBCShape::~ODBCShape(){
+	;
+}
+
+//	finds the named shape on this connection, loading it on first use.  returns 0 if it has no rows.
+ODBCShape *ODBCShape::Get(ODBCConnHandle *handle, char *name){
+	string k=string(handle->GetName())+":"+name;
+	ODBCLocker locker(cachelock);	//	shapers may open on several threads
+	map<string, ODBCShape *>::iterator itr=cache.find(k);
+	if(itr != cache.end()){
+		++itr->second->refs;
+		return itr->second;
+	}
+	ODBCShape *shp=new ODBCShape(k);
+	if(!shp->Load(handle, name)){
+		delete shp;
+		return 0;
+	}
+	shp->refs=1;
+	cache[k]=shp;
+	return shp;
+}
+
+void ODBCShape::Release(ODBCShape *shp){
+	if(shp == 0) return;
+	ODBCLocker locker(cachelock);
+	if(--shp->refs > 0) return;
+	cache.erase(shp->key);
+	delete shp;
+}
+
+/*	reads the shape's rows in SHAPE_LINE order and compiles them: each row
+ *	sets its value on every slot it matches, a NULL column matching all,
+ *	so later rows override earlier ones.  The slot width is the largest
+ *	that divides every SHAPE_MINUTE given, an hour if none are.
+ */
+int ODBCShape::Load(ODBCConnHandle *handle, char *name){
+	vector<int> keys;	//	month, weekday, hour, minute per row
+	vector<float> vals, values;	//	values by month, weekday, hour and minute slot
+	size_t i, r;
+	int k, v, m, w, h, s, slot=60, steps;
+	{
+		ODBCLocker locker(handle->GetLock());
+		try{
+			odbc::PreparedStatement *stmt=handle->Prepare(
+				"SELECT SHAPE_MONTH, SHAPE_WEEKDAY, SHAPE_HOUR, SHAPE_MINUTE, SHAPE_VALUE FROM SHAPE_TABLE WHERE SHAPE_NAME=? ORDER BY SHAPE_LINE");
+			stmt->setString(1, name);
+			odbc::ResultSet *rs=stmt->executeQuery();
+			while(rs->next()){
+				for(k=1; k <= 4; ++k){
+					v=rs->getInt(k);
+					keys.push_back(rs->wasNull() ? -1 : v);
+				}
+				vals.push_back((float)rs->getDouble(5));
+			}
+			delete rs;
+		} catch(odbc::SQLException& e) {
+			cout << "Exception caught: "<<e.getMessage()<<endl;
+			return 0;
+		}
+	}
+	if(vals.empty()){
+		printf("WARNING:\tODBCShape::Load: no SHAPE_TABLE rows for %s\n", name);
+		return 0;
+	}
+	for(r=0; r < vals.size(); ++r){
+		int *row=&keys[r*4];
+		if(row[0] == 0 || row[0] > ODBC_SHAPE_MONTHS || row[0] < -1
+			|| row[1] >= ODBC_SHAPE_WKDYS || row[1] < -1
+			|| row[2] >= ODBC_SHAPE_HOURS || row[2] < -1
+			|| row[3] >= 60 || row[3] < -1){
+			printf("WARNING:\tODBCShape::Load: %s row %i is out of range, skipping it\n", name, (int)r+1);
+			row[0]=-2;	//	skipped
+			continue;
+		}
+		if(row[0] > 0)
+			--row[0];	//	months are stored 1-12
+		if(row[3] >= 0)
+			slot=gcd(slot, row[3]);
+	}
+	steps=60/slot;
+	values.assign(ODBC_SHAPE_MONTHS*ODBC_SHAPE_WKDYS*ODBC_SHAPE_HOURS*steps, 0);
+	for(r=0; r < vals.size(); ++r){
+		int *row=&keys[r*4];
+		if(row[0] == -2) continue;
+		for(m=first_of(row[0]); m <= last_of(row[0], ODBC_SHAPE_MONTHS); ++m)
+			for(w=first_of(row[1]); w <= last_of(row[1], ODBC_SHAPE_WKDYS); ++w)
+				for(h=first_of(row[2]); h <= last_of(row[2], ODBC_SHAPE_HOURS); ++h){
+					i=((m*ODBC_SHAPE_WKDYS + w)*ODBC_SHAPE_HOURS + h)*steps;
+					if(row[3] < 0)
+						for(s=0; s < steps; ++s)
+							values[i+s]=vals[r];
+					else
+						values[i+row[3]/slot]=vals[r];
+				}
+	}
+	for(i=0; i < values.size(); ++i)
+		if(values[i] > peak) peak=values[i];
+	Build(values, steps);
+	return 1;
+}
+
+/*	fills the byte form a shaper reads, one allocation for every month and
+ *	day, from values with steps minute slots per hour.  shaper.shape is
+ *	hourly, so the slots of each hour are averaged.
+ */
+void ODBCShape::Build(vector<float> &values, int steps){
+	int m, d, w, h, s;
+	float sum;
+	bytes.assign(ODBC_SHAPE_MONTHS*ODBC_SHAPE_DAYS*ODBC_SHAPE_WKDYS*ODBC_SHAPE_HOURS, 0);
+	hours.resize(ODBC_SHAPE_MONTHS*ODBC_SHAPE_DAYS*ODBC_SHAPE_WKDYS);
+	wkdys.resize(ODBC_SHAPE_MONTHS*ODBC_SHAPE_DAYS);
+	days.resize(ODBC_SHAPE_MONTHS);
+	for(m=0; m < ODBC_SHAPE_MONTHS; ++m){
+		days[m]=&wkdys[m*ODBC_SHAPE_DAYS];
+		for(d=0; d < ODBC_SHAPE_DAYS; ++d){
+			wkdys[m*ODBC_SHAPE_DAYS+d]=&hours[(m*ODBC_SHAPE_DAYS+d)*ODBC_SHAPE_WKDYS];
+			for(w=0; w < ODBC_SHAPE_WKDYS; ++w)
+				hours[(m*ODBC_SHAPE_DAYS+d)*ODBC_SHAPE_WKDYS+w]=&bytes[((m*ODBC_SHAPE_DAYS+d)*ODBC_SHAPE_WKDYS+w)*ODBC_SHAPE_HOURS];
+		}
+	}
+	shape=&days[0];
+	if(peak <= 0) return;
+	//	days of the month aren't in SHAPE_TABLE, so every day gets the same hours
+	for(m=0; m < ODBC_SHAPE_MONTHS; ++m)
+		for(w=0; w < ODBC_SHAPE_WKDYS; ++w)
+			for(h=0; h < ODBC_SHAPE_HOURS; ++h){
+				sum=0;
+				for(s=0; s < steps; ++s)
+					sum += values[((m*ODBC_SHAPE_WKDYS + w)*ODBC_SHAPE_HOURS + h)*steps + s];
+				sum /= steps;
+				if(sum < 0) sum=0;
+				for(d=0; d < ODBC_SHAPE_DAYS; ++d)
+					shape[m][d][w][h]=(unsigned char)(sum/peak*255+0.5);
+			}
+}
+
+//	end of ODBCShape.cpp
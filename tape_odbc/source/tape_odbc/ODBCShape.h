@@ -0,0 +1,60 @@
+/*	$id$
+	Copyright (C) 2008 Battelle Memorial Institute
+
+ *	Load shapes for ODBC shapers.  A shape is every SHAPE_TABLE row with
+ *		one SHAPE_NAME, read in one query and compiled into the hourly
+ *		byte array a shaper reads, minutes averaged into their hour.
+ *		Shapes are cached per connection and name, and shared by every
+ *		shaper that uses them.
+ */
+
+#ifndef _ODBCSHAPE_H_
+#define _ODBCSHAPE_H_
+
+#include <stdio.h>
+#include <map>
+#include <string>
+#include <vector>
+
+using std::map;
+using std::string;
+using std::vector;
+
+#include "ODBCThread.h"
+
+class ODBCConnHandle;
+
+//	the dimensions of a shaper's shape[month][day][weekday][hour] array
+#define ODBC_SHAPE_MONTHS	12
+#define ODBC_SHAPE_DAYS		31
+#define ODBC_SHAPE_WKDYS	7
+#define ODBC_SHAPE_HOURS	24
+
+class ODBCShape{
+public:
+	static ODBCShape *Get(ODBCConnHandle *, char *);
+	static void Release(ODBCShape *);
+
+	float GetPeak(){return peak;}
+	unsigned char ****GetShapeArray(){return shape;}
+private:
+	ODBCShape(string &);
+	~ODBCShape();
+	int Load(ODBCConnHandle *, char *);
+	void Build(vector<float> &, int);
+
+	string			key;
+	int				refs;
+	float			peak;
+	//	255ths of the peak, laid out for shaper.shape; pointers into bytes
+	unsigned char	****shape;
+	vector<unsigned char>	bytes;
+	vector<unsigned char *>	hours;
+	vector<unsigned char **>	wkdys;
+	vector<unsigned char ***>	days;
+
+	static map<string, ODBCShape *> cache;
+	static ODBCLock cachelock;
+};
+
+#endif
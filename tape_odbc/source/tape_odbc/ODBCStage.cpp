@@ -0,0 +1,593 @@
+/*	$Id$
+	Copyright (C) 2008 Battelle Memorial Institute
+
+ *	Staged collectors, aggregated by the database.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <ctype.h>
+
+#include "ODBCStage.h"
+#include "ODBCConnHandle.h"
+
+#define PI 3.1415926535897932384626433832795
+
+//	a string literal for sql, for the aggregate names, which are all checked words
+static string Quote(const string &s){
+	string out="'";
+	for(size_t i=0; i < s.size(); ++i){
+		if(s[i] == '\'')
+			out += '\'';
+		out += s[i];
+	}
+	return out+"'";
+}
+
+/*	reads "pN" as the fraction num/den, with up to three decimals, and
+ *	"median" as p50.  returns 0 if it's neither.
+ */
+static int ParsePercentile(const string &func, long *num, long *den){
+	const char *p=func.c_str();
+	int decimals=-1;
+	if(func == "median")
+		p="p50";
+	if(*p++ != 'p' || !isdigit((unsigned char)*p))
+		return 0;
+	*num=0;
+	*den=100;
+	for(; *p != 0; ++p){
+		if(*p == '.' && decimals < 0){
+			decimals=0;
+		} else if(isdigit((unsigned char)*p) && decimals < 3 && *num < 100000){
+			*num=*num*10+(*p-'0');
+			if(decimals >= 0){
+				++decimals;
+				*den *= 10;
+			}
+		} else
+			return 0;
+	}
+	return *num <= *den;
+}
+
+ODBCStage::ODBCStage(ODBCConnHandle *h, ODBCTapeOptions *opts, char *objname, char *prop, int clearold){
+	char buffer[256], *tok, *next;
+	size_t open, close, dot;
+	long num, den;
+	handle=h;
+	name=objname;
+	table=h->RunTable(opts->stage[0] != 0 ? opts->stage : "STAGE_TABLE");
+	aggtable=h->RunTable("AGGREGATE_TABLE");
+	//	"avg(voltage.mag)" stages voltage's magnitude
+	property=prop;
+	open=property.find('(');
+	close=property.rfind(')');
+	if(open != string::npos && close != string::npos && close > open)
+		property=property.substr(open+1, close-open-1);
+	dot=property.rfind('.');
+	if(dot != string::npos){
+		part=property.substr(dot+1);
+		property=property.substr(0, dot);
+	}
+	if(!part.empty() && part != "real" && part != "imag" && part != "mag" && part != "ang" && part != "arg"){
+		printf("WARNING:\tODBCStage::ODBCStage: %s can't stage the '%s' part of %s, staging the real part\n", objname, part.c_str(), property.c_str());
+		part="";
+	}
+	strncpy(buffer, opts->aggregates[0] != 0 ? opts->aggregates : "min max mean", 255);
+	buffer[255]=0;
+	for(next=buffer; *next != 0; ){	//	not strtok; stages may open on several threads
+		tok=next;
+		next += strcspn(next, " ");
+		if(*next != 0)
+			*next++=0;
+		if(*tok == 0)
+			continue;
+		string func=tok;
+		for(size_t i=0; i < func.size(); ++i)
+			func[i]=tolower(func[i]);
+		if(func == "min" || func == "max" || func == "mean" || func == "avg" || func == "sum" || func == "count" || ParsePercentile(func, &num, &den))
+			funcs.push_back(func);
+		else
+			printf("WARNING:\tODBCStage::ODBCStage: unknown aggregate '%s', skipping it\n", tok);
+	}
+	preparedon=0;
+	aggregate=0;
+	multirow=1;
+	windowed=1;
+	transactions=-1;
+	created=0;
+	clear=clearold;
+	keep=opts->keepstaged;
+	failed=funcs.empty();
+	dropped=0;
+	busy=0;
+	stalled=0;
+	stop=0;
+	if(failed)
+		printf("WARNING:\tODBCStage::ODBCStage: %s has no aggregates to compute, nothing will be written\n", objname);
+	else if(!thread.Start(Run, this))
+		printf("WARNING:\tODBCStage::ODBCStage: unable to start the staging thread, %s will write from the simulation\n", objname);
+}
+
+ODBCStage::~ODBCStage(){
+	Stop();
+	ODBCLocker locker(handle->GetLock());
+	Unprepare();
+}
+
+//	adds an object in the collector's group
+void ODBCStage::AddMember(char *objname, void *obj){
+	objects.push_back(objname);
+	members.push_back(obj);
+	values.push_back(0.0);
+	have.push_back(0);
+}
+
+//	takes a member's value for the interval being read; text that isn't a number stages NULL
+void ODBCStage::Set(size_t i, char *value){
+	double re, im;
+	have[i]=(value != 0 && value[0] != 0 && parser.ParseValue(value, &re, &im) != 0);
+	if(!have[i])
+		return;
+	if(part == "imag")
+		values[i]=im;
+	else if(part == "mag")
+		values[i]=sqrt(re*re+im*im);
+	else if(part == "ang")
+		values[i]=atan2(im, re)*180/PI;
+	else if(part == "arg")
+		values[i]=atan2(im, re);
+	else
+		values[i]=re;
+}
+
+/*	hands the interval that was just read to the staging thread.  while
+ *	the database is away, up to ODBC_MAXDOWNROWS values are held.  returns
+ *	1 if it's queued or written, 0 if it was dropped.
+ */
+int ODBCStage::Push(char *timestamp, int line){
+	interval iv;
+	if(failed)
+		return 0;
+	iv.timestamp=timestamp;
+	iv.line=line;
+	iv.values=values;
+	iv.have=have;
+	for(size_t i=0; i < have.size(); ++i)
+		have[i]=0;
+	if(!thread.IsRunning())
+		return WriteInterval(iv);
+	lock.Lock();
+	while(queue.size() >= ODBC_STAGE_MAXQUEUE){
+		if(stalled && (queue.size()+1)*members.size() <= ODBC_MAXDOWNROWS)
+			break;	//	the simulation doesn't wait on a database that's away
+		if(stalled){
+			++dropped;
+			lock.Unlock();
+			return 0;
+		}
+		lock.Unlock();
+		ready.Set();
+		space.Wait();
+		lock.Lock();
+	}
+	queue.push_back(iv);
+	lock.Unlock();
+	ready.Set();
+	return 1;
+}
+
+//	returns once everything pushed so far is aggregated, or the database is away
+void ODBCStage::Drain(){
+	lock.Lock();
+	if(stalled){
+		stalled=0;	//	one more try before giving up
+		wake.Set();
+	}
+	while((!queue.empty() && !stalled) || busy){
+		lock.Unlock();
+		ready.Set();
+		idle.Wait();
+		lock.Lock();
+	}
+	lock.Unlock();
+}
+
+void ODBCStage::Stop(){
+	Drain();
+	lock.Lock();
+	stop=1;
+	lock.Unlock();
+	ready.Set();
+	wake.Set();
+	thread.Join();
+	lock.Lock();
+	if(!queue.empty())
+		printf("WARNING:\tODBCStage::Stop: the database is away, %i intervals for %s were not aggregated\n", (int)queue.size(), name.c_str());
+	if(dropped > 0)
+		printf("WARNING:\tODBCStage::Stop: %li intervals for %s were dropped while the database was away\n", dropped, name.c_str());
+	queue.clear();
+	dropped=0;
+	lock.Unlock();
+}
+
+void ODBCStage::Run(void *vp){
+	((ODBCStage *)vp)->Loop();
+}
+
+void ODBCStage::Loop(){
+	interval iv;
+	int ok;
+	for(;;){
+		lock.Lock();
+		while(queue.empty() && !stop){
+			lock.Unlock();
+			idle.Set();
+			ready.Wait();
+			lock.Lock();
+		}
+		if(queue.empty() || (stop && stalled)){
+			lock.Unlock();
+			idle.Set();
+			return;
+		}
+		iv=queue.front();
+		busy=1;
+		lock.Unlock();
+		ok=WriteInterval(iv);
+		lock.Lock();
+		busy=0;
+		if(ok)
+			queue.pop_front();
+		stalled=!ok;
+		lock.Unlock();
+		space.Set();
+		if(!ok){
+			idle.Set();
+			wake.Wait(ODBC_STAGE_RETRY);
+		}
+	}
+}
+
+/*	stages one interval and aggregates it, in one transaction where the
+ *	database has them.  returns 0 if the link is down and it should be
+ *	tried again, 1 once it's written or given up on.
+ */
+int ODBCStage::WriteInterval(interval &iv){
+	ODBCLocker locker(handle->GetLock());
+	odbc::Connection *conn;
+	size_t done=0, left;
+	int count, ok, own=0;
+	int maxrows=ODBC_MAXPARAMS/4;
+	if(maxrows > ODBC_MAXBATCHROWS)
+		maxrows=ODBC_MAXBATCHROWS;
+	if(failed)
+		return 1;
+	if(!handle->Check())
+		return 0;
+	conn=handle->GetConn();
+	if(conn != preparedon && !Prepare())
+		return failed;
+	try{
+		if(transactions < 0)
+			transactions=conn->getMetaData()->supportsTransactions() ? 1 : 0;
+		if(transactions && conn->getAutoCommit()){
+			conn->setAutoCommit(false);	//	a commit policy may have it off already
+			own=1;
+		}
+	} catch(SQLException& e) {
+		if(handle->Lost(e))
+			return 0;
+		cout << "Exception caught: "<<e.getMessage()<<endl;
+		transactions=0;
+	}
+	while(done < iv.values.size()){
+		left=iv.values.size()-done;
+		if(!multirow)
+			count=1;
+		else if(left >= (size_t)maxrows)
+			count=maxrows;
+		else
+			for(count=1; (size_t)(count*2) <= left; count*=2);
+		ok=InsertRows(iv, done, count);
+		if(ok < 0)
+			return 0;
+		if(ok == 0 && count > 1){
+			printf("WARNING:\tODBCStage::WriteInterval: %s rejected a multi-row insert, falling back to single rows\n", table.c_str());
+			multirow=0;
+			if(transactions){
+				if(!Rollback(own)) return 0;
+				return WriteInterval(iv);	//	from the top, the transaction may be spoiled
+			}
+			continue;
+		}
+		if(ok == 0){
+			printf("WARNING:\tODBCStage::WriteInterval: can't stage %s at %s, skipping it\n", name.c_str(), iv.timestamp.c_str());
+			if(own && !End(0)) return 0;
+			return 1;
+		}
+		done += count;
+	}
+	ok=Aggregate(iv);
+	if(ok < 0)
+		return 0;
+	if(ok == 0 && windowed){
+		printf("WARNING:\tODBCStage::WriteInterval: %s rejected window functions, computing percentiles with subqueries\n", handle->GetName());
+		windowed=0;
+		if(transactions && !Rollback(own))
+			return 0;
+		if(!PrepareAggregate())
+			return failed;
+		if(transactions)
+			return WriteInterval(iv);
+		ok=Aggregate(iv);
+		if(ok < 0)
+			return 0;
+	}
+	if(ok == 0)
+		printf("WARNING:\tODBCStage::WriteInterval: can't aggregate %s at %s\n", name.c_str(), iv.timestamp.c_str());
+	else if(!keep && Unstage(iv) < 0)
+		return 0;
+	if(own && !End(1))
+		return 0;
+	handle->CountWork((int)done, 1);
+	return 1;
+}
+
+//	returns 1 if written, 0 if the rows were rejected, and -1 if the link went
+int ODBCStage::InsertRows(interval &iv, size_t first, int count){
+	try{
+		odbc::PreparedStatement *feeder;
+		map<int, odbc::PreparedStatement *>::iterator itr=inserts.find(count);
+		if(itr != inserts.end()){
+			feeder=itr->second;
+		} else {
+			string sql="INSERT INTO "+table+" (STAGE_NAME, STAGE_TIME, STAGE_OBJECT, STAGE_VAL) VALUES (?, ?, ?, ?)";
+			for(int i=1; i < count; ++i)
+				sql += ", (?, ?, ?, ?)";
+			double t0=ODBCMicros();
+			feeder=handle->GetConn()->prepareStatement(sql);
+			handle->GetStats().Prepared(ODBCMicros()-t0);
+			inserts[count]=feeder;
+		}
+		for(int i=0; i < count; ++i){
+			feeder->setString(4*i+1, name);
+			feeder->setString(4*i+2, iv.timestamp);
+			feeder->setString(4*i+3, objects[first+i]);
+			if(iv.have[first+i])
+				feeder->setDouble(4*i+4, iv.values[first+i]);
+			else
+				feeder->setNull(4*i+4, Types::DOUBLE);
+		}
+		double t0=ODBCMicros();
+		feeder->executeUpdate();
+		handle->GetStats().Executed(ODBCMicros()-t0, count, count*(name.size()+iv.timestamp.size()+sizeof(double)));
+		return 1;
+	} catch(SQLException& e) {
+		if(handle->Lost(e))
+			return -1;
+		if(count == 1)
+			cout << "Exception caught: "<<e.getMessage()<<endl;
+	}
+	return 0;
+}
+
+//	returns 1 if the aggregate rows were written, 0 if they were rejected, and -1 if the link went
+int ODBCStage::Aggregate(interval &iv){
+	try{
+		for(size_t i=0; i < funcs.size(); ++i){
+			aggregate->setString(5*i+1, name);
+			aggregate->setInt(5*i+2, iv.line);
+			aggregate->setString(5*i+3, iv.timestamp);
+			aggregate->setString(5*i+4, name);
+			aggregate->setString(5*i+5, iv.timestamp);
+		}
+		double t0=ODBCMicros();
+		aggregate->executeUpdate();
+		handle->GetStats().Executed(ODBCMicros()-t0, (long)funcs.size(), 0.0);
+		return 1;
+	} catch(SQLException& e) {
+		if(handle->Lost(e))
+			return -1;
+		if(!windowed)
+			cout << "Exception caught: "<<e.getMessage()<<endl;
+	}
+	return 0;
+}
+
+/*	rolls back a transaction a rejected statement may have spoiled, as
+ *	PostgreSQL's are, so the interval can be written again from the top.
+ *	under a commit policy the transaction is the connection's, and
+ *	autocommit stays off.  returns 0 if the link went.  caller holds the
+ *	connection lock.
+ */
+int ODBCStage::Rollback(int own){
+	return own ? End(0) : handle->Abandon();
+}
+
+//	drops the interval's staged rows once they're aggregated.  returns 1 if deleted, 0 if refused, and -1 if the link went
+int ODBCStage::Unstage(interval &iv){
+	try{
+		odbc::PreparedStatement *del=handle->Prepare("DELETE FROM "+table+" WHERE STAGE_NAME=? AND STAGE_TIME=?");
+		del->setString(1, name);
+		del->setString(2, iv.timestamp);
+		double t0=ODBCMicros();
+		int count=del->executeUpdate();
+		handle->GetStats().Executed(ODBCMicros()-t0, count, 0.0);
+		return 1;
+	} catch(SQLException& e) {
+		if(handle->Lost(e))
+			return -1;
+		cout << "Exception caught: "<<e.getMessage()<<endl;
+	}
+	return 0;
+}
+
+//	commits or rolls back the interval's transaction.  returns 0 if the link went.
+int ODBCStage::End(int commit){
+	odbc::Connection *conn=handle->GetConn();
+	try{
+		if(commit)
+			conn->commit();
+		else
+			conn->rollback();
+		conn->setAutoCommit(true);
+	} catch(SQLException& e) {
+		if(handle->Lost(e))
+			return 0;
+		cout << "Exception caught: "<<e.getMessage()<<endl;
+	}
+	return 1;
+}
+
+/*	makes the tables if they're missing, with an index that keeps the
+ *	percentiles from scanning, lists them with the run if there is one, and
+ *	clears this collector's old rows if asked.  returns 0 if the link went.  caller holds the connection lock.
+ */
+int ODBCStage::Create(){
+	odbc::Connection *conn=handle->GetConn();
+	string stmts[3], clears[2];
+	int lost=0, manual;
+	stmts[0]="CREATE TABLE "+table+" (STAGE_NAME VARCHAR(64), STAGE_TIME VARCHAR(32), STAGE_OBJECT VARCHAR(64), STAGE_VAL DOUBLE PRECISION)";
+	stmts[1]="CREATE INDEX "+table+"_KEY ON "+table+" (STAGE_NAME, STAGE_TIME, STAGE_VAL)";
+	stmts[2]="CREATE TABLE "+aggtable+" (AGG_NAME VARCHAR(64), AGG_LINE INTEGER, AGG_TIME VARCHAR(32), AGG_FUNC VARCHAR(16), AGG_VAL DOUBLE PRECISION)";
+	clears[0]="DELETE FROM "+table+" WHERE STAGE_NAME=?";
+	clears[1]="DELETE FROM "+aggtable+" WHERE AGG_NAME=?";
+	try{
+		//	under a commit policy, each statement gets a transaction of its own,
+		//	so a table that's there already can't spoil the policy's, and a
+		//	later rollback can't take the tables with it
+		manual=!conn->getAutoCommit();
+		if(manual)
+			conn->commit();
+		odbc::Statement *stmt=conn->createStatement();
+		for(int i=0; i < 3 && !lost; ++i){
+			try{
+				stmt->executeUpdate(stmts[i]);
+				if(manual)
+					conn->commit();
+			} catch(SQLException& e) {
+				lost=handle->Lost(e);	//	otherwise it's there already
+				if(!lost && manual)
+					conn->rollback();
+			}
+		}
+		delete stmt;
+		for(int i=0; clear && i < 2 && !lost; ++i){
+			try{
+				odbc::PreparedStatement *del=handle->Prepare(clears[i]);
+				del->setString(1, name);
+				del->executeUpdate();
+				if(manual)
+					conn->commit();
+			} catch(SQLException& e) {
+				lost=handle->Lost(e);
+				if(!lost && manual)
+					conn->rollback();
+			}
+		}
+		if(!lost){
+			ODBCRun::Register(handle, handle->GetRun(), table);
+			ODBCRun::Register(handle, handle->GetRun(), aggtable);
+		}
+	} catch(SQLException& e) {
+		if(handle->Lost(e))
+			return 0;
+		cout << "Exception caught: "<<e.getMessage()<<endl;
+	}
+	if(lost)
+		return 0;
+	created=1;
+	return 1;
+}
+
+/*	prepares the aggregate on the current connection, making the tables the
+ *	first time.  returns 0 if the link went or failed is set.  caller holds
+ *	the connection lock.
+ */
+int ODBCStage::Prepare(){
+	Unprepare();
+	if(!created && !Create())
+		return 0;
+	if(!PrepareAggregate())
+		return 0;
+	preparedon=handle->GetConn();
+	return 1;
+}
+
+int ODBCStage::PrepareAggregate(){
+	delete aggregate;
+	aggregate=0;
+	for(;;){
+		try{
+			double t0=ODBCMicros();
+			aggregate=handle->GetConn()->prepareStatement(BuildAggregate());
+			handle->GetStats().Prepared(ODBCMicros()-t0);
+			return 1;
+		} catch(SQLException& e) {
+			if(handle->Lost(e))
+				return 0;
+			if(windowed){
+				printf("WARNING:\tODBCStage::PrepareAggregate: %s rejected window functions, computing percentiles with subqueries\n", handle->GetName());
+				windowed=0;
+				continue;
+			}
+			cout << "Exception caught: "<<e.getMessage()<<endl;
+			printf("WARNING:\tODBCStage::PrepareAggregate: can't aggregate %s into %s, its intervals will be dropped\n", name.c_str(), aggtable.c_str());
+			failed=1;
+			return 0;
+		}
+	}
+}
+
+//	drops the statements after a reconnect.  caller holds the connection lock.
+void ODBCStage::Unprepare(){
+	map<int, odbc::PreparedStatement *>::iterator itr;
+	for(itr=inserts.begin(); itr != inserts.end(); ++itr)
+		delete itr->second;
+	inserts.clear();
+	delete aggregate;
+	aggregate=0;
+	preparedon=0;
+}
+
+/*	one INSERT ... SELECT for every aggregate, a UNION ALL branch each.
+ *	every branch takes AGG_NAME, AGG_LINE, AGG_TIME, STAGE_NAME, and
+ *	STAGE_TIME as parameters.
+ *	percentiles are nearest-rank: the least value with at least that
+ *	fraction of the interval's values at or below it.
+ */
+string ODBCStage::BuildAggregate(){
+	string sql="INSERT INTO "+aggtable+" (AGG_NAME, AGG_LINE, AGG_TIME, AGG_FUNC, AGG_VAL) ";
+	string where=" WHERE STAGE_NAME=? AND STAGE_TIME=?";
+	char buffer[64];
+	long num, den;
+	for(size_t i=0; i < funcs.size(); ++i){
+		const string &f=funcs[i];
+		if(i > 0)
+			sql += " UNION ALL ";
+		sql += "SELECT ?, ?, ?, "+Quote(f)+", ";
+		if(f == "min" || f == "max" || f == "sum")
+			sql += (f == "min" ? "MIN" : f == "max" ? "MAX" : "SUM")+string("(STAGE_VAL) FROM ")+table+where;
+		else if(f == "mean" || f == "avg")
+			sql += "AVG(STAGE_VAL) FROM "+table+where;
+		else if(f == "count")
+			sql += "COUNT(STAGE_VAL) FROM "+table+where;
+		else if(ParsePercentile(f, &num, &den)){
+			sprintf(buffer, "*%li >= %li*", den, num);
+			if(windowed){
+				sql += "MIN(R.STAGE_VAL) FROM (SELECT STAGE_VAL, ROW_NUMBER() OVER (ORDER BY STAGE_VAL) AS STAGE_RANK, COUNT(*) OVER () AS STAGE_COUNT FROM "
+					+table+where+" AND STAGE_VAL IS NOT NULL) R WHERE R.STAGE_RANK"+buffer+"R.STAGE_COUNT";
+			} else {
+				sql += "MIN(S.STAGE_VAL) FROM "+table+" S WHERE S.STAGE_NAME=? AND S.STAGE_TIME=? AND S.STAGE_VAL IS NOT NULL AND"
+					" (SELECT COUNT(*) FROM "+table+" T WHERE T.STAGE_NAME=S.STAGE_NAME AND T.STAGE_TIME=S.STAGE_TIME AND T.STAGE_VAL <= S.STAGE_VAL)"
+					+buffer+"(SELECT COUNT(U.STAGE_VAL) FROM "+table+" U WHERE U.STAGE_NAME=S.STAGE_NAME AND U.STAGE_TIME=S.STAGE_TIME)";
+			}
+		}
+	}
+	return sql;
+}
+
+//	end of ODBCStage.cpp
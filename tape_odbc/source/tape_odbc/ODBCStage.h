@@ -0,0 +1,110 @@
+/*	$id$
+	Copyright (C) 2008 Battelle Memorial Institute
+
+ *	Database-side aggregation for ODBC collectors.  Each interval, the raw
+ *		value of every object in the collector's group is inserted in bulk
+ *		into a staging table,
+ *			STAGE_NAME, STAGE_TIME, STAGE_OBJECT, STAGE_VAL
+ *		and one INSERT ... SELECT computes all of the collector's
+ *		aggregates from it into AGGREGATE_TABLE,
+ *			AGG_NAME, AGG_LINE, AGG_TIME, AGG_FUNC, AGG_VAL
+ *		one row per aggregate.  Both run on a background thread, so the
+ *		collector only reads its group's values.  The interval's staged
+ *		rows are deleted once it's aggregated, unless keepstaged is given.
+ */
+
+#ifndef _ODBCSTAGE_H_
+#define _ODBCSTAGE_H_
+
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <odbc++/connection.h>
+#include <odbc++/preparedstatement.h>
+
+#include "ODBCThread.h"
+#include "ODBCTapeOptions.h"
+#include "ODBCSchema.h"
+
+using std::list;
+using std::map;
+using std::string;
+using std::vector;
+
+#define ODBC_STAGE_MAXQUEUE	16		//	intervals waiting for the database
+#define ODBC_STAGE_RETRY	1000	//	ms between tries while the database is away
+
+class ODBCConnHandle;
+
+class ODBCStage{
+public:
+	ODBCStage(ODBCConnHandle *, ODBCTapeOptions *, char *, char *, int);
+	~ODBCStage();
+
+	void AddMember(char *, void *);
+	size_t GetMemberCount(){return members.size();}
+	void *GetMember(size_t i){return members[i];}
+	const char *GetProperty(){return property.c_str();}
+	void Set(size_t, char *);
+	int Push(char *, int);
+	void Drain();
+	void Stop();
+private:
+	struct interval{
+		string			timestamp;
+		int				line;
+		vector<double>	values;
+		vector<char>	have;
+	};
+	static void Run(void *);
+	void Loop();
+	int WriteInterval(interval &);
+	int InsertRows(interval &, size_t, int);
+	int Aggregate(interval &);
+	int Unstage(interval &);
+	int Rollback(int);
+	int End(int);
+	int Create();
+	int Prepare();
+	int PrepareAggregate();
+	void Unprepare();
+	string BuildAggregate();
+
+	ODBCConnHandle	*handle;
+	string			name;		//	the collector's object, STAGE_NAME and AGG_NAME
+	string			table;		//	the staging table
+	string			aggtable;	//	AGGREGATE_TABLE, or the run's
+	string			property;	//	read from each member
+	string			part;		//	real, imag, mag, or ang of a complex property
+	vector<string>	funcs;		//	aggregates, as given
+	vector<string>	objects;	//	member names, by member
+	vector<void *>	members;	//	member OBJECTs, by member
+	vector<double>	values;		//	the interval being read
+	vector<char>	have;
+	ODBCSchema		parser;		//	for ParseValue
+
+	odbc::Connection			*preparedon;
+	map<int, odbc::PreparedStatement *>	inserts;	//	keyed by row count
+	odbc::PreparedStatement		*aggregate;
+	int				multirow;	//	cleared if the driver rejects multi-row VALUES
+	int				windowed;	//	cleared if the driver rejects window functions
+	int				transactions;	//	-1 until asked
+	int				created;	//	the tables are there, and cleared if asked
+	int				clear;		//	delete this collector's old rows first
+	int				keep;		//	leave the staged rows once aggregated
+	int				failed;		//	the tables can't be used, intervals are dropped
+	long			dropped;
+
+	list<interval>	queue;
+	ODBCLock		lock;		//	guards the queue and flags below
+	ODBCSignal		ready;		//	an interval queued, or stop/drain wanted
+	ODBCSignal		space;		//	an interval left the queue
+	ODBCSignal		idle;		//	the thread caught up or stalled
+	ODBCSignal		wake;		//	stop, while the thread waits out a stall
+	int				busy, stalled, stop;
+	ODBCThread		thread;
+};
+
+#endif
@@ -0,0 +1,125 @@
+/*	$Id$
+	Copyright (C) 2008 Battelle Memorial Institute
+
+ *	Histograms and counters for ODBC tape I/O.
+ */
+
+#include <math.h>
+
+#include "ODBCStats.h"
+
+ODBCHistogram::ODBCHistogram(){
+	Reset();
+}
+
+void ODBCHistogram::Reset(){
+	buckets.clear();
+	count=0;
+	sum=0.0;
+	max=0.0;
+}
+
+//	one time, in microseconds
+void ODBCHistogram::Record(double us){
+	int i, e;
+	double f;
+	if(us < 0.0) us=0.0;
+	if(buckets.empty())
+		buckets.resize(ODBC_HIST_BUCKETS, 0);
+	if(us < ODBC_HIST_EXACT){
+		i=(int)us;
+	} else {
+		//	us = f*2^e, 0.5 <= f < 1; the top bits after the leading one pick the bucket
+		f=frexp(us, &e);
+		i=ODBC_HIST_EXACT+(e-5)*ODBC_HIST_SUB+(int)((f*2.0-1.0)*ODBC_HIST_SUB);
+		if(i >= ODBC_HIST_BUCKETS)
+			i=ODBC_HIST_BUCKETS-1;
+	}
+	++buckets[i];
+	++count;
+	sum += us;
+	if(us > max) max=us;
+}
+
+//	the time p (0-1) of the samples were at or under, to within a bucket
+double ODBCHistogram::Percentile(double p){
+	unsigned long rank, seen=0;
+	double hi;
+	int i, m, sub;
+	if(count == 0) return 0.0;
+	rank=(unsigned long)ceil(p*count);
+	if(rank < 1) rank=1;
+	for(i=0; i < ODBC_HIST_BUCKETS; ++i){
+		seen += buckets[i];
+		if(seen >= rank)
+			break;
+	}
+	if(i < ODBC_HIST_EXACT){
+		hi=i+1;
+	} else {
+		m=4+(i-ODBC_HIST_EXACT)/ODBC_HIST_SUB;
+		sub=(i-ODBC_HIST_EXACT)%ODBC_HIST_SUB;
+		hi=ldexp(1.0+(sub+1.0)/ODBC_HIST_SUB, m);
+	}
+	return hi < max ? hi : max;
+}
+
+ODBCCounters::ODBCCounters(){
+	Reset();
+}
+
+void ODBCCounters::Reset(){
+	prepare.Reset();
+	execute.Reset();
+	rows=0;
+	bytes=0.0;
+	retries=0;
+	queue=0;
+	queuemax=0;
+}
+
+//	one line on stdout, for kind ("tape", "connection") name
+void ODBCCounters::Print(const char *kind, const char *name){
+	printf("STATS:\t%s %s: %li rows, %.0f bytes, %li retries, queue %li (max %li); "
+		"%lu prepares, p50 %.0fus p99 %.0fus; %lu executes, p50 %.0fus p99 %.0fus max %.0fus\n",
+		kind, name, rows, bytes, retries, queue, queuemax,
+		prepare.GetCount(), prepare.Percentile(0.50), prepare.Percentile(0.99),
+		execute.GetCount(), execute.Percentile(0.50), execute.Percentile(0.99), execute.GetMax());
+}
+
+void ODBCStats::Reset(){
+	ODBCLocker locker(lock);
+	counters.Reset();
+}
+
+void ODBCStats::Prepared(double us){
+	ODBCLocker locker(lock);
+	counters.prepare.Record(us);
+}
+
+void ODBCStats::Executed(double us, long rows, double bytes){
+	ODBCLocker locker(lock);
+	counters.execute.Record(us);
+	counters.rows += rows;
+	counters.bytes += bytes;
+}
+
+void ODBCStats::Retried(){
+	ODBCLocker locker(lock);
+	++counters.retries;
+}
+
+void ODBCStats::Queued(long depth){
+	ODBCLocker locker(lock);
+	counters.queue=depth;
+	if(depth > counters.queuemax)
+		counters.queuemax=depth;
+}
+
+//	copies everything counted so far into out
+void ODBCStats::Get(ODBCCounters &out){
+	ODBCLocker locker(lock);
+	out=counters;
+}
+
+//	end of ODBCStats.cpp
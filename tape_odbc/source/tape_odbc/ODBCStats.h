@@ -0,0 +1,74 @@
+/*	$id$
+	Copyright (C) 2008 Battelle Memorial Institute
+
+ *	I/O counters for ODBC tapes and connection handles: how many statements
+ *		were prepared and executed and how long they took, rows and bytes
+ *		moved, retries, and queue depth.  Times go into log-linear
+ *		histograms, exact below 16us and within 1/8 above, so percentiles
+ *		come out without keeping samples.  Counting is always on; the
+ *		stats= option decides whether anyone is told.
+ */
+
+#ifndef _ODBCSTATS_H_
+#define _ODBCSTATS_H_
+
+#include <stdio.h>
+#include <vector>
+
+#include "ODBCThread.h"
+
+using std::vector;
+
+#define ODBC_HIST_EXACT		16	//	below this many us every value has its own bucket
+#define ODBC_HIST_SUB		8	//	buckets per power of two above that
+#define ODBC_HIST_BUCKETS	(ODBC_HIST_EXACT+40*ODBC_HIST_SUB)
+
+class ODBCHistogram{
+public:
+	ODBCHistogram();
+
+	void Reset();
+	void Record(double);
+	double Percentile(double);
+	unsigned long GetCount(){return count;}
+	double GetMax(){return max;}
+	double GetMean(){return count ? sum/count : 0.0;}
+private:
+	vector<unsigned long>	buckets;	//	allocated on the first Record
+	unsigned long			count;
+	double					sum, max;
+};
+
+//	a copy of one set of stats, for reporting
+class ODBCCounters{
+public:
+	ODBCCounters();
+
+	void Reset();
+	void Print(const char *, const char *);
+
+	ODBCHistogram	prepare;	//	us per prepareStatement
+	ODBCHistogram	execute;	//	us per execute, fetch, or tape write
+	long			rows;
+	double			bytes;
+	long			retries;
+	long			queue;		//	depth when last seen
+	long			queuemax;
+};
+
+class ODBCStats{
+public:
+	ODBCStats(){;}
+
+	void Reset();
+	void Prepared(double);
+	void Executed(double, long, double);
+	void Retried();
+	void Queued(long);
+	void Get(ODBCCounters &);
+private:
+	ODBCCounters	counters;
+	ODBCLock		lock;
+};
+
+#endif
@@ -0,0 +1,306 @@
+/*	$Id$
+	Copyright (C) 2008 Battelle Memorial Institute
+
+ *	Parsing for the "?key=value&..." tail of an ODBC tape filename.
+ */
+
+#include "ODBCTapeOptions.h"
+#include "ODBCRun.h"
+
+ODBCTapeOptions::ODBCTapeOptions(){
+	Reset();
+}
+
+void ODBCTapeOptions::Reset(){
+	given=0;
+	batchrows=1;
+	batchbytes=0;
+	flushstep=0;
+	async=0;
+	queuesize=4096;
+	fullmode=ODBC_FULL_BLOCK;
+	strcpy(spillname, "tape_odbc_spill.csv");
+	journal[0]=0;
+	bulk[0]=0;
+	bulkrows=100000;
+	fetchrows=256;
+	readahead=0;
+	shared=0;
+	typed=0;
+	group[0]=0;
+	start[0]=0;
+	compress=ODBC_COMPRESS_NONE;
+	tolerance=0.0;
+	interpolate=0;
+	follow=0;
+	lookahead=3600;
+	wait=60;
+	stage[0]=0;
+	aggregates[0]=0;
+	keepstaged=0;
+	commitrows=0;
+	commitms=0;
+	commitstep=0;
+	poolsize=1;
+	stats=0;
+	statsperiod=0;
+	run[0]=0;
+	keep=0;
+	replay[0]=0;
+	char *env=getenv(ODBC_COMMITENV);
+	if(env != 0)
+		ParseCommit(env);
+	env=getenv(ODBC_RUNENV);
+	if(env != 0){
+		strncpy(run, env, 32);
+		run[32]=0;
+		ODBCRun::CleanId(run);
+	}
+}
+
+/*	parses "key=value&key=value"; unknown keys are warned about and skipped.
+ *	split by hand, not with strtok, since tapes may open on several threads.
+ */
+int ODBCTapeOptions::Parse(char *optstr){
+	char buffer[1024], *tok, *val, *next;
+	int count=0;
+	strncpy(buffer, optstr, 1023);
+	buffer[1023]=0;
+	for(next=buffer; *next != 0; ){
+		tok=next;
+		next += strcspn(next, "&,");
+		if(*next != 0)
+			*next++=0;
+		if(*tok == 0)
+			continue;
+		val=strchr(tok, '=');
+		if(val != 0)
+			*val++=0;
+		if(0 == strcmp(tok, "batch") && val != 0){
+			batchrows=atoi(val);
+			if(batchrows < 1){
+				printf("WARNING:\tODBCTapeOptions::Parse: batch=%s is not a positive row count, using 1\n", val);
+				batchrows=1;
+			} else if(batchrows > ODBC_MAXBATCHROWS){
+				printf("WARNING:\tODBCTapeOptions::Parse: batch=%s exceeds %i rows, using %i\n", val, ODBC_MAXBATCHROWS, ODBC_MAXBATCHROWS);
+				batchrows=ODBC_MAXBATCHROWS;
+			}
+		} else if(0 == strcmp(tok, "bytes") && val != 0){
+			batchbytes=atoi(val);
+			if(batchbytes < 0) batchbytes=0;
+		} else if(0 == strcmp(tok, "flush") && val != 0){
+			if(0 == strcmp(val, "timestep"))
+				flushstep=1;
+			else if(0 == strcmp(val, "batch"))
+				flushstep=0;
+			else {
+				printf("WARNING:\tODBCTapeOptions::Parse: unknown flush mode '%s'\n", val);
+				continue;
+			}
+		} else if(0 == strcmp(tok, "async")){
+			async=(val == 0 || atoi(val) != 0);
+		} else if(0 == strcmp(tok, "queue") && val != 0){
+			queuesize=atoi(val);
+			if(queuesize < 1){
+				printf("WARNING:\tODBCTapeOptions::Parse: queue=%s is not a positive row count, using 4096\n", val);
+				queuesize=4096;
+			}
+		} else if(0 == strcmp(tok, "full") && val != 0){
+			if(0 == strcmp(val, "block"))
+				fullmode=ODBC_FULL_BLOCK;
+			else if(0 == strcmp(val, "drop"))
+				fullmode=ODBC_FULL_DROP;
+			else if(0 == strcmp(val, "spill"))
+				fullmode=ODBC_FULL_SPILL;
+			else {
+				printf("WARNING:\tODBCTapeOptions::Parse: unknown queue-full mode '%s'\n", val);
+				continue;
+			}
+		} else if(0 == strcmp(tok, "spill") && val != 0){
+			strncpy(spillname, val, 255);
+			spillname[255]=0;
+			fullmode=ODBC_FULL_SPILL;
+		} else if(0 == strcmp(tok, "journal")){
+			strncpy(journal, val != 0 ? val : "tape_odbc_journal.dat", 255);
+			journal[255]=0;
+		} else if(0 == strcmp(tok, "bulk")){
+			strncpy(bulk, val != 0 ? val : "tape_odbc_bulk.csv", 255);
+			bulk[255]=0;
+		} else if(0 == strcmp(tok, "bulkrows") && val != 0){
+			bulkrows=atoi(val);
+			if(bulkrows < 1){
+				printf("WARNING:\tODBCTapeOptions::Parse: bulkrows=%s is not a positive row count, using 100000\n", val);
+				bulkrows=100000;
+			}
+		} else if(0 == strcmp(tok, "fetch") && val != 0){
+			fetchrows=atoi(val);
+			if(fetchrows < 1){
+				printf("WARNING:\tODBCTapeOptions::Parse: fetch=%s is not a positive row count, using 256\n", val);
+				fetchrows=256;
+			}
+		} else if(0 == strcmp(tok, "readahead")){
+			readahead=(val == 0 ? 4 : atoi(val));
+			if(readahead < 0) readahead=0;
+			if(readahead == 1) readahead=2;	//	one chunk playing, at least one ahead
+		} else if(0 == strcmp(tok, "shared")){
+			shared=(val == 0 || atoi(val) != 0);
+		} else if(0 == strcmp(tok, "schema") && val != 0){
+			if(0 == strcmp(val, "typed"))
+				typed=1;
+			else if(0 == strcmp(val, "text"))
+				typed=0;
+			else {
+				printf("WARNING:\tODBCTapeOptions::Parse: unknown schema '%s'\n", val);
+				continue;
+			}
+		} else if(0 == strcmp(tok, "commit") && val != 0){
+			if(!ParseCommit(val))
+				continue;
+		} else if(0 == strcmp(tok, "pool") && val != 0){
+			poolsize=atoi(val);
+			if(poolsize < 1){
+				printf("WARNING:\tODBCTapeOptions::Parse: pool=%s is not a positive connection count, using 1\n", val);
+				poolsize=1;
+			}
+		} else if(0 == strcmp(tok, "stats")){
+			statsperiod=(val == 0 ? 0 : atoi(val));
+			if(statsperiod < 0){
+				printf("WARNING:\tODBCTapeOptions::Parse: stats=%s is not a positive number of seconds, using 0\n", val);
+				statsperiod=0;
+			}
+			stats=(val == 0 || 0 != strcmp(val, "0"));
+		} else if((0 == strcmp(tok, "run") || 0 == strcmp(tok, "replay")) && val != 0){
+			char *id=(tok[0] == 'r' && tok[1] == 'u' ? run : replay);
+			strncpy(id, val, 32);
+			id[32]=0;
+			if(0 != strcmp(ODBCRun::CleanId(id), val))
+				printf("WARNING:\tODBCTapeOptions::Parse: %s=%s isn't a plain name, using %s\n", tok, val, id);
+		} else if(0 == strcmp(tok, "keep") && val != 0){
+			keep=atoi(val);
+			if(keep < 0){
+				printf("WARNING:\tODBCTapeOptions::Parse: keep=%s is not a positive run count, keeping them all\n", val);
+				keep=0;
+			}
+		} else if(0 == strcmp(tok, "group") && val != 0){
+			strncpy(group, val, 63);
+			group[63]=0;
+		} else if(0 == strcmp(tok, "start") && val != 0){
+			strncpy(start, val, 63);
+			start[63]=0;
+		} else if((0 == strcmp(tok, "deadband") || 0 == strcmp(tok, "swingdoor")) && val != 0){
+			tolerance=atof(val);
+			if(tolerance < 0.0){
+				printf("WARNING:\tODBCTapeOptions::Parse: %s=%s is a negative tolerance, using 0\n", tok, val);
+				tolerance=0.0;
+			}
+			compress=(tok[0] == 'd' ? ODBC_COMPRESS_DEADBAND : ODBC_COMPRESS_SWINGDOOR);
+		} else if(0 == strcmp(tok, "interpolate") && val != 0){
+			interpolate=atoi(val);
+			if(interpolate < 0){
+				printf("WARNING:\tODBCTapeOptions::Parse: interpolate=%s is not a positive number of seconds, using 0\n", val);
+				interpolate=0;
+			}
+		} else if(0 == strcmp(tok, "follow")){
+			follow=(val == 0 || atoi(val) != 0);
+		} else if(0 == strcmp(tok, "lookahead") && val != 0){
+			lookahead=atoi(val);
+			if(lookahead <= 0){
+				printf("WARNING:\tODBCTapeOptions::Parse: lookahead=%s is not a positive number of seconds, using 3600\n", val);
+				lookahead=3600;
+			}
+		} else if(0 == strcmp(tok, "wait") && val != 0){
+			wait=atoi(val);
+			if(wait < 0) wait=0;
+		} else if(0 == strcmp(tok, "stage")){
+			strncpy(stage, val != 0 ? val : "STAGE_TABLE", 63);
+			stage[63]=0;
+		} else if(0 == strcmp(tok, "keepstaged")){
+			keepstaged=(val == 0 || atoi(val) != 0);
+		} else if(0 == strcmp(tok, "aggregate") && val != 0){
+			//	repeated, one aggregate each
+			if(strlen(aggregates)+strlen(val)+2 > sizeof(aggregates)){
+				printf("WARNING:\tODBCTapeOptions::Parse: too many aggregates, ignoring '%s'\n", val);
+				continue;
+			}
+			if(aggregates[0] != 0)
+				strcat(aggregates, " ");
+			strcat(aggregates, val);
+		} else {
+			printf("WARNING:\tODBCTapeOptions::Parse: ignoring unknown option '%s'\n", tok);
+			continue;
+		}
+		++count;
+	}
+	given=(count > 0);
+	return count;
+}
+
+//	compares the connection-wide options; group, start, compression,
+//		interpolation, following, staging, and replay are per tape
+int ODBCTapeOptions::Differs(ODBCTapeOptions *other){
+	return batchrows != other->batchrows
+		|| batchbytes != other->batchbytes
+		|| flushstep != other->flushstep
+		|| async != other->async
+		|| queuesize != other->queuesize
+		|| fullmode != other->fullmode
+		|| strcmp(spillname, other->spillname) != 0
+		|| strcmp(journal, other->journal) != 0
+		|| strcmp(bulk, other->bulk) != 0
+		|| bulkrows != other->bulkrows
+		|| fetchrows != other->fetchrows
+		|| readahead != other->readahead
+		|| shared != other->shared
+		|| typed != other->typed
+		|| commitrows != other->commitrows
+		|| commitms != other->commitms
+		|| commitstep != other->commitstep
+		|| poolsize != other->poolsize
+		|| stats != other->stats
+		|| statsperiod != other->statsperiod
+		|| strcmp(run, other->run) != 0
+		|| keep != other->keep;
+}
+
+//	"auto", "timestep", "N" rows, or "Nms"; later ones add to earlier ones
+//		except auto, which turns them all off.  returns 0 if not understood.
+int ODBCTapeOptions::ParseCommit(char *val){
+	char *end=0;
+	long n;
+	if(0 == strcmp(val, "auto")){
+		commitrows=commitms=commitstep=0;
+		return 1;
+	}
+	if(0 == strcmp(val, "timestep")){
+		commitstep=1;
+		return 1;
+	}
+	n=strtol(val, &end, 10);
+	if(end != val && n > 0){
+		if(0 == strcmp(end, "ms")){
+			commitms=(int)n;
+			return 1;
+		} else if(*end == 0){
+			commitrows=(int)n;
+			return 1;
+		}
+	}
+	printf("WARNING:\tODBCTapeOptions::ParseCommit: unknown commit policy '%s'\n", val);
+	return 0;
+}
+
+//	copies the tape name without its "?options" tail into name, and parses
+//		the tail into opts.  returns name.
+char *ODBCTapeOptions::SplitName(char *fname, char *name, int size, ODBCTapeOptions *opts){
+	char *q;
+	strncpy(name, fname, size-1);
+	name[size-1]=0;
+	q=strchr(name, '?');
+	if(q != 0){
+		*q++=0;
+		opts->Parse(q);
+	}
+	return name;
+}
+
+//	end of ODBCTapeOptions.cpp
@@ -0,0 +1,80 @@
+/*	$id$
+	Copyright (C) 2008 Battelle Memorial Institute
+
+ *	Tuning options for ODBC tapes.  These ride along at the end of the tape
+ *		filename after a '?', as in "dsn:uid:pwd:obj?batch=256&flush=timestep",
+ *		and are applied to the connection handle the tape ends up using.
+ *	The defaults reproduce the original one-row-per-sample behavior.
+ */
+
+#ifndef _ODBCTAPEOPTIONS_H_
+#define _ODBCTAPEOPTIONS_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//	drivers commonly cap a statement at ~2000 parameters, four or five per row
+#define ODBC_MAXPARAMS		2000
+#define ODBC_MAXBATCHROWS	500
+
+//	default commit policy for every connection, in the commit= syntax
+#define ODBC_COMMITENV		"TAPE_ODBC_COMMIT"
+//	default run ID for every connection, as for run=
+#define ODBC_RUNENV			"TAPE_ODBC_RUN"
+
+//	what an async writer does when its queue is full
+typedef enum {ODBC_FULL_BLOCK, ODBC_FULL_DROP, ODBC_FULL_SPILL} ODBCFULLMODE;
+
+//	how a recorder thins its samples before they're written
+typedef enum {ODBC_COMPRESS_NONE, ODBC_COMPRESS_DEADBAND, ODBC_COMPRESS_SWINGDOOR} ODBCCOMPRESSMODE;
+
+class ODBCTapeOptions{
+public:
+	ODBCTapeOptions();
+
+	void Reset();
+	int Parse(char *);
+	int Differs(ODBCTapeOptions *);
+	int ParseCommit(char *);
+
+	static char *SplitName(char *, char *, int, ODBCTapeOptions *);
+
+	int		given;			//	nonzero if anything was parsed
+	int		batchrows;		//	rows buffered before an insert is sent
+	int		batchbytes;		//	bytes buffered before an insert is sent, 0 for no limit
+	int		flushstep;		//	flush when the timestamp changes
+	int		async;			//	hand rows to a background writer
+	int		queuesize;		//	rows the writer queue holds
+	int		fullmode;		//	ODBCFULLMODE
+	char	spillname[256];	//	file for ODBC_FULL_SPILL
+	char	journal[256];	//	local journal rows go through, "" for none
+	char	bulk[256];		//	CSV file rows are staged in for bulk loads, "" for none
+	int		bulkrows;		//	rows staged before a bulk load
+	int		fetchrows;		//	player rows fetched and decoded per chunk
+	int		readahead;		//	chunks per player a read-ahead thread keeps full, 0 for none
+	int		shared;			//	players share one time-ordered query per connection
+	int		typed;			//	look for typed time and value columns
+	int		commitrows;		//	commit after this many rows, 0 for no limit
+	int		commitms;		//	commit after this many milliseconds, 0 for no limit
+	int		commitstep;		//	commit when the timestamp changes
+	int		poolsize;		//	connections per DSN and user
+	int		stats;			//	print I/O stats when tapes, and then the module, close
+	int		statsperiod;	//	seconds between STATS_TABLE rows, 0 for none
+	char	run[33];		//	run ID for the tables written, "" for the shared ones
+	int		keep;			//	runs kept when a run opens, 0 for all
+	char	replay[33];		//	run ID whose rows this player plays, "" for EVENT_TABLE, per tape
+	char	group[64];		//	wide-row group (table) for this recorder, per tape
+	char	start[64];		//	time this player starts at, per tape
+	int		compress;		//	ODBCCOMPRESSMODE for this recorder, per tape
+	double	tolerance;		//	deadband or swinging-door tolerance, per tape
+	int		interpolate;	//	seconds between rows this player interpolates, per tape
+	int		follow;			//	poll for rows as they're written, per tape
+	int		lookahead;		//	seconds of event time a following player reads per poll, per tape
+	int		wait;			//	seconds a following player waits for a row, 0 for ever, per tape
+	char	stage[64];		//	table a collector stages raw values in, "" for none, per tape
+	char	aggregates[256];	//	what a staged collector computes, space separated, per tape
+	int		keepstaged;		//	leave a staged collector's raw values once aggregated, per tape
+};
+
+#endif
@@ -8,13 +8,18 @@
 #include "ODBCTapeStream.h"
 
 list<tapepair *> ODBCTapeStream::tslist;
+ODBCLock ODBCTapeStream::tslock;
 ODBCTapeStream::ODBCTapeStream(){
 	dbconn=0;
+	shape=0;
+	stage=0;
 	Reset();
 }
 
 ODBCTapeStream::ODBCTapeStream(char *fname, char *flags){
 	dbconn=0;
+	shape=0;
+	stage=0;
 	char host[256], uid[256], pwd[64], objname[1024];
 	if(sscanf(fname, "%256[^;];%256[^;];%64[^;];%1024[^;]", host, uid, pwd, objname)==4){
 //		printf("Four-point open: %s, ***, ***, %s\n", host, objname);
@@ -29,45 +34,68 @@ ODBCTapeStream::ODBCTapeStream(char *fname, char *flags){
 
 ODBCTapeStream::ODBCTapeStream(char *servername, char *objectname, char *filemode){
 	dbconn=0;
+	shape=0;
+	stage=0;
 	Open(servername, objectname, filemode);
 }
 
 ODBCTapeStream::ODBCTapeStream(char *host, char *uid, char *pwd, char *objname, char *flags){
 	dbconn=0;
-	Open(host, uid, pwd, objname, flags);
+	shape=0;
+	stage=0;
+	Open(host, objname, uid, pwd, flags);
 }
 
 ODBCTapeStream::~ODBCTapeStream(){
 //	if(lines) delete lines;
+	if(dbconn)
+		dbconn->DisconnectTape(this);	//	in case we weren't closed
 }
 
 //	for the gamblers. -MH
-int ODBCTapeStream::Open(char *servername, char *objname, char *filemode){
-	return Open(servername, objname, "", "", filemode);
+int ODBCTapeStream::Open(char *servername, char *objname, const char *filemode){
+	return Open(servername, objname, (char *)"", (char *)"", filemode);
 }
 
-int ODBCTapeStream::Open(char *servername, char *objname, char *uid, char *pwd, char *_mode){
+int ODBCTapeStream::Open(char *servername, char *objname, char *uid, char *pwd, const char *_mode){
 	Reset();
-	static char buffer[256];
-	memset(buffer, 0, 256);
 	SetFileMode(_mode);
-	dbconn=ODBCConnMgr::GetMgr()->ConnectToHost(servername, uid, pwd);
+	if(filemode[0] == 'r')
+		interp.Reset(options.interpolate);
+	else if(filemode[0] != 's')
+		compressor.Reset(options.compress, options.tolerance);
+	dbconn=ODBCConnMgr::GetMgr()->ConnectToHost(servername, uid, pwd, &options);
 	if(0 == dbconn){
 		state=TSO_DONE;
 		return 0;
 	}
-	strncpy(objectname, objname, 63);
+	strncpy(objectname, objname, 63);	//	before the stats thread can see us
+	dbconn->RegisterStream(this);
+	dbconn->Configure(&options);
 	if(filemode[0]=='r'){
-		sprintf(buffer, "SELECT EVENT_TIME, EVENT_VAL FROM EVENT_TABLE WHERE EVENT_OBJECT_NAME='%s' ORDER BY EVENT_LINE", objname);
+		ODBCSchema *schema=dbconn->GetReadSchema();
+		cursor.SetStats(&stats, &dbconn->GetStats());
+		//	stream forward-only; the row count isn't needed, so don't make the driver find it
 		try{
-			PreparedStatement *feeder=dbconn->GetConn()->prepareStatement(buffer, 1, 0);
-			lines = feeder->executeQuery();
-			if(lines->last()){
-				line_max=lines->getRow();
-				lines->first();
+			//	players of EVENT_TABLE from the top may share one query
+			cursor.SetSource(options.replay[0] == 0 && !options.follow ? dbconn->GetSource() : 0);
+			if(options.follow)
+				cursor.SetFollow(dbconn, options.lookahead, options.wait);	//	another process may still be writing
+			if(options.replay[0] != 0){
+				//	what a run recorded, in the run's own column types
+				string table=ODBCRun::Table("OBJECT_TABLE", options.replay);
+				cursor.SetTable(table);
+				replayschema.Reset();
+				if(options.typed){
+					ODBCLocker locker(dbconn->GetLock());
+					replayschema.Negotiate(dbconn->GetConn(), table.c_str());
+				}
+				schema=&replayschema;
+			}
+			if(cursor.Open(dbconn->GetConn(), &dbconn->GetLock(), dbconn->GetReader(), schema, objectname, options.fetchrows, options.readahead, options.start)){
 				state=TSO_OPEN;
 				line_cur=1;
-				return line_max;
+				return 1;
 			} //	else empty set
 			state=TSO_DONE;
 			return 0;
@@ -76,14 +104,31 @@ int ODBCTapeStream::Open(char *servername, char *objname, char *uid, char *pwd,
 		}
 		return 2;
 	}
-	if(filemode[0]=='w' && filemode[1] != '+'){
+	if(filemode[0]=='s'){
+		//	shapers read their whole shape with ReadShape
+		state=TSO_OPEN;
+		return 1;
+	}
+	dbconn->OpenRun();	//	the first recorder makes the run's tables
+	if(filemode[0]!='r' && options.group[0] != 0){
+		group=dbconn->JoinGroup(options.group);
+		groupcol=group->Join(objectname);
+		if(groupcol < 0) group=0;
+	}
+	if(group != 0 && compressor.IsOn()){
+		printf("WARNING:\tODBCTapeStream::Open: %s is in group %s, so its samples aren't compressed\n", objectname, options.group);
+		compressor.Reset(ODBC_COMPRESS_NONE, 0.0);
+	}
+	if(filemode[0]=='w' && filemode[1] != '+' && dbconn->GetRun()[0] == 0){	//	a run's tables start empty
+		ODBCLocker locker(dbconn->GetLock());	//	an async writer may share the connection
 		try{
 			//	remove any existing header entry, those are pk'ed
-			sprintf(buffer, "DELETE FROM HEADER_TABLE WHERE HEADER_OBJECT_NAME='%s';", objectname);
-			PreparedStatement *feeder = dbconn->GetConn()->prepareStatement(buffer);
+			PreparedStatement *feeder = dbconn->Prepare("DELETE FROM HEADER_TABLE WHERE HEADER_OBJECT_NAME=?");
+			feeder->setString(1, objectname);
+			feeder->executeUpdate();
 			//	remove any existing events that might collide later
-			sprintf(buffer, "DELETE FROM EVENT_TABLE WHERE EVENT_OBJECT_NAME='%s';", objname);
-			feeder=dbconn->GetConn()->prepareStatement(buffer);
+			feeder=dbconn->Prepare("DELETE FROM EVENT_TABLE WHERE EVENT_OBJECT_NAME=?");
+			feeder->setString(1, objectname);
 			feeder->executeUpdate();
 			state=TSO_OPEN;
 			return 1;
@@ -105,24 +150,46 @@ char *ODBCTapeStream::ReadLine(){
 char *ODBCTapeStream::ReadLine(char *buffer, unsigned int size){
 	memset(buffer, 0, size);	//	prevents returning garbage
 	if(state != TSO_OPEN) return NULL;
-	sprintf(buffer, "%s,%s", lines->getString(1).c_str(), lines->getString(2).c_str());//timedate,value
+	eventrow *row;
+	if(interp.IsOn())
+		row=interp.Next(cursor);	//	stored rows, and the ones between them
+	else
+		row=cursor.Next();	//	copies out of the read-ahead ring, or fetches a chunk
+	if(row == 0){
+		state = TSO_DONE;
+		return NULL;
+	}
+	string line=row->timestamp+","+row->value;	//	timedate,value
+	strncpy(buffer, line.c_str(), size-1);
 	++line_cur;
-	if(!lines->next())
+	if(interp.IsOn() ? !interp.More() : !cursor.More())
 		state = TSO_DONE;
 	return buffer;
 }
 
-/*	stubbed 'til we figure out how to store shapes in the DB	*/
+/*	loads the SHAPE_TABLE rows named objname, or this tape's object name if
+ *	that's 0, sharing them with any other shaper already using that shape.
+ *	scale gets the shape's peak value.  returns 0 if there's no such shape.
+ */
 int ODBCTapeStream::ReadShape(char *objname, float *scale){
-	//	retreive lines for objectname
-	//	-build query
-	//	kinda like "SELECT (min, hour, day, month, wkday, value) IN (shape_table) WHERE (shape_obj_name IS $objectname) SORT (asc, shape_part_num)"
-	//	-run query
-	//	-parse results
-
-	/*	nasty stuff from open_shaper here	*/
+	if(0 == dbconn) return 0;
+	ODBCShape::Release(shape);
+	shape=ODBCShape::Get(dbconn, objname ? objname : objectname);
+	if(0 == shape) return 0;
+	if(scale)
+		*scale=shape->GetPeak();
+	return 1;
+}
 
-	return 1;	//	success?
+/*	starts database-side aggregation for a collector given stage= or
+ *	aggregate=, with property the collector's.  the caller adds the
+ *	group's objects.  returns 0 if the tape isn't staged.
+ */
+ODBCStage *ODBCTapeStream::OpenStage(char *property){
+	if(0 == dbconn || (options.stage[0] == 0 && options.aggregates[0] == 0)) return 0;
+	if(0 == stage)
+		stage=new ODBCStage(dbconn, &options, objectname, property, filemode[0]=='w' && filemode[1] != '+' && dbconn->GetRun()[0] == 0);
+	return stage;
 }
 
 /*	catches the abstract TS::Write(char *), even if we need to somehow format
@@ -133,36 +200,81 @@ int ODBCTapeStream::Write(char *inbuffer){
 	return 0;
 }
 
-//	writes an event to the object table
+//	writes an event to the object table, by way of the connection's batch,
+//		counting the time it takes
 int ODBCTapeStream::Write(char *timestamp, char *value){
-	double event_val=atof(value);		//	assuming fp num
-	odbc::PreparedStatement *feeder=dbconn->GetConn()->prepareStatement("INSERT INTO OBJECT_TABLE VALUES (?, ?, ?, ?)");
-	feeder->setString(1, objectname);
-	feeder->setInt(2, ++line_cur);
-	feeder->setString(3, timestamp);
-	feeder->setString(4, value);
-	int rows=feeder->executeUpdate();
+	if(0 == dbconn) return 0;
+	double t0=ODBCMicros();
+	WriteRow(timestamp, value);
+	stats.Executed(ODBCMicros()-t0, 1, (double)(strlen(timestamp)+strlen(value)+sizeof(int)));
 	return 0;
 }
 
+void ODBCTapeStream::WriteRow(char *timestamp, char *value){
+	if(stage != 0){
+		stage->Push(timestamp, ++line_cur);	//	the values were Set by the collector
+		return;
+	}
+	if(compressor.IsOn()){
+		WriteKept(compressor.Add(timestamp, value));	//	only the samples that matter
+		return;
+	}
+	++line_cur;
+	if(group != 0)
+		group->Set(groupcol, timestamp, value);	//	one row per timestamp for the group
+	else
+		dbconn->QueueEvent(objectname, line_cur, timestamp, value);
+}
+
+//	queues the rows the compressor kept; line numbers count rows written
+void ODBCTapeStream::WriteKept(int n){
+	for(int i=0; i < n; ++i){
+		eventrow &row=compressor.Kept(i);
+		dbconn->QueueEvent(objectname, ++line_cur, (char *)row.timestamp.c_str(), (char *)row.value.c_str());
+	}
+}
+
 //	writes a file header to the header table.
 //	char*7 + float*2
 void ODBCTapeStream::PrintHeader(char *timestr, char *uname, char *hostname, char *targstr,
 	char *prop, char *trigger, long interval, long limit){
-	PreparedStatement *feeder = dbconn->GetConn()->prepareStatement("INSERT INTO HEADER_TABLE VALUES(?, ?, ?, ?, ?, ?, ?, ?, ?);");
-	feeder->setString(1, objectname);
-	feeder->setString(2, timestr);
-	feeder->setString(3, uname);
-	feeder->setString(4, hostname);
-	feeder->setString(5, targstr);
-	feeder->setString(6, prop);
-	feeder->setString(7, trigger);
-	feeder->setLong(8, interval);
-	feeder->setLong(9, limit);
-	int affectedRows=feeder->executeUpdate();
+	if(0 == dbconn) return;
+	ODBCLocker locker(dbconn->GetLock());
+	if(!dbconn->Check()) return;	//	the link is down, so this header is skipped
+	try{
+		PreparedStatement *feeder = dbconn->Prepare("INSERT INTO "+dbconn->RunTable("HEADER_TABLE")+" VALUES(?, ?, ?, ?, ?, ?, ?, ?, ?)");
+		feeder->setString(1, objectname);
+		feeder->setString(2, timestr);
+		feeder->setString(3, uname);
+		feeder->setString(4, hostname);
+		feeder->setString(5, targstr);
+		feeder->setString(6, prop);
+		feeder->setString(7, trigger);
+		feeder->setLong(8, interval);
+		feeder->setLong(9, limit);
+		int affectedRows=feeder->executeUpdate();
+	} catch(SQLException& e) {
+		if(!dbconn->Lost(e))
+			cout << "Exception caught: "<<e.getMessage()<<endl;
+	}
 }
 
 void ODBCTapeStream::Close(){
+	delete stage;	//	waits for the intervals it has queued
+	stage=0;
+	if(dbconn && compressor.IsOn())
+		WriteKept(compressor.Finish());	//	the last sample ends the series
+	if(group)
+		group->Flush();
+	if(dbconn)
+		dbconn->Flush();	//	don't leave our rows sitting in the batch
+	if(dbconn && dbconn->StatsWanted()){
+		ODBCCounters counters;
+		stats.Get(counters);
+		counters.Print("tape", objectname);
+	}
+	if(dbconn && dbconn->StatsPeriod() > 0)
+		dbconn->WriteStats(this);	//	its last row, the table's are only for open tapes
 	Reset();
 }
 
@@ -170,19 +282,41 @@ void ODBCTapeStream::HardClose(){	//	handle dc'ed us
 	//	do non-ODBCConnHandle stuff 'cus we got called from there
 	line_cur=0;
 	line_max=0;
-//	if(lines) delete [] lines;
+	cursor.Close();
 }
 
+//	goes back to where the player started, without waiting on the database
 int ODBCTapeStream::Rewind(){
 	line_cur=1;
+	interp.Reset(options.interpolate);
+	if(filemode[0]=='r' && dbconn)
+		state=cursor.Rewind() ? TSO_OPEN : TSO_DONE;
 	return 0;
 }
 
+//	restarts a player at the first event at or after timestamp; rewinds come back here too
+int ODBCTapeStream::Seek(char *timestamp){
+	if(filemode[0] != 'r' || 0 == dbconn) return 0;
+	line_cur=1;
+	interp.Reset(options.interpolate);
+	state=cursor.Seek(timestamp) ? TSO_OPEN : TSO_DONE;
+	return state == TSO_OPEN;
+}
+
 void ODBCTapeStream::Reset(){
 	memset(objectname, 0, 64);
+	group=0;
+	groupcol=-1;
+	ODBCShape::Release(shape);
+	shape=0;
+	delete stage;
+	stage=0;
 	line_cur=0;
 	line_max=0;
-//	if(lines) delete [] lines;
+	stats.Reset();
+	compressor.Reset(ODBC_COMPRESS_NONE, 0.0);
+	interp.Reset(0);
+	cursor.Close();	//	takes the connection and reader locks itself
 	if(dbconn)
 		dbconn->DisconnectTape(this);
 }
@@ -191,27 +325,42 @@ void ODBCTapeStream::Reset(){
 //	STATIC METHODS
 //
 
-TapeStream *ODBCTapeStream::OpenStream(void *my, char *fname, char *flags){
-	char host[256], uid[256], pwd[64], objname[1024];
+TapeStream *ODBCTapeStream::OpenStream(void *my, char *fname, const char *flags){
+	char host[256], uid[256], pwd[64], objname[1024], name[1024];
 	tapepair *pair=0;
+	ODBCTapeStream *ts=0;
+	ODBCTapeOptions opts;
+	//	peel off any "?batch=..." options first
+	ODBCTapeOptions::SplitName(fname, name, 1024, &opts);
 	//	try host:uid:pwd:obj
-	if(sscanf(fname, "%256[^:]:%256[^:]:%64[^:]:%1024[^:]", host, uid, pwd, objname)==4)
-		pair=new tapepair(new ODBCTapeStream(host, uid, pwd, objname, flags), my);
+	if(sscanf(name, "%256[^:]:%256[^:]:%64[^:]:%1024[^:]", host, uid, pwd, objname)==4){
+		ts=new ODBCTapeStream();
+		ts->options=opts;
+		ts->Open(host, objname, uid, pwd, flags);
+	}
 	//	try raw host:obj
-	else if(sscanf(fname, "%256[^:]:%1024[^:]", host, objname)==2)
-		pair=new tapepair(new ODBCTapeStream(host, objname, flags), my);
-	if(0==pair) return 0;	//	this shouldn't happen ~ bad fname format
+	else if(sscanf(name, "%256[^:]:%1024[^:]", host, objname)==2){
+		ts=new ODBCTapeStream();
+		ts->options=opts;
+		ts->Open(host, objname, flags);
+	}
+	if(0==ts) return 0;	//	this shouldn't happen ~ bad fname format
+	pair=new tapepair(ts, my);
+	ODBCLocker locker(tslock);
 	tslist.push_back(pair);
 	return pair->tape;
 }
 
 void ODBCTapeStream::CloseStream(void *my){
+	ODBCLocker locker(tslock);
 	list<tapepair *>::iterator itr=tslist.begin();
 	do{
 		if((*itr)->name == my){
 			(*itr)->tape->Close();
 			delete (*itr)->tape;
 			tslist.erase(itr);
+			if(tslist.empty())
+				ODBCConnMgr::GetMgr()->ReportStats();	//	the last tape is closed
 			return;
 		}
 		++itr;
@@ -219,11 +368,13 @@ void ODBCTapeStream::CloseStream(void *my){
 }
 
 void ODBCTapeStream::CloseAllStream(){
+	ODBCLocker locker(tslock);
 	while(!tslist.empty()){
 		tslist.back()->tape->Close();
 		delete tslist.back()->tape;
 		tslist.pop_back();
 	}
+	ODBCConnMgr::GetMgr()->ReportStats();
 }
 
 //	end of ODBCTapeStream.cpp
@@ -20,13 +20,20 @@
 
 using namespace odbc;
 
+#include "ODBCCompress.h"
 #include "ODBCConnHandle.h"
 #include "ODBCConnMgr.h"
+#include "ODBCPlayerCursor.h"
+#include "ODBCShape.h"
+#include "ODBCStage.h"
+#include "ODBCStats.h"
+#include "ODBCTapeOptions.h"
 #include "TapeStream.h"
 
 using namespace std;
 
 class ODBCConnHandle;
+class ODBCGroup;
 
 class ODBCTapeStream : public TapeStream{
 public:
@@ -36,8 +43,8 @@ public:
  	ODBCTapeStream(char *, char *, char *, char *, char *);
  	virtual ~ODBCTapeStream();
 
- 	int Open(char *, char *, char *);
-	int Open(char *, char *, char *, char *, char *);
+ 	int Open(char *, char *, const char *);
+	int Open(char *, char *, char *, char *, const char *);
 
  //	virtual char *Read();
  	virtual char *ReadLine(char *, unsigned int);
@@ -49,19 +56,38 @@ public:
  	virtual void Close();
  	void HardClose();
  	virtual int Rewind();
+	int Seek(char *);
 	void Reset();
+	ODBCShape *GetShape(){return shape;}
+	ODBCStage *OpenStage(char *);
+	ODBCStage *GetStage(){return stage;}
+	ODBCStats &GetStats(){return stats;}
+	char *GetName(){return objectname;}
 
 	virtual void PrintHeader(char *, char *, char *, char *, char *, char *, long, long);
 
-	static TapeStream *OpenStream(void *, char *, char *);
+	static TapeStream *OpenStream(void *, char *, const char *);
 	static void CloseStream(void *);
 	static void CloseAllStream();
 protected:
+	void WriteKept(int);
+	void WriteRow(char *, char *);
+
 	int					line_cur, line_max;
-	odbc::ResultSet		*lines;
+	ODBCPlayerCursor	cursor;
+	ODBCGroup *			group;		//	wide-row group, or 0
+	int					groupcol;
+	ODBCShape *			shape;		//	shared, for shapers
+	ODBCStage *			stage;		//	staged collectors, or 0
 	ODBCConnHandle *	dbconn;
 	char				objectname[64];
+	ODBCTapeOptions		options;
+	ODBCCompressor		compressor;	//	recorders, per tape
+	ODBCInterpolator	interp;		//	players, per tape
+	ODBCStats			stats;		//	this tape's I/O
+	ODBCSchema			replayschema;	//	players given replay=
 	static list<tapepair *>	tslist;
+	static ODBCLock			tslock;
 };
 
 #endif
@@ -0,0 +1,207 @@
+/*	$Id$
+	Copyright (C) 2008 Battelle Memorial Institute
+
+ *	Win32 and pthread implementations of the ODBCThread.h primitives.
+ */
+
+#include "ODBCThread.h"
+
+#ifdef WIN32
+
+unsigned long ODBCMillis(){
+	return GetTickCount();
+}
+
+double ODBCMicros(){
+	static double tick=0.0;
+	LARGE_INTEGER n;
+	if(tick == 0.0){
+		QueryPerformanceFrequency(&n);
+		tick=1e6/(double)n.QuadPart;
+	}
+	QueryPerformanceCounter(&n);
+	return (double)n.QuadPart*tick;
+}
+
+unsigned long ODBCThreadId(){
+	return (unsigned long)GetCurrentThreadId();
+}
+
+ODBCLock::ODBCLock(){
+	InitializeCriticalSection(&cs);
+}
+
+ODBCLock::~ODBCLock(){
+	DeleteCriticalSection(&cs);
+}
+
+void ODBCLock::Lock(){
+	EnterCriticalSection(&cs);
+}
+
+void ODBCLock::Unlock(){
+	LeaveCriticalSection(&cs);
+}
+
+ODBCSignal::ODBCSignal(){
+	event=CreateEvent(NULL, FALSE, FALSE, NULL);
+}
+
+ODBCSignal::~ODBCSignal(){
+	CloseHandle(event);
+}
+
+void ODBCSignal::Set(){
+	SetEvent(event);
+}
+
+void ODBCSignal::Wait(){
+	WaitForSingleObject(event, INFINITE);
+}
+
+int ODBCSignal::Wait(unsigned long ms){
+	return WaitForSingleObject(event, ms) == WAIT_OBJECT_0;
+}
+
+unsigned __stdcall ODBCThread::Entry(void *vp){
+	ODBCThread *t=(ODBCThread *)vp;
+	(*t->func)(t->arg);
+	return 0;
+}
+
+int ODBCThread::Start(void (*f)(void *), void *a){
+	if(running) return 0;
+	func=f;
+	arg=a;
+	thread=(HANDLE)_beginthreadex(NULL, 0, Entry, this, 0, NULL);
+	if(thread == 0) return 0;
+	running=1;
+	return 1;
+}
+
+void ODBCThread::Join(){
+	if(!running) return;
+	WaitForSingleObject(thread, INFINITE);
+	CloseHandle(thread);
+	running=0;
+}
+
+#else
+
+unsigned long ODBCMillis(){
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return (unsigned long)tv.tv_sec*1000 + tv.tv_usec/1000;
+}
+
+double ODBCMicros(){
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return (double)tv.tv_sec*1e6 + tv.tv_usec;
+}
+
+unsigned long ODBCThreadId(){
+	return (unsigned long)pthread_self();
+}
+
+ODBCLock::ODBCLock(){
+	pthread_mutexattr_t attr;
+	pthread_mutexattr_init(&attr);
+	pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+	pthread_mutex_init(&mutex, &attr);
+	pthread_mutexattr_destroy(&attr);
+}
+
+ODBCLock::~ODBCLock(){
+	pthread_mutex_destroy(&mutex);
+}
+
+void ODBCLock::Lock(){
+	pthread_mutex_lock(&mutex);
+}
+
+void ODBCLock::Unlock(){
+	pthread_mutex_unlock(&mutex);
+}
+
+ODBCSignal::ODBCSignal(){
+	pthread_mutex_init(&mutex, NULL);
+	pthread_cond_init(&cond, NULL);
+	flag=0;
+}
+
+ODBCSignal::~ODBCSignal(){
+	pthread_cond_destroy(&cond);
+	pthread_mutex_destroy(&mutex);
+}
+
+void ODBCSignal::Set(){
+	pthread_mutex_lock(&mutex);
+	flag=1;
+	pthread_cond_signal(&cond);
+	pthread_mutex_unlock(&mutex);
+}
+
+void ODBCSignal::Wait(){
+	pthread_mutex_lock(&mutex);
+	while(!flag)
+		pthread_cond_wait(&cond, &mutex);
+	flag=0;
+	pthread_mutex_unlock(&mutex);
+}
+
+int ODBCSignal::Wait(unsigned long ms){
+	struct timeval tv;
+	struct timespec until;
+	int set;
+	gettimeofday(&tv, NULL);
+	until.tv_sec=tv.tv_sec + ms/1000;
+	until.tv_nsec=tv.tv_usec*1000 + (ms%1000)*1000000;
+	if(until.tv_nsec >= 1000000000){
+		++until.tv_sec;
+		until.tv_nsec -= 1000000000;
+	}
+	pthread_mutex_lock(&mutex);
+	while(!flag)
+		if(pthread_cond_timedwait(&cond, &mutex, &until) != 0)
+			break;
+	set=flag;
+	flag=0;
+	pthread_mutex_unlock(&mutex);
+	return set;
+}
+
+void *ODBCThread::Entry(void *vp){
+	ODBCThread *t=(ODBCThread *)vp;
+	(*t->func)(t->arg);
+	return 0;
+}
+
+int ODBCThread::Start(void (*f)(void *), void *a){
+	if(running) return 0;
+	func=f;
+	arg=a;
+	if(0 != pthread_create(&thread, NULL, Entry, this)) return 0;
+	running=1;
+	return 1;
+}
+
+void ODBCThread::Join(){
+	if(!running) return;
+	pthread_join(thread, NULL);
+	running=0;
+}
+
+#endif
+
+ODBCThread::ODBCThread(){
+	func=0;
+	arg=0;
+	running=0;
+}
+
+ODBCThread::~ODBCThread(){
+	Join();
+}
+
+//	end of ODBCThread.cpp
@@ -0,0 +1,89 @@
+/*	$id$
+	Copyright (C) 2008 Battelle Memorial Institute
+
+ *	Just enough threading for the background tape services: a recursive
+ *		lock, a scoped locker, an auto-reset signal, a joinable thread,
+ *		and a millisecond clock.  Win32 primitives on Windows, pthreads
+ *		elsewhere.
+ */
+
+#ifndef _ODBCTHREAD_H_
+#define _ODBCTHREAD_H_
+
+#ifdef WIN32
+#include <windows.h>
+#include <process.h>
+#else
+#include <pthread.h>
+#include <sys/time.h>
+#endif
+
+//	wall-clock milliseconds, for interval checks only
+unsigned long ODBCMillis();
+//	microseconds from an arbitrary start, for timing calls
+double ODBCMicros();
+//	an id for the calling thread
+unsigned long ODBCThreadId();
+
+//	recursive, like a CRITICAL_SECTION
+class ODBCLock{
+public:
+	ODBCLock();
+	~ODBCLock();
+	void Lock();
+	void Unlock();
+private:
+#ifdef WIN32
+	CRITICAL_SECTION	cs;
+#else
+	pthread_mutex_t		mutex;
+#endif
+};
+
+class ODBCLocker{
+public:
+	ODBCLocker(ODBCLock &l) : lock(l){lock.Lock();}
+	~ODBCLocker(){lock.Unlock();}
+private:
+	ODBCLock &lock;
+};
+
+//	auto-reset: a Set() with no waiter is kept for the next Wait()
+class ODBCSignal{
+public:
+	ODBCSignal();
+	~ODBCSignal();
+	void Set();
+	void Wait();
+	int Wait(unsigned long);	//	gives up after that many ms; returns 1 if Set
+private:
+#ifdef WIN32
+	HANDLE				event;
+#else
+	pthread_mutex_t		mutex;
+	pthread_cond_t		cond;
+	int					flag;
+#endif
+};
+
+class ODBCThread{
+public:
+	ODBCThread();
+	~ODBCThread();
+	int Start(void (*)(void *), void *);
+	void Join();
+	int IsRunning(){return running;}
+private:
+#ifdef WIN32
+	static unsigned __stdcall Entry(void *);
+	HANDLE				thread;
+#else
+	static void *Entry(void *);
+	pthread_t			thread;
+#endif
+	void	(*func)(void *);
+	void	*arg;
+	int		running;
+};
+
+#endif
@@ -0,0 +1,157 @@
+/*	$Id$
+	Copyright (C) 2008 Battelle Memorial Institute
+
+ *	Background writer thread for ODBC recorders and collectors.
+ */
+
+#include "ODBCWriter.h"
+#include "ODBCConnHandle.h"
+
+ODBCWriter::ODBCWriter(ODBCConnHandle *h, ODBCTapeOptions *opts){
+	handle=h;
+	ring.resize(opts->queuesize);
+	head=0;
+	count=0;
+	fullmode=opts->fullmode;
+	strncpy(spillname, opts->spillname, 255);
+	spillname[255]=0;
+	spillfile=0;
+	dropped=0;
+	spilled=0;
+	busy=0;
+	stop=0;
+	if(!thread.Start(Run, this))
+		printf("WARNING:\tODBCWriter::ODBCWriter: unable to start the writer thread, rows will queue until closed\n");
+}
+
+ODBCWriter::~ODBCWriter(){
+	Stop();
+	if(spillfile != 0)
+		fclose(spillfile);
+}
+
+//	called from the sync loop.  returns 1 if queued, 0 if dropped or spilled.
+int ODBCWriter::Push(char *object, int line, char *timestamp, char *value){
+	lock.Lock();
+	while(count == ring.size()){
+		if(fullmode == ODBC_FULL_DROP){
+			head=(head+1)%ring.size();
+			--count;
+			++dropped;
+		} else if(fullmode == ODBC_FULL_SPILL || !thread.IsRunning()){
+			eventrow row(object, line, timestamp, value);
+			Spill(row);
+			lock.Unlock();
+			return 0;
+		} else {	//	ODBC_FULL_BLOCK
+			lock.Unlock();
+			ready.Set();
+			space.Wait();
+			lock.Lock();
+		}
+	}
+	eventrow &row=ring[(head+count)%ring.size()];
+	row.object=object;
+	row.line=line;
+	row.timestamp=timestamp;
+	row.value=value;
+	++count;
+	handle->GetStats().Queued((long)count);
+	lock.Unlock();
+	ready.Set();
+	return 1;
+}
+
+//	returns once everything pushed so far is in the database
+void ODBCWriter::Drain(){
+	lock.Lock();
+	if(!thread.IsRunning()){
+		//	no thread to hand to, so write what's queued from here
+		vector<eventrow> group;
+		for(; count > 0; --count, head=(head+1)%ring.size())
+			group.push_back(ring[head]);
+		Report();
+		lock.Unlock();
+		handle->WriteGroup(group);
+		return;
+	}
+	while(count > 0 || busy){
+		lock.Unlock();
+		ready.Set();
+		idle.Wait();
+		lock.Lock();
+	}
+	Report();
+	lock.Unlock();
+}
+
+//	caller holds lock.  owns up to overflow since the last drain.
+void ODBCWriter::Report(){
+	if(dropped > 0)
+		printf("WARNING:\tODBCWriter: the write queue overflowed, %li rows were dropped\n", dropped);
+	if(spilled > 0)
+		printf("WARNING:\tODBCWriter: the write queue overflowed, %li rows were spilled to %s\n", spilled, spillname);
+	if(spillfile != 0)
+		fflush(spillfile);
+	dropped=0;
+	spilled=0;
+}
+
+void ODBCWriter::Stop(){
+	Drain();
+	lock.Lock();
+	stop=1;
+	lock.Unlock();
+	ready.Set();
+	thread.Join();
+}
+
+void ODBCWriter::Run(void *vp){
+	((ODBCWriter *)vp)->Loop();
+}
+
+void ODBCWriter::Loop(){
+	vector<eventrow> group;
+	for(;;){
+		lock.Lock();
+		while(count == 0 && !stop){
+			lock.Unlock();
+			idle.Set();
+			ready.Wait();
+			lock.Lock();
+		}
+		if(count == 0){	//	and stop
+			lock.Unlock();
+			idle.Set();
+			return;
+		}
+		//	take everything queued so far as one group
+		group.clear();
+		for(; count > 0; --count, head=(head+1)%ring.size())
+			group.push_back(ring[head]);
+		busy=1;
+		lock.Unlock();
+		space.Set();
+		handle->WriteGroup(group);
+		lock.Lock();
+		busy=0;
+		lock.Unlock();
+	}
+}
+
+//	caller holds lock
+void ODBCWriter::Spill(eventrow &row){
+	if(spillfile == 0){
+		spillfile=fopen(spillname, "a");
+		if(spillfile == 0){
+			printf("WARNING:\tODBCWriter::Spill: unable to open %s, dropping rows\n", spillname);
+			fullmode=ODBC_FULL_DROP;
+			++dropped;
+			return;
+		}
+	}
+	fprintf(spillfile, "%s,%i,%s,%s\n", row.object.c_str(), row.line, row.timestamp.c_str(), row.value.c_str());
+	++spilled;
+}
+
+//	end of ODBCWriter.cpp
@@ -0,0 +1,57 @@
+/*	$id$
+	Copyright (C) 2008 Battelle Memorial Institute
+
+ *	Write-behind for an ODBCConnHandle.  Recorder and collector rows go
+ *		into a bounded ring and return at once; a background thread moves
+ *		them into the handle's insert batch and commits each group it
+ *		takes as one transaction.  When the ring is full the producer
+ *		blocks, drops the oldest row, or spills the row to a local file.
+ */
+
+#ifndef _ODBCWRITER_H_
+#define _ODBCWRITER_H_
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "ODBCThread.h"
+#include "ODBCTapeOptions.h"
+#include "TapeStream.h"
+
+using std::string;
+using std::vector;
+
+class ODBCConnHandle;
+
+class ODBCWriter{
+public:
+	ODBCWriter(ODBCConnHandle *, ODBCTapeOptions *);
+	~ODBCWriter();
+
+	int Push(char *, int, char *, char *);
+	void Drain();
+	void Stop();
+private:
+	static void Run(void *);
+	void Loop();
+	void Spill(eventrow &);
+	void Report();
+
+	ODBCConnHandle	*handle;
+	vector<eventrow> ring;
+	size_t			head, count;
+	int				fullmode;
+	char			spillname[256];
+	FILE			*spillfile;
+	long			dropped, spilled;
+
+	ODBCLock		lock;		//	guards everything above and below
+	ODBCSignal		ready;		//	rows queued, or stop/drain wanted
+	ODBCSignal		space;		//	the writer took rows
+	ODBCSignal		idle;		//	the writer finished a group
+	int				busy, stop;
+	ODBCThread		thread;
+};
+
+#endif
@@ -14,7 +14,7 @@ TapeStream::~TapeStream(){
 	;
 }
 
-void TapeStream::SetFileMode(char *mode){
+void TapeStream::SetFileMode(const char *mode){
 	strncpy(filemode, mode, 2);
 	filemode[2]=0;
 }
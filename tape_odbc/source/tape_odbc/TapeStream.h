@@ -12,6 +12,7 @@
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string>
 
 //#include "tape.h"
 typedef enum {TSO_INIT, TSO_OPEN, TSO_DONE, OS_ERROR} TAPEOBJSTATUS;
@@ -37,7 +38,7 @@ public:
 //	TAPESTATUS GetStreamState(){return state;}
 	int GetStreamState(){return (int)state;}
 	char *GetFileMode(){return filemode;}
-	void SetFileMode(char *);
+	void SetFileMode(const char *);
 protected:
 	int		state;
 	//TAPESTATUS	state;
@@ -53,4 +54,15 @@ public:
 	void *name;
 };	//	glorified struct
 
+//	one event line, as written by recorders and read back by players
+class eventrow{
+public:
+	eventrow(){line=0;}
+	eventrow(char *o, int l, char *t, char *v) : object(o), line(l), timestamp(t), value(v){;}
+	std::string object;
+	int line;
+	std::string timestamp;
+	std::string value;
+};	//	glorified struct
+
 #endif
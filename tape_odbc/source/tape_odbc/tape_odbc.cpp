@@ -26,6 +26,24 @@
 	 - EVENT_TIME - Text - Timedate of the event, either in relative or absolute (YYYY-MM-DD HH:MM:SS) format
 	 - EVENT_VAL - Text - Value written or read to the target.  Text for a double, complex, or enumeration.
 
+	With the schema=typed option, EVENT_TIME may instead be a TIMESTAMP (or a number of seconds
+	since 1970), EVENT_VAL a DOUBLE, and an optional DOUBLE EVENT_VAL_IMAG holds the imaginary
+	part of complex values.  The column types are read from the database when connecting.
+
+	Options may follow the filename after a '?', as in "dsn:uid:pwd:obj?batch=256&flush=timestep";
+	readme.txt describes each of them.
+
+	Shapers read SHAPE_TABLE, in which each row sets the value of one shape for the months,
+	weekdays, hours, and minutes it names; a NULL column matches all of them, and later rows
+	(by SHAPE_LINE) override earlier ones.  The shape name is the tape's object name.
+	 - SHAPE_NAME - Text - Name of the shape
+	 - SHAPE_LINE - Number - Order the rows apply in
+	 - SHAPE_MONTH - Number - 1-12, or NULL
+	 - SHAPE_WEEKDAY - Number - 0-6 from Sunday, or NULL
+	 - SHAPE_HOUR - Number - 0-23, or NULL
+	 - SHAPE_MINUTE - Number - 0-59, or NULL
+	 - SHAPE_VALUE - Number - Load for those times
+
 	Future implimentations may change drastically.
 @{
  **/
@@ -36,6 +54,8 @@
 
 EXPORT CALLBACKS *callback = NULL;
 
+static int stage_collector(struct collector *my);
+
 int open_player(struct player *my, char *fname, char *flags){
 	//	returns ODBCTapeStream *
 	my->tsp = ODBCTapeStream::OpenStream(my, fname, flags);
@@ -58,20 +78,46 @@ int rewind_player(struct player *my){
 	return ((ODBCTapeStream *)(my->tsp))->Rewind();
 }
 
+//	not called by the tape module; for restarting players from a checkpoint
+int seek_player(struct player *my, char *timestamp){
+	int ok=((ODBCTapeStream *)(my->tsp))->Seek(timestamp);
+	my->status=(ok ? TS_OPEN : TS_DONE);
+	return ok;
+}
+
 void close_player(struct player *my){
 	ODBCTapeStream::CloseStream(my);
 }
 
 /*** SHAPER ***/
+/*	the shape is read and compiled here, once per shape name and connection,
+ *	and my->shape points into the shared copy.  -mh	*/
 int open_shaper(struct shaper *my, char *fname, char *flags){
-	/*	complicated things occur here.  just as soon as we figure out where
-	 *	we store the shape data with ODBC. -mh	*/
-	gl_error("ODBC does not support shapers (yet!)");
-	return 0;
+	ODBCTapeStream *ts;
+	float peak=0;
+	my->tsp = ODBCTapeStream::OpenStream(my, fname, "s");
+	if(NULL == my->tsp){
+		gl_error("shaper DB %s: unable to connect.", fname);
+		my->status=TS_DONE;
+		return 0;
+	}
+	ts=(ODBCTapeStream *)(my->tsp);
+	if(!ts->ReadShape(NULL, &peak)){
+		gl_error("shaper DB %s: no shape in SHAPE_TABLE.", fname);
+		ODBCTapeStream::CloseStream(my);
+		my->tsp=NULL;
+		my->status=TS_DONE;
+		return 0;
+	}
+	my->shape=ts->GetShape()->GetShapeArray();
+	my->status=TS_OPEN;
+	my->type=FT_ODBC;
+	return 1;
 }
 
+//	shapes are read whole by open_shaper; there are no lines to hand out
 char *read_shaper(struct shaper *my,char *buffer,unsigned int size){
-	return ((ODBCTapeStream *)(my->tsp))->ReadLine(buffer, size);
+	return NULL;
 }
 
 int rewind_shaper(struct shaper *my){
@@ -79,6 +125,7 @@ int rewind_shaper(struct shaper *my){
 }
 
 void close_shaper(struct shaper *my){
+	my->shape=NULL;	//	belongs to the shared shape
 	ODBCTapeStream::CloseStream(my);
 }
 
@@ -100,11 +147,11 @@ int open_recorder(struct recorder *my, char *fname, char *flags){
 	sprintf(buff, "%s %d", obj->parent->oclass->name, obj->id);
 #ifdef WIN32
 	((ODBCTapeStream *)(my->tsp))->PrintHeader(asctime(localtime(&now)), getenv("USERNAME"), getenv("MACHINENAME"),
-		buff/***/, my->property, my->trigger[0]=='\0'?"(none)":my->trigger,
+		buff/***/, my->property, my->trigger[0]=='\0'?(char *)"(none)":my->trigger,
 		(long)my->interval, my->limit);
 #else
 	my->tsp->PrintHeader(asctime(localtime(&now)), getenv("USER"),
-		getenv("HOST"), buff/***/, my->property, my->trigger[0]=='\0'?"(none)":my->trigger,
+		getenv("HOST"), buff/***/, my->property, my->trigger[0]=='\0'?(char *)"(none)":my->trigger,
 		my->interval, my->limit);
 #endif
 	return 1;
@@ -136,18 +183,57 @@ int open_collector(struct collector *my, char *fname, char *flags){
 	my->samples=0;
 #ifdef WIN32
 	((ODBCTapeStream *)(my->tsp))->PrintHeader(asctime(localtime(&now)), getenv("USERNAME"), getenv("MACHINENAME"),
-		my->group, my->property, my->trigger[0]=='\0'?"(none)":my->trigger,
+		my->group, my->property, my->trigger[0]=='\0'?(char *)"(none)":my->trigger,
 		(long)my->interval, my->limit);
 #else
 	my->tsp->PrintHeader(asctime(localtime(&now)), getenv("USER"),
-		getenv("HOST"), my->group, my->property, my->trigger[0]=='\0'?"(none)":my->trigger,
+		getenv("HOST"), my->group, my->property, my->trigger[0]=='\0'?(char *)"(none)":my->trigger,
 		my->interval, my->limit);
 #endif
+	return stage_collector(my);
+}
+
+/*	for stage= and aggregate=, hands the collector's group to the tape,
+ *	which stages their values and lets the database aggregate them.	*/
+static int stage_collector(struct collector *my){
+	char name[256];
+	FINDLIST *list;
+	OBJECT *obj;
+	ODBCStage *stage=((ODBCTapeStream *)(my->tsp))->OpenStage(my->property);
+	if(NULL == stage)
+		return 1;
+	list=gl_find_objects(FL_GROUP, my->group);
+	if(NULL == list){
+		gl_error("collector DB %s: unable to find the group '%s' to stage.", my->file, my->group);
+		return 0;
+	}
+	for(obj=gl_find_next(list, NULL); obj != NULL; obj=gl_find_next(list, obj)){
+		if(obj->name != NULL && obj->name[0] != 0)
+			strncpy(name, obj->name, 255);
+		else
+			sprintf(name, "%s:%d", obj->oclass->name, obj->id);
+		name[255]=0;
+		stage->AddMember(name, obj);
+	}
+	gl_free(list);
+	if(0 == stage->GetMemberCount())
+		gl_warning("collector DB %s: the group '%s' is empty, nothing will be staged.", my->file, my->group);
 	return 1;
 }
 
 int write_collector(struct collector *my, char *timestamp, char *value){
-	return ((ODBCTapeStream *)(my->tsp))->Write(timestamp, value);
+	ODBCTapeStream *ts=(ODBCTapeStream *)(my->tsp);
+	ODBCStage *stage=ts->GetStage();
+	if(stage != NULL){
+		//	the database aggregates the raw values; the core's own aggregate isn't written
+		char buffer[1024];
+		for(size_t i=0; i < stage->GetMemberCount(); ++i){
+			if(gl_get_value_by_name((OBJECT *)stage->GetMember(i), (char *)stage->GetProperty(), buffer, sizeof(buffer)) <= 0)
+				buffer[0]=0;
+			stage->Set(i, buffer);
+		}
+	}
+	return ts->Write(timestamp, value);
 }
 
 void close_collector(struct collector *my){
@@ -19,6 +19,7 @@
 EXPORT int open_player(struct player *my, char *fname, char *flags);
 EXPORT char *read_player(struct player *my,char *buffer,unsigned int size);
 EXPORT int rewind_player(struct player *my);
+EXPORT int seek_player(struct player *my, char *timestamp);
 EXPORT void close_player(struct player *my);
 
 EXPORT int open_shaper(struct shaper *my, char *fname, char *flags);
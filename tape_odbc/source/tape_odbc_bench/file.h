@@ -0,0 +1,11 @@
+/*	$id$
+	Copyright (C) 2008 Battelle Memorial Institute
+
+ *	The tape module's file.h has nothing tape_odbc needs; this stands in
+ *		for it in the benchmark build.
+ */
+
+#ifndef _FILE_H
+#define _FILE_H
+
+#endif
@@ -0,0 +1,64 @@
+/*	$id$
+	Copyright (C) 2008 Battelle Memorial Institute
+
+ *	Just enough of the core's gridlabd.h to build tape_odbc outside of
+ *		GridLAB-D, for the benchmark.  Errors and warnings go to stdout,
+ *		and there are no groups to find.
+ */
+
+#ifndef _GRIDLABD_H
+#define _GRIDLABD_H
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+
+#define EXPORT extern "C"
+
+typedef struct s_callbacks{
+	int unused;
+} CALLBACKS;
+
+typedef struct s_class{
+	char name[64];
+} CLASS;
+
+typedef struct s_object_list{
+	int id;
+	struct s_object_list *parent;
+	CLASS *oclass;
+	char *name;
+} OBJECT;
+
+#define OBJECTHDR(X) ((OBJECT *)(X)-1)
+
+typedef struct s_findlist{
+	int unused;
+} FINDLIST;
+
+#define FL_GROUP ((FINDLIST *)-1)
+
+static inline void gl_error(const char *fmt, ...){
+	va_list ptr;
+	va_start(ptr, fmt);
+	printf("ERROR:\t");
+	vprintf(fmt, ptr);
+	printf("\n");
+	va_end(ptr);
+}
+
+static inline void gl_warning(const char *fmt, ...){
+	va_list ptr;
+	va_start(ptr, fmt);
+	printf("WARNING:\t");
+	vprintf(fmt, ptr);
+	printf("\n");
+	va_end(ptr);
+}
+
+static inline FINDLIST *gl_find_objects(FINDLIST *start, ...){return NULL;}
+static inline OBJECT *gl_find_next(FINDLIST *list, OBJECT *obj){return NULL;}
+static inline void gl_free(void *ptr){;}
+static inline int gl_get_value_by_name(OBJECT *obj, char *name, char *value, int size){return 0;}
+
+#endif
@@ -0,0 +1,61 @@
+/*	$id$
+	Copyright (C) 2008 Battelle Memorial Institute
+
+ *	Stand-ins for the tape module's structures, with the fields tape_odbc
+ *		uses, for the benchmark.
+ */
+
+#ifndef _TAPE_H
+#define _TAPE_H
+
+class TapeStream;
+
+typedef enum {TS_INIT, TS_OPEN, TS_DONE, TS_ERROR} TAPESTATUS;
+typedef enum {FT_FILE, FT_ODBC, FT_MEMORY} FILETYPE;
+
+struct player{
+	char file[1024];
+	FILETYPE type;
+	TapeStream *tsp;
+	TAPESTATUS status;
+	char property[256];
+	int loop;
+	int loopnum;
+};
+
+struct shaper{
+	char file[1024];
+	FILETYPE type;
+	TapeStream *tsp;
+	TAPESTATUS status;
+	char property[256];
+	int loop;
+	unsigned char ****shape;
+};
+
+struct recorder{
+	char file[1024];
+	FILETYPE type;
+	TapeStream *tsp;
+	TAPESTATUS status;
+	char trigger[32];
+	char property[1024];
+	long interval;
+	int limit;
+	int samples;
+};
+
+struct collector{
+	char file[1024];
+	FILETYPE type;
+	TapeStream *tsp;
+	TAPESTATUS status;
+	char trigger[32];
+	char group[1024];
+	char property[1024];
+	long interval;
+	int limit;
+	int samples;
+};
+
+#endif
@@ -0,0 +1,368 @@
+/*	$Id$
+	Copyright (C) 2008 Battelle Memorial Institute
+
+ *	Throughput benchmark for tape_odbc.  Opens N synthetic recorders,
+ *		writes a fixed number of rows through them, then plays the rows
+ *		back through N players, using the same calls the tape module
+ *		makes.  For each N it reports rows per second both ways, the
+ *		p50 and p99 latency of write_recorder, player startup time (open
+ *		to first row), and peak RSS.  Each N runs in its own process
+ *		against freshly made tables, so its peak RSS is its own.
+ *
+ *	By default it makes a data source for a SQLite file through the
+ *		SQLite ODBC driver, so nothing but unixODBC and the driver need
+ *		to be installed; -d runs it against an existing data source.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <pthread.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <odbc++/drivermanager.h>
+#include <odbc++/connection.h>
+#include <odbc++/statement.h>
+#include <odbc++/resultset.h>
+
+#include "tape_odbc.h"
+
+#define BENCH_DSN		"tape_odbc_bench"
+#define BENCH_EPOCH		946684800	//	2000-01-01 00:00:00 UTC
+
+using std::string;
+using std::vector;
+
+struct benchopts{
+	vector<int>	tapes;		//	tape counts to run
+	long		rows;		//	rows written per run
+	int			threads;	//	writer threads
+	string		wopts;		//	recorder options
+	string		ropts;		//	player options
+	string		dsn, uid, pwd;
+	string		dbfile;		//	the SQLite file, without -d
+	string		driver;		//	the SQLite driver, without -d
+};
+
+//	the tape module finds the OBJECT in front of each tape
+struct rectape{
+	OBJECT				hdr;
+	struct recorder		rec;
+};
+
+struct playtape{
+	OBJECT				hdr;
+	struct player		play;
+};
+
+struct writer{
+	rectape			*tapes;
+	int				count;
+	long			steps;
+	vector<float>	latency;	//	microseconds per write_recorder
+};
+
+static CLASS benchclass={"bench"};
+static OBJECT benchparent={0, NULL, &benchclass, NULL};
+
+static double Now(){
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec*1e-6;
+}
+
+static void FormatTime(long step, char *buffer){
+	time_t t=BENCH_EPOCH+step;
+	struct tm tm;
+	gmtime_r(&t, &tm);
+	strftime(buffer, 32, "%Y-%m-%d %H:%M:%S", &tm);
+}
+
+//	nearest-rank percentile of sorted samples
+static float Percentile(vector<float> &v, double p){
+	if(v.empty()) return 0;
+	size_t k=(size_t)(p*v.size()+0.999999);
+	if(k < 1) k=1;
+	if(k > v.size()) k=v.size();
+	return v[k-1];
+}
+
+static void TapeName(benchopts &o, const char *obj, int i, const string &opts, char *buffer){
+	if(o.uid.empty())
+		sprintf(buffer, "%s:%s%i", o.dsn.c_str(), obj, i);
+	else
+		sprintf(buffer, "%s:%s:%s:%s%i", o.dsn.c_str(), o.uid.c_str(), o.pwd.c_str(), obj, i);
+	if(!opts.empty()){
+		strcat(buffer, "?");
+		strcat(buffer, opts.c_str());
+	}
+}
+
+//	runs sql, ignoring errors when quiet (drops of missing tables)
+static int Execute(odbc::Connection *conn, const char *sql, int quiet){
+	try{
+		odbc::Statement *stmt=conn->createStatement();
+		stmt->executeUpdate(sql);
+		delete stmt;
+		return 1;
+	} catch(odbc::SQLException& e) {
+		if(!quiet)
+			printf("ERROR:\t%s: %s\n", sql, e.getMessage().c_str());
+	}
+	return 0;
+}
+
+static long Count(odbc::Connection *conn, const char *table){
+	long n=-1;
+	string sql=string("SELECT COUNT(*) FROM ")+table;
+	try{
+		odbc::Statement *stmt=conn->createStatement();
+		odbc::ResultSet *rs=stmt->executeQuery(sql);
+		if(rs->next())
+			n=rs->getInt(1);
+		delete rs;
+		delete stmt;
+	} catch(odbc::SQLException& e) {
+		printf("ERROR:\t%s: %s\n", sql.c_str(), e.getMessage().c_str());
+	}
+	return n;
+}
+
+//	writes a data source for the SQLite file and points unixODBC at it
+static int MakeDSN(benchopts &o){
+	char cwd[1024], ini[1100];
+	string db=o.dbfile;
+	if(db[0] != '/' && getcwd(cwd, sizeof(cwd)) != NULL)
+		db=string(cwd)+"/"+db;
+	sprintf(ini, "%s.ini", db.c_str());
+	FILE *fp=fopen(ini, "w");
+	if(fp == NULL){
+		printf("ERROR:\tunable to write %s\n", ini);
+		return 0;
+	}
+	fprintf(fp, "[%s]\nDriver=%s\nDatabase=%s\nTimeout=10000\nSync=OFF\n", BENCH_DSN, o.driver.c_str(), db.c_str());
+	fclose(fp);
+	setenv("ODBCINI", ini, 1);
+	o.dsn=BENCH_DSN;
+	o.dbfile=db;
+	return 1;
+}
+
+static odbc::Connection *MakeTables(benchopts &o, int fresh){
+	odbc::Connection *conn=0;
+	if(fresh && !o.dbfile.empty())
+		unlink(o.dbfile.c_str());
+	try{
+		conn=odbc::DriverManager::getConnection(o.dsn, o.uid, o.pwd);
+	} catch(odbc::SQLException& e) {
+		printf("ERROR:\tunable to connect to %s: %s\n", o.dsn.c_str(), e.getMessage().c_str());
+		return 0;
+	}
+	if(!fresh)
+		return conn;
+	Execute(conn, "DROP TABLE HEADER_TABLE", 1);
+	Execute(conn, "DROP TABLE OBJECT_TABLE", 1);
+	Execute(conn, "DROP TABLE EVENT_TABLE", 1);
+	if(!Execute(conn, "CREATE TABLE HEADER_TABLE (HEADER_OBJECT_NAME VARCHAR(64), HEADER_TIME VARCHAR(64), HEADER_USER VARCHAR(64),"
+			" HEADER_HOST VARCHAR(64), HEADER_TARGET VARCHAR(64), HEADER_PROPERTY VARCHAR(64), HEADER_TRIGGER VARCHAR(64),"
+			" HEADER_INTERVAL INTEGER, HEADER_LIMIT INTEGER)", 0)
+		|| !Execute(conn, "CREATE TABLE OBJECT_TABLE (EVENT_OBJECT_NAME VARCHAR(64), EVENT_LINE INTEGER, EVENT_TIME VARCHAR(32), EVENT_VAL VARCHAR(32))", 0)
+		|| !Execute(conn, "CREATE TABLE EVENT_TABLE (EVENT_OBJECT_NAME VARCHAR(64), EVENT_LINE INTEGER, EVENT_TIME VARCHAR(32), EVENT_VAL VARCHAR(32))", 0)
+		|| !Execute(conn, "CREATE INDEX EVENT_OBJECT_TIME ON EVENT_TABLE (EVENT_OBJECT_NAME, EVENT_TIME)", 0)){
+		delete conn;
+		return 0;
+	}
+	return conn;
+}
+
+static void *WriteTapes(void *vp){
+	writer *w=(writer *)vp;
+	char ts[32], value[32];
+	double t;
+	w->latency.reserve(w->steps*w->count);
+	for(long step=0; step < w->steps; ++step){
+		FormatTime(step, ts);
+		for(int i=0; i < w->count; ++i){
+			sprintf(value, "%.3f", 120.0+(i%100)*0.01+(step%60)*0.001);
+			t=Now();
+			write_recorder(&w->tapes[i].rec, ts, value);
+			w->latency.push_back((float)((Now()-t)*1e6));
+		}
+	}
+	return NULL;
+}
+
+//	one tape count, in its own process
+static int Run(benchopts &o, int n){
+	char name[2048], buffer[1024];
+	long steps=o.rows/n, rows, stored, read=0;
+	double t0, topen, twrite, tclose, tread;
+	int i, threads=(o.threads > n ? n : o.threads);
+	vector<float> latency, startup;
+	struct rusage ru;
+
+	if(steps < 1) steps=1;
+	rows=steps*n;
+	odbc::Connection *conn=MakeTables(o, 1);
+	if(conn == 0) return 1;
+
+	//	recorders
+	rectape *recs=new rectape[n];
+	memset(recs, 0, sizeof(rectape)*n);
+	t0=Now();
+	for(i=0; i < n; ++i){
+		recs[i].hdr.id=i;
+		recs[i].hdr.parent=&benchparent;
+		recs[i].hdr.oclass=&benchclass;
+		strcpy(recs[i].rec.property, "voltage");
+		recs[i].rec.interval=1;
+		TapeName(o, "rec", i, o.wopts, name);
+		if(!open_recorder(&recs[i].rec, name, (char *)"w")){
+			printf("ERROR:\tunable to open recorder %s\n", name);
+			return 1;
+		}
+	}
+	topen=Now()-t0;
+	vector<writer> writers(threads);
+	vector<pthread_t> ids(threads);
+	t0=Now();
+	for(i=0; i < threads; ++i){
+		writers[i].tapes=recs+(long)n*i/threads;
+		writers[i].count=(int)((long)n*(i+1)/threads-(long)n*i/threads);
+		writers[i].steps=steps;
+		if(threads == 1)
+			WriteTapes(&writers[i]);
+		else
+			pthread_create(&ids[i], NULL, WriteTapes, &writers[i]);
+	}
+	for(i=0; i < threads && threads > 1; ++i)
+		pthread_join(ids[i], NULL);
+	twrite=Now()-t0;
+	t0=Now();
+	for(i=0; i < n; ++i)
+		close_recorder(&recs[i].rec);
+	tclose=Now()-t0;
+	for(i=0; i < threads; ++i)
+		latency.insert(latency.end(), writers[i].latency.begin(), writers[i].latency.end());
+	std::sort(latency.begin(), latency.end());
+	stored=Count(conn, "OBJECT_TABLE");
+
+	//	players, over what the recorders wrote
+	Execute(conn, "INSERT INTO EVENT_TABLE SELECT * FROM OBJECT_TABLE", 0);
+	playtape *plays=new playtape[n];
+	memset(plays, 0, sizeof(playtape)*n);
+	t0=Now();
+	for(i=0; i < n; ++i){
+		double ts=Now();
+		TapeName(o, "rec", i, o.ropts, name);
+		if(!open_player(&plays[i].play, name, (char *)"r")){
+			printf("ERROR:\tunable to open player %s\n", name);
+			return 1;
+		}
+		if(read_player(&plays[i].play, buffer, sizeof(buffer)) != NULL)
+			++read;
+		startup.push_back((float)((Now()-ts)*1e3));
+	}
+	for(long step=1; step < steps; ++step)
+		for(i=0; i < n; ++i)
+			if(read_player(&plays[i].play, buffer, sizeof(buffer)) != NULL)
+				++read;
+	tread=Now()-t0;
+	for(i=0; i < n; ++i)
+		close_player(&plays[i].play);
+	std::sort(startup.begin(), startup.end());
+	delete conn;
+
+	getrusage(RUSAGE_SELF, &ru);
+	printf("%6i %9li %8.2f %10.0f %8.1f %8.1f %8.2f %8li %8.2f %8.2f %10.0f %8.1f\n",
+		n, rows, topen, rows/(twrite+tclose), Percentile(latency, 0.50), Percentile(latency, 0.99), tclose,
+		rows-stored, Percentile(startup, 0.50), Percentile(startup, 1.0), read/tread, ru.ru_maxrss/1024.0);
+	if(read != rows)
+		printf("WARNING:\tplayers read %li of %li rows\n", read, rows);
+	return 0;
+}
+
+static void Usage(){
+	printf("usage: tape_odbc_bench [-t 1,10,100,1000,10000] [-r rows] [-j threads]\n"
+		"\t[-o recorder-options] [-p player-options]\n"
+		"\t[-f file.db] [-D sqlite-driver] | [-d dsn [-u uid] [-w pwd]]\n"
+		"  -t  tape counts to run, each in its own process\n"
+		"  -r  rows written per run, spread over the tapes (default 200000)\n"
+		"  -j  threads writing the recorders (default 1)\n"
+		"  -o  options for the recorders, as after the '?', e.g. batch=256&async\n"
+		"  -p  options for the players (default the recorders'); options that\n"
+		"      belong to the connection are taken from the recorders regardless\n"
+		"  -f  the SQLite file (default tape_odbc_bench.db)\n"
+		"  -D  the SQLite ODBC driver, by name or path (default SQLite3)\n"
+		"  -d  use this data source instead; its tables are dropped and made again\n");
+}
+
+int main(int argc, char *argv[]){
+	benchopts o;
+	int c, status, failed=0, ropts_set=0;
+	char *tok;
+	o.rows=200000;
+	o.threads=1;
+	o.dbfile="tape_odbc_bench.db";
+	o.driver="SQLite3";
+	while((c=getopt(argc, argv, "t:r:j:o:p:f:D:d:u:w:h")) != -1){
+		switch(c){
+			case 't':
+				for(tok=strtok(optarg, ","); tok != NULL; tok=strtok(NULL, ","))
+					if(atoi(tok) > 0)
+						o.tapes.push_back(atoi(tok));
+				break;
+			case 'r': o.rows=atol(optarg); break;
+			case 'j': o.threads=atoi(optarg) > 0 ? atoi(optarg) : 1; break;
+			case 'o': o.wopts=optarg; break;
+			case 'p': o.ropts=optarg; ropts_set=1; break;
+			case 'f': o.dbfile=optarg; break;
+			case 'D': o.driver=optarg; break;
+			case 'd': o.dsn=optarg; break;
+			case 'u': o.uid=optarg; break;
+			case 'w': o.pwd=optarg; break;
+			default:
+				Usage();
+				return 1;
+		}
+	}
+	//	players share the recorders' connection, so they take its options
+	if(!ropts_set)
+		o.ropts=o.wopts;
+	if(o.tapes.empty()){
+		int defaults[]={1, 10, 100, 1000, 10000};
+		o.tapes.assign(defaults, defaults+5);
+	}
+	if(o.dsn.empty()){
+		if(!MakeDSN(o))
+			return 1;
+	} else
+		o.dbfile="";	//	not ours to delete
+	printf("recorders: ?%s  players: ?%s  threads: %i  source: %s\n", o.wopts.c_str(), o.ropts.c_str(), o.threads, o.dsn.c_str());
+	printf("%6s %9s %8s %10s %8s %8s %8s %8s %8s %8s %10s %8s\n",
+		"tapes", "rows", "open_s", "write/s", "p50_us", "p99_us", "close_s", "lost", "start50", "startmax", "read/s", "rss_mb");
+	fflush(stdout);
+	for(size_t i=0; i < o.tapes.size(); ++i){
+		pid_t pid=fork();
+		if(pid == 0){
+			int rv=Run(o, o.tapes[i]);
+			fflush(stdout);
+			_exit(rv);
+		}
+		if(pid < 0 || waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0){
+			printf("ERROR:\tthe run with %i tapes failed\n", o.tapes[i]);
+			failed=1;
+		}
+		fflush(stdout);
+	}
+	return failed;
+}
+
+//	end of tape_odbc_bench.cpp